@@ -0,0 +1,703 @@
+/******************************************************************************/
+/**
+@file		compressStorage.c
+@author		Ramon Lawrence
+@brief		Compressed storage implementation packing compressed pages into a log of blocks.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+
+#include <string.h>
+
+#include "compressStorage.h"
+#include "crc32c.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define COMPRESS_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+Log of compressed pages is a byte stream stored in blocks of pageSize bytes starting at COMPRESS_STORAGE_LOG_START.
+The block being filled (staging block) is kept in memory and is written when full or on flush.
+Pages are optionally byte shuffled with stride of record size so that similar bytes (e.g. high bytes of keys and values) are adjacent.
+A flush appends a page map chunk to the log: offset of previous chunk, number of entries, then entries
+(page id, log offset, length) for pages written since the previous flush. A page with length pageSize is not compressed.
+*/
+#define COMPRESS_HEADER_MAGIC		0x434D5053
+#define COMPRESS_MAP_ENTRY_SIZE		10
+
+/* LZ4 block format: minimum match of 4 bytes, last 5 bytes are literals, last match starts at least 12 bytes before end */
+#define COMPRESS_MIN_MATCH			4
+#define COMPRESS_LAST_LITERALS		5
+#define COMPRESS_MATCH_LIMIT		12
+#define COMPRESS_HASH_BITS			12
+#define COMPRESS_HASH_SIZE			(1 << COMPRESS_HASH_BITS)
+
+/* Memory layout: page offsets, hash table, page lengths, staging block, cached blocks, compressed page buffer, shuffled page buffer */
+#define COMPRESS_OFFSETS(cs)		((uint32_t*) (cs)->memory)
+#define COMPRESS_HASH(cs)			((uint16_t*) (COMPRESS_OFFSETS(cs) + (cs)->maxPages))
+#define COMPRESS_LENGTHS(cs)		(COMPRESS_HASH(cs) + COMPRESS_HASH_SIZE)
+#define COMPRESS_STAGING(cs)		((uint8_t*) (COMPRESS_LENGTHS(cs) + (cs)->maxPages))
+#define COMPRESS_BLOCK(cs, i)		(COMPRESS_STAGING(cs) + (uint32_t) ((i)+1) * (cs)->pageSize)
+#define COMPRESS_PAGE(cs)			COMPRESS_BLOCK(cs, COMPRESS_STORAGE_CACHED)
+#define COMPRESS_SHUFFLED(cs)		(COMPRESS_PAGE(cs) + (cs)->pageSize)
+
+typedef struct {
+	uint32_t	magic;
+	uint32_t	sequence;
+	uint32_t	pageSize;
+	uint32_t	shuffle;
+	uint32_t	logEnd;
+	uint32_t	lastMap;
+	uint32_t	numPages;
+	uint32_t	checksum;
+} compressHeader;
+
+/**
+@brief     	Returns number of bytes of memory required for page map and buffers.
+@param		pageSize
+                Size of page in bytes
+@param		maxPages
+                Maximum number of pages
+@return		Number of bytes to allocate for memory
+*/
+uint32_t compressStorageMemorySize(count_t pageSize, id_t maxPages)
+{
+	return maxPages * (sizeof(uint32_t) + sizeof(uint16_t)) + COMPRESS_HASH_SIZE * sizeof(uint16_t) + (3 + COMPRESS_STORAGE_CACHED) * (uint32_t) pageSize;
+}
+
+static uint32_t compressRead32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(uint32_t));
+	return v;
+}
+
+/**
+@brief     	Writes length of literals or match beyond value stored in token (LZ4 format).
+@param		out
+                Output position
+@param		len
+                Length minus 15
+@return		Output position after length bytes
+*/
+static uint8_t* compressWriteLength(uint8_t *out, uint32_t len)
+{
+	for ( ; len >= 255; len -= 255)
+		*out++ = 255;
+	*out++ = (uint8_t) len;
+	return out;
+}
+
+/**
+@brief     	Compresses data into LZ4 block format.
+@param		src
+                Data to compress
+@param		size
+                Size of data
+@param		dst
+                Output buffer
+@param		capacity
+                Size of output buffer
+@param		hash
+                Hash table of COMPRESS_HASH_SIZE entries
+@return		Compressed size or 0 if it does not fit in capacity.
+*/
+static uint32_t compressLZ4(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t capacity, uint16_t *hash)
+{
+	uint32_t ip = 0, anchor = 0, ref, h, misses = 0;
+	uint32_t limit = size > COMPRESS_MATCH_LIMIT ? size - COMPRESS_MATCH_LIMIT : 0, matchEnd = size - COMPRESS_LAST_LITERALS;
+	uint8_t *op = dst, *end = dst + capacity;
+
+	memset(hash, 0, COMPRESS_HASH_SIZE * sizeof(uint16_t));
+	while (ip < limit)
+	{
+		h = (compressRead32(src + ip) * 2654435761u) >> (32 - COMPRESS_HASH_BITS);
+		ref = hash[h];
+		hash[h] = (uint16_t) ip;
+		if (ref >= ip || compressRead32(src + ref) != compressRead32(src + ip))
+		{	/* Skip faster through data that does not match */
+			ip += 1 + (misses++ >> 5);
+			continue;
+		}
+		misses = 0;
+
+		uint32_t match = COMPRESS_MIN_MATCH, literals = ip - anchor;
+		while (ip + match < matchEnd && src[ref + match] == src[ip + match])
+			match++;
+
+		/* Token, literals, offset and match length must fit */
+		if (op + 1 + literals + literals/255 + 1 + 2 + (match - COMPRESS_MIN_MATCH)/255 + 1 > end)
+			return 0;
+		uint8_t *token = op++;
+		*token = (uint8_t) ((literals < 15 ? literals : 15) << 4);
+		if (literals >= 15)
+			op = compressWriteLength(op, literals - 15);
+		memcpy(op, src + anchor, literals);
+		op += literals;
+		*op++ = (uint8_t) (ip - ref);
+		*op++ = (uint8_t) ((ip - ref) >> 8);
+		*token |= (uint8_t) (match - COMPRESS_MIN_MATCH < 15 ? match - COMPRESS_MIN_MATCH : 15);
+		if (match - COMPRESS_MIN_MATCH >= 15)
+			op = compressWriteLength(op, match - COMPRESS_MIN_MATCH - 15);
+
+		ip += match;
+		anchor = ip;
+	}
+
+	/* Last literals */
+	uint32_t literals = size - anchor;
+	if (op + 1 + literals + literals/255 + 1 > end)
+		return 0;
+	*op = (uint8_t) ((literals < 15 ? literals : 15) << 4);
+	op++;
+	if (literals >= 15)
+		op = compressWriteLength(op, literals - 15);
+	memcpy(op, src + anchor, literals);
+	op += literals;
+	return (uint32_t) (op - dst);
+}
+
+/**
+@brief     	Decompresses LZ4 block.
+@param		src
+                Compressed data
+@param		size
+                Size of compressed data
+@param		dst
+                Output buffer
+@param		outSize
+                Size of decompressed data
+@return		Returns 0 if success, non-zero if data is not valid.
+*/
+static int8_t decompressLZ4(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t outSize)
+{
+	const uint8_t *ip = src, *ipEnd = src + size;
+	uint8_t *op = dst, *opEnd = dst + outSize;
+	uint32_t len, offset;
+
+	while (ip < ipEnd)
+	{
+		uint8_t token = *ip++;
+
+		/* Literals */
+		len = token >> 4;
+		if (len == 15)
+		{
+			do
+			{
+				if (ip >= ipEnd)
+					return -1;
+				len += *ip;
+			} while (*ip++ == 255);
+		}
+		if (len > (uint32_t) (ipEnd - ip) || len > (uint32_t) (opEnd - op))
+			return -1;
+		memcpy(op, ip, len);
+		ip += len;
+		op += len;
+		if (ip == ipEnd)
+			break;
+
+		/* Match */
+		if (ipEnd - ip < 2)
+			return -1;
+		offset = ip[0] | ((uint32_t) ip[1] << 8);
+		ip += 2;
+		len = (token & 15) + COMPRESS_MIN_MATCH;
+		if ((token & 15) == 15)
+		{
+			do
+			{
+				if (ip >= ipEnd)
+					return -1;
+				len += *ip;
+			} while (*ip++ == 255);
+		}
+		if (offset == 0 || offset > (uint32_t) (op - dst) || len > (uint32_t) (opEnd - op))
+			return -1;
+		if (offset == 1)
+			memset(op, op[-1], len);
+		else
+		{	/* Match may overlap output. Each copy of at most offset bytes is from bytes already written. */
+			for (uint32_t n, done = 0; done < len; done += n)
+			{
+				n = len - done < offset ? len - done : offset;
+				memcpy(op + done, op + done - offset, n);
+			}
+		}
+		op += len;
+	}
+	return op == opEnd ? 0 : -1;
+}
+
+/**
+@brief     	Transposes matrix of bytes (dst[c][r] = src[r][c]).
+@param		src
+                Matrix with rows * cols bytes
+@param		dst
+                Output matrix with cols * rows bytes
+@param		rows
+                Number of rows
+@param		cols
+                Number of columns
+*/
+static void compressTranspose(const uint8_t *src, uint8_t *dst, uint32_t rows, uint32_t cols)
+{
+	uint32_t r = 0, c;
+
+#ifdef COMPRESS_SSE2
+	/* Blocks of 16 x 16 bytes. Interleaving row i with row i+8 four times transposes a block. */
+	__m128i x[16], y[16];
+
+	for ( ; r + 16 <= rows; r += 16)
+	{
+		for (c=0; c + 16 <= cols; c += 16)
+		{
+			for (uint32_t i=0; i < 16; i++)
+				x[i] = _mm_loadu_si128((const __m128i*) (src + (r+i)*cols + c));
+			for (uint32_t k=0; k < 4; k++)
+			{
+				for (uint32_t i=0; i < 8; i++)
+				{
+					y[2*i] = _mm_unpacklo_epi8(x[i], x[i+8]);
+					y[2*i+1] = _mm_unpackhi_epi8(x[i], x[i+8]);
+				}
+				memcpy(x, y, sizeof(x));
+			}
+			for (uint32_t i=0; i < 16; i++)
+				_mm_storeu_si128((__m128i*) (dst + (c+i)*rows + r), x[i]);
+		}
+		for ( ; c < cols; c++)
+			for (uint32_t i=0; i < 16; i++)
+				dst[c*rows + r + i] = src[(r+i)*cols + c];
+	}
+#endif
+	for ( ; r < rows; r++)
+		for (c=0; c < cols; c++)
+			dst[c*rows + r] = src[r*cols + c];
+}
+
+/**
+@brief     	Groups bytes at same offset in each record (or restores page if unshuffle).
+			Bytes after last full record are not moved.
+@param		src
+                Page
+@param		dst
+                Output page
+@param		size
+                Size of page
+@param		stride
+                Record size
+@param		unshuffle
+                1 to restore shuffled page
+*/
+static void compressShuffle(const uint8_t *src, uint8_t *dst, uint32_t size, uint16_t stride, int8_t unshuffle)
+{
+	uint32_t n = size / stride;
+
+	if (unshuffle)
+		compressTranspose(src, dst, stride, n);
+	else
+		compressTranspose(src, dst, n, stride);
+	memcpy(dst + n*stride, src + n*stride, size - n*stride);
+}
+
+/**
+@brief     	Appends bytes to log. Staging block is written to base storage when full.
+@param		cs
+                Compressed storage state structure
+@param		data
+                Bytes to append
+@param		size
+                Number of bytes
+@return		Returns 0 if success, non-zero if failure.
+*/
+static int8_t compressStorageAppend(compressStorageState *cs, const void *data, uint32_t size)
+{
+	const uint8_t *p = (const uint8_t*) data;
+
+	while (size > 0)
+	{
+		uint32_t pos = cs->logEnd % cs->pageSize, n = cs->pageSize - pos;
+
+		if (n > size)
+			n = size;
+		memcpy(COMPRESS_STAGING(cs) + pos, p, n);
+		cs->logEnd += n;
+		p += n;
+		size -= n;
+		if (cs->logEnd % cs->pageSize == 0)
+		{	/* Block is full */
+			id_t block = cs->logEnd / cs->pageSize - 1;
+
+			for (uint8_t i=0; i < COMPRESS_STORAGE_CACHED; i++)
+				if (cs->cachedBlock[i] == block)
+					cs->cachedBlock[i] = COMPRESS_STORAGE_NONE;
+			cs->numBlockWrites++;
+			if (cs->base->writePage(cs->base, COMPRESS_STORAGE_LOG_START + block, cs->pageSize, COMPRESS_STAGING(cs)) != 0)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+@brief     	Copies bytes from log. Bytes in staging block are copied from memory.
+@param		cs
+                Compressed storage state structure
+@param		offset
+                Log offset of first byte
+@param		size
+                Number of bytes
+@param		data
+                Buffer to copy bytes into
+@return		Returns 0 if success, non-zero if failure.
+*/
+static int8_t compressStorageReadLog(compressStorageState *cs, uint32_t offset, uint32_t size, void *data)
+{
+	uint8_t *p = (uint8_t*) data;
+
+	if (offset + size > cs->logEnd)
+		return -1;
+	while (size > 0)
+	{
+		id_t block = offset / cs->pageSize;
+		uint32_t pos = offset % cs->pageSize, n = cs->pageSize - pos;
+		uint8_t *src = COMPRESS_STAGING(cs);
+
+		if (n > size)
+			n = size;
+		if (block != cs->logEnd / cs->pageSize)
+		{
+			uint8_t slot;
+
+			for (slot=0; slot < COMPRESS_STORAGE_CACHED && cs->cachedBlock[slot] != block; slot++);
+			if (slot == COMPRESS_STORAGE_CACHED)
+			{	/* Replace least recently used block */
+				slot = (cs->lastCached + 1) % COMPRESS_STORAGE_CACHED;
+				cs->cachedBlock[slot] = COMPRESS_STORAGE_NONE;
+				cs->numBlockReads++;
+				if (cs->base->readPage(cs->base, COMPRESS_STORAGE_LOG_START + block, cs->pageSize, COMPRESS_BLOCK(cs, slot)) != 0)
+					return -1;
+				cs->cachedBlock[slot] = block;
+			}
+			cs->lastCached = slot;
+			src = COMPRESS_BLOCK(cs, slot);
+		}
+		memcpy(p, src + pos, n);
+		offset += n;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/**
+@brief     	Sets storage functions and clears page map.
+@param		cs
+                Compressed storage state structure
+*/
+static void compressStorageSetup(compressStorageState *cs)
+{
+	cs->storage.init = compressStorageInit;
+	cs->storage.close = compressStorageClose;
+	cs->storage.readPage = compressStorageReadPage;
+	cs->storage.writePage = compressStorageWritePage;
+	cs->storage.flush = compressStorageFlush;
+	cs->storage.prefetchPage = NULL;
+	cs->storage.mapPage = NULL;
+	cs->storage.writePages = NULL;
+	cs->storage.readPages = NULL;
+
+	memset(COMPRESS_LENGTHS(cs), 0, cs->maxPages * sizeof(uint16_t));
+	memset(COMPRESS_STAGING(cs), 0, cs->pageSize);
+	cs->numPages = 0;
+	cs->logEnd = 0;
+	cs->flushedEnd = 0;
+	cs->lastMap = COMPRESS_STORAGE_NONE;
+	cs->sequence = 0;
+	for (uint8_t i=0; i < COMPRESS_STORAGE_CACHED; i++)
+		cs->cachedBlock[i] = COMPRESS_STORAGE_NONE;
+	cs->lastCached = 0;
+	cs->bytesIn = 0;
+	cs->bytesOut = 0;
+	cs->numBlockReads = 0;
+	cs->numBlockWrites = 0;
+}
+
+/**
+@brief     	Initializes storage with empty log. Base storage must be initialized.
+@param		state
+                Compressed storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t compressStorageInit(storageState *storage)
+{
+	compressStorageState *cs = (compressStorageState*) storage;
+
+	if (cs->base == NULL || cs->memory == NULL || cs->pageSize < sizeof(compressHeader) || cs->shuffle > cs->pageSize)
+		return -1;
+	compressStorageSetup(cs);
+	return 0;
+}
+
+/**
+@brief     	Opens existing storage (see sbtreeOpen()). Base storage must be opened. Reads latest valid header
+			and page map. Pages written after the last flush are not recovered.
+@param		state
+                Compressed storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. no valid header).
+*/
+int8_t compressStorageOpen(storageState *storage)
+{
+	compressStorageState *cs = (compressStorageState*) storage;
+	crc32cFunc crc = crc32cSelect(CRC32C_BEST);
+	compressHeader header, best = {0};
+	uint32_t map, prev, count, offset;
+	uint8_t entry[COMPRESS_MAP_ENTRY_SIZE];
+	id_t pageNum;
+	uint16_t len;
+	int8_t found = 0;
+
+	if (compressStorageInit(storage) != 0)
+		return -1;
+
+	/* Header with highest sequence number that is valid */
+	for (id_t i=0; i < COMPRESS_STORAGE_LOG_START; i++)
+	{
+		if (cs->base->readPage(cs->base, i, cs->pageSize, COMPRESS_BLOCK(cs, 0)) != 0)
+			continue;
+		memcpy(&header, COMPRESS_BLOCK(cs, 0), sizeof(compressHeader));
+		if (header.magic != COMPRESS_HEADER_MAGIC || header.pageSize != cs->pageSize || header.shuffle != cs->shuffle
+			|| header.checksum != crc(0, &header, sizeof(compressHeader) - sizeof(uint32_t)) || header.numPages > cs->maxPages)
+			continue;
+		if (!found || header.sequence > best.sequence)
+			best = header;
+		found = 1;
+	}
+	if (!found)
+		return -1;
+
+	cs->sequence = best.sequence;
+	cs->logEnd = best.logEnd;
+	cs->flushedEnd = best.logEnd;
+	cs->lastMap = best.lastMap;
+	cs->numPages = best.numPages;
+	if (cs->logEnd % cs->pageSize != 0
+		&& cs->base->readPage(cs->base, COMPRESS_STORAGE_LOG_START + cs->logEnd / cs->pageSize, cs->pageSize, COMPRESS_STAGING(cs)) != 0)
+		return -1;
+
+	/* Map chunks from newest to oldest. Newest entry for a page is used. */
+	for (map = cs->lastMap; map != COMPRESS_STORAGE_NONE; map = prev)
+	{
+		if (compressStorageReadLog(cs, map, sizeof(uint32_t), &prev) != 0
+			|| compressStorageReadLog(cs, map + sizeof(uint32_t), sizeof(uint32_t), &count) != 0)
+			return -1;
+		if (prev != COMPRESS_STORAGE_NONE && prev >= map)
+			return -1;		/* Previous chunk is always earlier in log */
+		map += 2*sizeof(uint32_t);
+		for (uint32_t i=0; i < count; i++, map += COMPRESS_MAP_ENTRY_SIZE)
+		{
+			if (compressStorageReadLog(cs, map, COMPRESS_MAP_ENTRY_SIZE, entry) != 0)
+				return -1;
+			memcpy(&pageNum, entry, sizeof(id_t));
+			memcpy(&offset, entry + sizeof(id_t), sizeof(uint32_t));
+			memcpy(&len, entry + sizeof(id_t) + sizeof(uint32_t), sizeof(uint16_t));
+			if (pageNum >= cs->numPages || len == 0 || len > cs->pageSize)
+				return -1;
+			if (COMPRESS_LENGTHS(cs)[pageNum] == 0)
+			{
+				COMPRESS_OFFSETS(cs)[pageNum] = offset;
+				COMPRESS_LENGTHS(cs)[pageNum] = len;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+@brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
+@param     	state
+                Compressed storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure (e.g. page not written).
+*/
+int8_t compressStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{
+	compressStorageState *cs = (compressStorageState*) storage;
+	uint16_t len;
+
+	if (pageNum >= cs->numPages || pageSize != cs->pageSize || (len = COMPRESS_LENGTHS(cs)[pageNum]) == 0)
+		return -1;		/* Invalid page requested */
+
+	if (len == cs->pageSize)
+		return compressStorageReadLog(cs, COMPRESS_OFFSETS(cs)[pageNum], len, buffer);
+
+	if (compressStorageReadLog(cs, COMPRESS_OFFSETS(cs)[pageNum], len, COMPRESS_PAGE(cs)) != 0)
+		return -1;
+	if (cs->shuffle == 0)
+		return decompressLZ4(COMPRESS_PAGE(cs), len, (uint8_t*) buffer, pageSize);
+	if (decompressLZ4(COMPRESS_PAGE(cs), len, COMPRESS_SHUFFLED(cs), pageSize) != 0)
+		return -1;
+	compressShuffle(COMPRESS_SHUFFLED(cs), (uint8_t*) buffer, pageSize, cs->shuffle, 1);
+	return 0;
+}
+
+/**
+@brief      Compresses page and appends it to log. Page is stored uncompressed if it does not compress.
+			Writing a page again appends a new copy.
+@param     	state
+                Compressed storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to buffer to copy data from
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t compressStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{
+	compressStorageState *cs = (compressStorageState*) storage;
+	uint32_t offset = cs->logEnd, len;
+	void *data = COMPRESS_PAGE(cs);
+
+	if (pageNum >= cs->maxPages || pageSize != cs->pageSize)
+		return -1;		/* Invalid page requested */
+
+	if (cs->shuffle != 0)
+	{
+		compressShuffle((const uint8_t*) buffer, COMPRESS_SHUFFLED(cs), pageSize, cs->shuffle, 0);
+		len = compressLZ4(COMPRESS_SHUFFLED(cs), pageSize, COMPRESS_PAGE(cs), pageSize - 1, COMPRESS_HASH(cs));
+	}
+	else
+		len = compressLZ4((const uint8_t*) buffer, pageSize, COMPRESS_PAGE(cs), pageSize - 1, COMPRESS_HASH(cs));
+	if (len == 0)
+	{	/* Does not compress */
+		len = pageSize;
+		data = buffer;
+	}
+	if (compressStorageAppend(cs, data, len) != 0)
+		return -1;
+
+	COMPRESS_OFFSETS(cs)[pageNum] = offset;
+	COMPRESS_LENGTHS(cs)[pageNum] = (uint16_t) len;
+	if (pageNum >= cs->numPages)
+		cs->numPages = pageNum + 1;
+	cs->bytesIn += pageSize;
+	cs->bytesOut += len;
+	return 0;
+}
+
+/**
+@brief     	Writes partial log block and map entries for pages written since last flush, then a header
+			referencing them. Flushes base storage.
+@param     	state
+                Compressed storage state structure
+*/
+void compressStorageFlush(storageState *storage)
+{
+	compressStorageState *cs = (compressStorageState*) storage;
+	uint32_t mapStart = cs->logEnd, count = 0;
+	uint8_t entry[COMPRESS_MAP_ENTRY_SIZE];
+	compressHeader header;
+
+	if (cs->logEnd == cs->flushedEnd)
+	{	/* Nothing written since last flush */
+		cs->base->flush(cs->base);
+		return;
+	}
+
+	/* Map chunk: previous chunk, count, then entries of pages written since last flush */
+	for (id_t i=0; i < cs->numPages; i++)
+		if (COMPRESS_LENGTHS(cs)[i] != 0 && COMPRESS_OFFSETS(cs)[i] >= cs->flushedEnd)
+			count++;
+	if (compressStorageAppend(cs, &cs->lastMap, sizeof(uint32_t)) != 0 || compressStorageAppend(cs, &count, sizeof(uint32_t)) != 0)
+		return;
+	for (id_t i=0; i < cs->numPages; i++)
+	{
+		if (COMPRESS_LENGTHS(cs)[i] == 0 || COMPRESS_OFFSETS(cs)[i] < cs->flushedEnd || COMPRESS_OFFSETS(cs)[i] >= mapStart)
+			continue;
+		memcpy(entry, &i, sizeof(id_t));
+		memcpy(entry + sizeof(id_t), &COMPRESS_OFFSETS(cs)[i], sizeof(uint32_t));
+		memcpy(entry + sizeof(id_t) + sizeof(uint32_t), &COMPRESS_LENGTHS(cs)[i], sizeof(uint16_t));
+		if (compressStorageAppend(cs, entry, COMPRESS_MAP_ENTRY_SIZE) != 0)
+			return;
+	}
+
+	/* Partial block is written again when it is full */
+	if (cs->logEnd % cs->pageSize != 0)
+	{
+		cs->numBlockWrites++;
+		if (cs->base->writePage(cs->base, COMPRESS_STORAGE_LOG_START + cs->logEnd / cs->pageSize, cs->pageSize, COMPRESS_STAGING(cs)) != 0)
+			return;
+	}
+	/* Log is on storage before header references it */
+	cs->base->flush(cs->base);
+
+	cs->lastMap = mapStart;
+	cs->flushedEnd = cs->logEnd;
+	cs->sequence++;
+	header.magic = COMPRESS_HEADER_MAGIC;
+	header.sequence = cs->sequence;
+	header.pageSize = cs->pageSize;
+	header.shuffle = cs->shuffle;
+	header.logEnd = cs->logEnd;
+	header.lastMap = cs->lastMap;
+	header.numPages = cs->numPages;
+	header.checksum = crc32cSelect(CRC32C_BEST)(0, &header, sizeof(compressHeader) - sizeof(uint32_t));
+
+	memset(COMPRESS_BLOCK(cs, 0), 0, cs->pageSize);
+	memcpy(COMPRESS_BLOCK(cs, 0), &header, sizeof(compressHeader));
+	cs->cachedBlock[0] = COMPRESS_STORAGE_NONE;
+	cs->numBlockWrites++;
+	cs->base->writePage(cs->base, cs->sequence % COMPRESS_STORAGE_LOG_START, cs->pageSize, COMPRESS_BLOCK(cs, 0));
+	cs->base->flush(cs->base);
+}
+
+/**
+@brief     	Closes base storage. Pages written after the last flush are not persisted.
+@param     	state
+                Compressed storage state structure
+*/
+void compressStorageClose(storageState *storage)
+{
+	compressStorageState *cs = (compressStorageState*) storage;
+
+	cs->base->close(cs->base);
+}
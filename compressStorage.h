@@ -0,0 +1,159 @@
+/******************************************************************************/
+/**
+@file		compressStorage.h
+@author		Ramon Lawrence
+@brief		Storage that compresses pages (LZ4 block format) into a log in another storage.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef COMPRESSSTORAGE_H
+#define COMPRESSSTORAGE_H
+
+#include <stdint.h>
+
+#include "storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Blocks 0 and 1 of base storage hold alternating headers. Log of compressed pages starts at this block. */
+#define COMPRESS_STORAGE_LOG_START	2
+
+/* Number of log blocks cached for reads (e.g. leaf block and interior node block during a scan) */
+#define COMPRESS_STORAGE_CACHED		2
+
+/* Log offset used when no page map has been written */
+#define COMPRESS_STORAGE_NONE		0xFFFFFFFF
+
+typedef struct {
+	storageState 	storage;			/* Base struct defining read/write page functions */
+	storageState	*base;				/* Storage holding compressed pages in blocks of pageSize bytes (e.g. file or memory). Initialized or opened by caller. */
+	count_t			pageSize;			/* Size of page in bytes */
+	id_t			maxPages;			/* Maximum number of pages (size of page map) */
+	uint16_t		shuffle;			/* Record size for byte shuffle before compression (bytes at same offset in each record are grouped). 0 for no shuffle. */
+	void			*memory;			/* Pre-allocated memory of compressStorageMemorySize() bytes for page map and buffers */
+	id_t			numPages;			/* One more than largest page id written */
+	uint32_t		logEnd;				/* Bytes used in log */
+	uint32_t		flushedEnd;			/* Log end at last flush. Map entries for pages at or after this offset are written at next flush. */
+	uint32_t		lastMap;			/* Log offset of last page map chunk written. COMPRESS_STORAGE_NONE if none. */
+	uint32_t		sequence;			/* Sequence number of last header written */
+	id_t			cachedBlock[COMPRESS_STORAGE_CACHED];	/* Log block in each block buffer. COMPRESS_STORAGE_NONE if none. */
+	uint8_t			lastCached;			/* Most recently used block buffer */
+	uint32_t		bytesIn;			/* Bytes of pages written */
+	uint32_t		bytesOut;			/* Bytes of compressed pages written to log */
+	uint32_t		numBlockReads;		/* Number of block reads from base storage */
+	uint32_t		numBlockWrites;		/* Number of block writes to base storage */
+} compressStorageState;
+
+
+/**
+@brief     	Returns number of bytes of memory required for page map and buffers.
+@param		pageSize
+                Size of page in bytes
+@param		maxPages
+                Maximum number of pages
+@return		Number of bytes to allocate for memory
+*/
+uint32_t compressStorageMemorySize(count_t pageSize, id_t maxPages);
+
+
+/**
+@brief     	Initializes storage with empty log. Base storage must be initialized.
+@param		state
+                Compressed storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t compressStorageInit(storageState *storage);
+
+
+/**
+@brief     	Opens existing storage (see sbtreeOpen()). Base storage must be opened. Reads latest valid header
+			and page map. Pages written after the last flush are not recovered.
+@param		state
+                Compressed storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. no valid header).
+*/
+int8_t compressStorageOpen(storageState *storage);
+
+
+/**
+@brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
+@param     	state
+                Compressed storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure (e.g. page not written).
+*/
+int8_t compressStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Compresses page and appends it to log. Page is stored uncompressed if it does not compress.
+			Writing a page again appends a new copy.
+@param     	state
+                Compressed storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to buffer to copy data from
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t compressStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
+
+
+/**
+@brief     	Writes partial log block and map entries for pages written since last flush, then a header
+			referencing them. Flushes base storage.
+@param     	state
+                Compressed storage state structure
+*/
+void compressStorageFlush(storageState *storage);
+
+
+/**
+@brief     	Closes base storage. Pages written after the last flush are not persisted.
+@param     	state
+                Compressed storage state structure
+*/
+void compressStorageClose(storageState *storage);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
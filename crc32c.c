@@ -0,0 +1,179 @@
+/******************************************************************************/
+/**
+@file		crc32c.c
+@author		Ramon Lawrence
+@brief		CRC32C (Castagnoli) checksum with SSE4.2 acceleration and table-driven fallback.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#include <stdint.h>
+#include <string.h>
+
+#include "crc32c.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32C_X86
+#include <immintrin.h>
+#endif
+
+/* Reflected CRC32C polynomial */
+#define CRC32C_POLY		0x82F63B78
+
+/* Table of CRC of each byte value. Calculated by crc32cSelect(). */
+static uint32_t crc32cTable[256];
+
+/* Bytes per lane. SSE4.2 version computes three lanes in parallel as crc32 instruction has latency of 3 cycles. */
+#define CRC32C_LANE		128
+
+/* Tables to shift CRC over CRC32C_LANE zero bytes (one table per CRC byte). Calculated by crc32cSelect(). */
+static uint32_t crc32cShiftTable[4][256];
+
+/**
+@brief     	Returns CRC register after CRC32C_LANE zero bytes are processed. Used to combine lanes:
+			CRC of A followed by B is shift(CRC of A) xor (CRC of B starting from 0).
+*/
+static uint32_t crc32cShift(uint32_t crc)
+{
+	return crc32cShiftTable[0][crc & 0xFF] ^ crc32cShiftTable[1][(crc >> 8) & 0xFF]
+		^ crc32cShiftTable[2][(crc >> 16) & 0xFF] ^ crc32cShiftTable[3][crc >> 24];
+}
+
+/**
+@brief     	Updates CRC32C one byte at a time using table. Portable version.
+*/
+static uint32_t crc32cTableUpdate(uint32_t crc, const void *data, uint32_t size)
+{
+	const uint8_t *p = (const uint8_t*) data;
+
+	crc = ~crc;
+	while (size-- > 0)
+		crc = crc32cTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+#ifdef CRC32C_X86
+/**
+@brief     	Updates CRC32C using SSE4.2 crc32 instruction. Processes 8 bytes (4 bytes on 32-bit x86) per instruction.
+			On x86-64, three lanes of CRC32C_LANE bytes are processed in parallel and combined.
+*/
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSSE42(uint32_t crc, const void *data, uint32_t size)
+{
+	const uint8_t *p = (const uint8_t*) data;
+
+	crc = ~crc;
+#ifdef __x86_64__
+	uint64_t c = crc, v, c1, c2, v1, v2;
+	uint32_t i;
+	for ( ; size >= 3*CRC32C_LANE; size -= 3*CRC32C_LANE, p += 3*CRC32C_LANE)
+	{
+		c1 = 0;
+		c2 = 0;
+		for (i=0; i < CRC32C_LANE; i += sizeof(uint64_t))
+		{
+			memcpy(&v, p+i, sizeof(uint64_t));
+			memcpy(&v1, p+CRC32C_LANE+i, sizeof(uint64_t));
+			memcpy(&v2, p+2*CRC32C_LANE+i, sizeof(uint64_t));
+			c = _mm_crc32_u64(c, v);
+			c1 = _mm_crc32_u64(c1, v1);
+			c2 = _mm_crc32_u64(c2, v2);
+		}
+		c = crc32cShift(crc32cShift((uint32_t) c) ^ (uint32_t) c1) ^ (uint32_t) c2;
+	}
+	for ( ; size >= sizeof(uint64_t); size -= sizeof(uint64_t), p += sizeof(uint64_t))
+	{
+		memcpy(&v, p, sizeof(uint64_t));
+		c = _mm_crc32_u64(c, v);
+	}
+	crc = (uint32_t) c;
+#endif
+	uint32_t w;
+	for ( ; size >= sizeof(uint32_t); size -= sizeof(uint32_t), p += sizeof(uint32_t))
+	{
+		memcpy(&w, p, sizeof(uint32_t));
+		crc = _mm_crc32_u32(crc, w);
+	}
+	while (size-- > 0)
+		crc = _mm_crc32_u8(crc, *p++);
+	return ~crc;
+}
+#endif
+
+/**
+@brief     	Returns CRC32C function for given implementation level.
+			CPU features are checked at runtime.
+@param     	level
+                Implementation level (CRC32C_BEST for best supported by CPU)
+@return		Function or NULL if implementation level is not supported.
+*/
+crc32cFunc crc32cSelect(uint8_t level)
+{
+	uint32_t i, n, crc;
+	int8_t	k;
+
+	/* Tables are built on first call */
+	if (crc32cTable[1] == 0)
+	{
+		for (i=0; i < 256; i++)
+		{
+			crc = i;
+			for (k=0; k < 8; k++)
+				crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+			crc32cTable[i] = crc;
+		}
+		for (k=0; k < 4; k++)
+		{
+			for (i=0; i < 256; i++)
+			{
+				crc = i << (8*k);
+				for (n=0; n < CRC32C_LANE; n++)
+					crc = crc32cTable[crc & 0xFF] ^ (crc >> 8);
+				crc32cShiftTable[k][i] = crc;
+			}
+		}
+	}
+
+#ifdef CRC32C_X86
+	__builtin_cpu_init();
+	int8_t hasSSE42 = __builtin_cpu_supports("sse4.2") != 0;
+
+	if (level == CRC32C_BEST)
+		level = hasSSE42 ? CRC32C_SSE42 : CRC32C_TABLE;
+
+	if (level == CRC32C_SSE42)
+		return hasSSE42 ? crc32cSSE42 : NULL;
+#else
+	if (level == CRC32C_BEST)
+		level = CRC32C_TABLE;
+#endif
+	if (level != CRC32C_TABLE)
+		return NULL;
+	return crc32cTableUpdate;
+}
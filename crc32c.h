@@ -0,0 +1,69 @@
+/******************************************************************************/
+/**
+@file		crc32c.h
+@author		Ramon Lawrence
+@brief		CRC32C (Castagnoli) checksum with SSE4.2 acceleration and table-driven fallback.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Implementation levels for crc32cSelect() */
+#define CRC32C_BEST		0		/* Best implementation supported by CPU */
+#define CRC32C_TABLE	1		/* Portable C (256 entry table) */
+#define CRC32C_SSE42	2		/* x86 SSE4.2 crc32 instruction */
+
+/*
+Updates CRC32C checksum crc with size bytes of data. Use crc of 0 for first call.
+Checksum of data split over several calls is the same as for one call.
+*/
+typedef uint32_t (*crc32cFunc)(uint32_t crc, const void *data, uint32_t size);
+
+/**
+@brief     	Returns CRC32C function for given implementation level.
+			CPU features are checked at runtime.
+@param     	level
+                Implementation level (CRC32C_BEST for best supported by CPU)
+@return		Function or NULL if implementation level is not supported.
+*/
+crc32cFunc crc32cSelect(uint8_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -38,6 +38,130 @@
 
 #include "dbbuffer.h"
 
+/**
+@brief     	Returns number of hash table entries required for a buffer with given number of pages.
+@param     	numPages
+                Number of buffer pages
+@return		Number of entries to allocate for hashTable
+*/
+uint32_t dbbufferHashSize(count_t numPages)
+{
+	/* Keep load factor at or below 0.5 so probe sequences stay short */
+	uint32_t size = 4;
+	while (size < 2 * (uint32_t) numPages)
+		size <<= 1;
+	return size;
+}
+
+/**
+@brief     	Returns home slot in hash table for a page id.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+*/
+static uint32_t dbbufferHash(dbbuffer *state, id_t pageNum)
+{
+	/* Multiplicative hash. Consecutive page ids map to distinct slots. */
+	return (pageNum * 2654435761u) & (state->hashSize - 1);
+}
+
+/**
+@brief     	Returns buffer id containing page or BUFFER_HASH_EMPTY if page is not in the buffer.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+*/
+static count_t dbbufferHashFind(dbbuffer *state, id_t pageNum)
+{
+	uint32_t h = dbbufferHash(state, pageNum);
+
+	while (state->hashTable[h] != BUFFER_HASH_EMPTY)
+	{
+		if (state->status[state->hashTable[h]] == pageNum)
+			return state->hashTable[h];
+		h = (h + 1) & (state->hashSize - 1);
+	}
+	return BUFFER_HASH_EMPTY;
+}
+
+/**
+@brief     	Adds mapping from page id (stored in status array) to buffer id.
+@param     	state
+                DBbuffer state structure
+@param     	bufferNum
+                Buffer id. status[bufferNum] must already contain the page id.
+*/
+static void dbbufferHashInsert(dbbuffer *state, count_t bufferNum)
+{
+	uint32_t h = dbbufferHash(state, state->status[bufferNum]);
+
+	while (state->hashTable[h] != BUFFER_HASH_EMPTY)
+		h = (h + 1) & (state->hashSize - 1);
+	state->hashTable[h] = bufferNum;
+}
+
+/**
+@brief     	Removes mapping for page id. Uses backward shift deletion so no tombstones are required.
+			Must be called before status[] entry for the page is changed.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+*/
+static void dbbufferHashRemove(dbbuffer *state, id_t pageNum)
+{
+	uint32_t mask = state->hashSize - 1;
+	uint32_t i = dbbufferHash(state, pageNum), j, k;
+
+	while (state->hashTable[i] != BUFFER_HASH_EMPTY && state->status[state->hashTable[i]] != pageNum)
+		i = (i + 1) & mask;
+
+	if (state->hashTable[i] == BUFFER_HASH_EMPTY)
+		return;		/* Not present */
+
+	/* Shift back any following entries whose home slot is at or before the hole */
+	j = i;
+	while (1)
+	{
+		j = (j + 1) & mask;
+		if (state->hashTable[j] == BUFFER_HASH_EMPTY)
+			break;
+		k = dbbufferHash(state, state->status[state->hashTable[j]]);
+		if (((j - k) & mask) >= ((j - i) & mask))
+		{
+			state->hashTable[i] = state->hashTable[j];
+			i = j;
+		}
+	}
+	state->hashTable[i] = BUFFER_HASH_EMPTY;
+}
+
+/**
+@brief     	Changes the page stored in a buffer and keeps the hash table (if used) in sync.
+			Buffer 0 is the output buffer and is never indexed.
+@param     	state
+                DBbuffer state structure
+@param     	bufferNum
+                Buffer id
+@param     	pageNum
+                Physical page id (number) now stored in buffer
+*/
+static void dbbufferSetStatus(dbbuffer *state, count_t bufferNum, id_t pageNum)
+{
+	if (state->hashTable != NULL && bufferNum != 0)
+	{
+		if (state->status[bufferNum] != BUFFER_EMPTY_ID)
+			dbbufferHashRemove(state, state->status[bufferNum]);
+		state->status[bufferNum] = pageNum;
+		if (pageNum != BUFFER_EMPTY_ID)
+			dbbufferHashInsert(state, bufferNum);
+	}
+	else
+		state->status[bufferNum] = pageNum;
+}
+
 
 /**
 @brief     	Initializes buffer given page size and number of pages.
@@ -58,12 +182,99 @@ void dbbufferInit(dbbuffer *state)
 	state->bufferHits = 0;
 	state->lastHit = 0;
 	state->nextBufferPage = 1;
+	state->checksum = NULL;
+	state->numChecksumErrors = 0;
 
 	for (count_t l=0; l < state->numPages; l++)
 	{
 		state->status[l] = BUFFER_EMPTY_ID;	
 		state->modified[l] = NOT_MODIFIED_VAL;
 	}	
+
+	/* Always leave output buffer and at least one other buffer unpinned */
+	state->numPinned = 0;
+	state->maxPinned = 0;
+	if (state->pinLevel != NULL)
+	{
+		if (state->numPages > 2)
+			state->maxPinned = state->numPages - 2;
+		for (count_t l=0; l < state->numPages; l++)
+			state->pinLevel[l] = NOT_PINNED_VAL;
+	}
+
+	if (state->hashTable != NULL)
+	{
+		state->hashSize = dbbufferHashSize(state->numPages);
+		for (uint32_t h=0; h < state->hashSize; h++)
+			state->hashTable[h] = BUFFER_HASH_EMPTY;
+	}
+
+	if (state->policy != NULL)
+		state->policy->init(state);
+}
+
+/**
+@brief      Starts asynchronous read of page from storage if page is not in buffer.
+			A later readPage() of the page does not wait for the device.
+			No effect if storage does not support prefetch.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+*/
+void dbbufferPrefetch(dbbuffer *state, id_t pageNum)
+{
+	count_t i;
+
+	if (state->storage->prefetchPage == NULL)
+		return;
+
+	/* No read needed if page is in buffer */
+	if (state->hashTable != NULL)
+	{
+		if (dbbufferHashFind(state, pageNum) != BUFFER_HASH_EMPTY)
+			return;
+	}
+	else
+	{
+		for (i=1; i < state->numPages; i++)
+			if (state->status[i] == pageNum)
+				return;
+	}
+	state->storage->prefetchPage(state->storage, pageNum, state->pageSize);
+}
+
+/**
+@brief      Returns buffer page containing page and updates buffer hit statistics. Returns NULL if page is not in buffer.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+*/
+static void* dbbufferFindPage(dbbuffer *state, id_t pageNum)
+{
+	count_t i;
+
+	if (state->hashTable != NULL)
+	{
+		i = dbbufferHashFind(state, pageNum);
+		if (i == BUFFER_HASH_EMPTY)
+			return NULL;
+	}
+	else
+	{
+		for (i=1; i < state->numPages; i++)
+			if (state->status[i] == pageNum)
+				break;
+		if (i == state->numPages)
+			return NULL;
+	}
+
+	state->bufferHits++;
+	state->lastHit = pageNum;
+	if (state->policy != NULL)
+		state->policy->access(state, i);
+	return state->buffer + state->pageSize*i;
 }
 
 /**
@@ -80,21 +291,46 @@ void* readPage(dbbuffer *state, id_t pageNum)
 	count_t i;
 
 	/* Check to see if page is currently in buffer */
-	for (i=1; i < state->numPages; i++)
-	{
-		if (state->status[i] == pageNum)
-		{
-			state->bufferHits++;
-			buf = state->buffer + state->pageSize*i;
-			state->lastHit = state->status[i];
-			return buf;
-		}
-	}
+	buf = dbbufferFindPage(state, pageNum);
+	if (buf != NULL)
+		return buf;
 
 	if (state->numPages == 2)
 	{	buf = state->buffer + state->pageSize;
 		i = 1;
 	}
+	else if (state->policy != NULL)
+	{	/* Replacement policy selects page */
+		i = state->policy->victim(state);
+	}
+	else if (state->pinLevel != NULL)
+	{	/* Round robin over unpinned buffers. Root does not need reserved buffer as it is pinned. */
+		buf = NULL;
+		for (i=1; i < state->numPages; i++)
+		{
+			if (state->status[i] == BUFFER_EMPTY_ID && !DBBUFFER_IS_PINNED(state, i))
+			{	buf = state->buffer + state->pageSize*i;
+				break;
+			}
+		}
+
+		if (buf == NULL)
+		{	/* Avoid last hit page unless it is the only unpinned buffer */
+			count_t candidate = 0;
+			for (count_t n=1; n < state->numPages; n++)
+			{
+				if (state->nextBufferPage < 1 || state->nextBufferPage > state->numPages-1)
+					state->nextBufferPage = 1;
+				i = state->nextBufferPage++;
+				if (DBBUFFER_IS_PINNED(state, i))
+					continue;
+				candidate = i;
+				if (state->status[i] != state->lastHit)
+					break;
+			}
+			i = candidate;
+		}
+	}
 	else
 	{	
 		/* Reserve page #1 for root if have at least 3 buffers. */
@@ -148,11 +384,57 @@ void* readPage(dbbuffer *state, id_t pageNum)
 		state->activePath[modval] = writePage(state, buf);					
 	}
 
-	state->status[i] = pageNum;
+	dbbufferSetStatus(state, i, pageNum);
 	state->modified[i] = NOT_MODIFIED_VAL;
+	if (state->policy != NULL)
+		state->policy->load(state, i);
 	return readPageBuffer(state, pageNum, i);
 }
 
+/**
+@brief      Returns page if it is in buffer without reading it from storage.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+@return		Returns pointer to buffer page or NULL if page is not in buffer.
+*/
+void* dbbufferGetPage(dbbuffer *state, id_t pageNum)
+{
+	return dbbufferFindPage(state, pageNum);
+}
+
+/**
+@brief      Reads page for read-only access without copying it into a buffer page if storage supports it.
+			Page in buffer is returned from buffer (buffer may have newer version than storage).
+			Otherwise, returns pointer into storage memory that is valid until the next page write.
+			Uses readPage() if storage does not support mapping pages.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+@return		Returns pointer to page (must not be modified) or NULL if error.
+*/
+void* dbbufferReadPageZeroCopy(dbbuffer *state, id_t pageNum)
+{
+	void *buf;
+
+	if (state->storage->mapPage == NULL)
+		return readPage(state, pageNum);
+
+	buf = dbbufferFindPage(state, pageNum);
+	if (buf != NULL)
+		return buf;
+
+	buf = state->storage->mapPage(state->storage, pageNum, state->pageSize);
+	if (buf == NULL)
+		return readPage(state, pageNum);
+	state->numReads++;
+	if (dbbufferVerifyChecksum(state, buf) != 0)
+		return NULL;
+	return buf;
+}
+
 /**
 @brief      Reads page to a particular buffer number. Returns pointer to buffer if success.
 @param     	state
@@ -170,7 +452,13 @@ void* readPageBuffer(dbbuffer *state, id_t pageNum, count_t bufferNum)
 	state->storage->readPage(state->storage, pageNum, state->pageSize, buf);
 	
     state->numReads++;
-	   
+
+	/* Corrupt page is not kept in buffer */
+	if (dbbufferVerifyChecksum(state, buf) != 0)
+	{
+		dbbufferSetStatus(state, bufferNum, BUFFER_EMPTY_ID);
+		return NULL;
+	}
 	return buf;
 }
 
@@ -192,6 +480,7 @@ int32_t writePage(dbbuffer *state, void* buffer)
 	/* Setup page number in header */	
 	memcpy(buffer, &(state->nextPageId), sizeof(id_t));
 	state->nextPageId++;
+	dbbufferSetChecksum(state, buffer);
 	
 	/* Save page in storage */
 	state->storage->writePage(state->storage, pageNum, state->pageSize, buffer);
@@ -209,12 +498,90 @@ int32_t writePage(dbbuffer *state, void* buffer)
 	/* Update page number in the buffer */
 	count_t bufnum = (buffer - state->buffer) / state->pageSize;
 	// printf("Write buffer: %d Page: %d\n", bufnum, pageNum);
-	state->status[bufnum] = pageNum;
+	dbbufferSetStatus(state, bufnum, pageNum);
 	state->modified[bufnum] = NOT_MODIFIED_VAL;
 	state->numWrites++;
 	return pageNum;
 }
 
+/**
+@brief      Writes consecutive pages in memory outside the buffer (e.g. leaves built by bulk load) to storage.
+			Pages are written with one storage request if storage supports writePages. Pages are not cached in buffer.
+@param     	state
+                DBbuffer state structure
+@param     	pages
+                Memory containing count pages
+@param     	count
+                Number of pages
+@return		Returns physical page id of first page if success. -1 if failure.
+*/
+int32_t dbbufferWritePages(dbbuffer *state, void* pages, id_t count)
+{
+	int32_t pageNum = state->nextPageWriteId;
+	void	*buf;
+	id_t	i;
+
+	/* Setup page number in header of each page as in writePage() */
+	for (i=0; i < count; i++)
+	{
+		buf = (int8_t*) pages + (size_t) i*state->pageSize;
+		memcpy(buf, &(state->nextPageId), sizeof(id_t));
+		state->nextPageId++;
+		dbbufferSetChecksum(state, buf);
+	}
+
+	if (state->storage->writePages != NULL)
+	{
+		if (state->storage->writePages(state->storage, pageNum, count, state->pageSize, pages) != 0)
+			return -1;
+	}
+	else
+	{
+		for (i=0; i < count; i++)
+			if (state->storage->writePage(state->storage, pageNum+i, state->pageSize, (int8_t*) pages + (size_t) i*state->pageSize) != 0)
+				return -1;
+	}
+	state->nextPageWriteId += count;
+	state->numWrites += count;
+	return pageNum;
+}
+
+/**
+@brief      Reads consecutive pages from storage into memory outside the buffer (e.g. leaf read-ahead).
+			Pages are read with one storage request if storage supports readPages. Pages are not cached in buffer.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param     	count
+                Number of pages
+@param     	pages
+                Memory for count pages
+@return		Returns number of pages read before first page with invalid checksum. -1 if failure.
+*/
+int32_t dbbufferReadPages(dbbuffer *state, id_t pageNum, id_t count, void* pages)
+{
+	id_t	i;
+
+	if (state->storage->readPages != NULL)
+	{
+		if (state->storage->readPages(state->storage, pageNum, count, state->pageSize, pages) != 0)
+			return -1;
+	}
+	else
+	{
+		for (i=0; i < count; i++)
+			if (state->storage->readPage(state->storage, pageNum+i, state->pageSize, (int8_t*) pages + (size_t) i*state->pageSize) != 0)
+				return -1;
+	}
+	state->numReads += count;
+
+	for (i=0; i < count; i++)
+		if (dbbufferVerifyChecksum(state, (int8_t*) pages + (size_t) i*state->pageSize) != 0)
+			break;
+	return i;
+}
+
 /**
 @brief      Sets page buffer to be modified and associated active path level.
 @param     	state
@@ -231,6 +598,77 @@ void dbbufferSetModified(dbbuffer *state, void* buffer, uint8_t level)
 	state->modified[bufnum] = level;
 }
 
+/**
+@brief      Pins page buffer so it is not replaced. If the pin budget is used, takes the pin of another node
+			at the same level (unmodified preferred) or else of the deepest node below this level (larger level number).
+			Pinning an already pinned buffer updates its level.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                In memory buffer containing page
+@param		level
+				Tree level of node in buffer (0 is root)
+@return		Returns 1 if buffer is pinned, 0 otherwise.
+*/
+int8_t dbbufferPin(dbbuffer *state, void* buffer, uint8_t level)
+{
+	count_t bufnum = (buffer - state->buffer) / state->pageSize;
+	count_t i, replace = 0;
+
+	/* Page returned without copy is not in a buffer */
+	if (state->pinLevel == NULL || !DBBUFFER_IN_BUFFER(state, buffer) || bufnum == 0 || state->maxPinned == 0)
+		return 0;
+
+	if (state->pinLevel[bufnum] != NOT_PINNED_VAL)
+	{
+		state->pinLevel[bufnum] = level;
+		return 1;
+	}
+
+	if (state->numPinned >= state->maxPinned)
+	{	/* Budget used. Take pin from another node at same level (prefer unmodified), otherwise from deepest node below this level. */
+		for (i=1; i < state->numPages; i++)
+		{
+			if (state->pinLevel[i] == NOT_PINNED_VAL || state->pinLevel[i] < level)
+				continue;
+			if (replace == 0)
+				replace = i;
+			else if (state->pinLevel[i] == level)
+			{
+				if (state->pinLevel[replace] != level || (state->modified[replace] != NOT_MODIFIED_VAL && state->modified[i] == NOT_MODIFIED_VAL))
+					replace = i;
+			}
+			else if (state->pinLevel[replace] != level && state->pinLevel[i] > state->pinLevel[replace])
+				replace = i;
+		}
+		if (replace == 0)
+			return 0;
+		state->pinLevel[replace] = NOT_PINNED_VAL;
+		state->numPinned--;
+	}
+
+	state->pinLevel[bufnum] = level;
+	state->numPinned++;
+	return 1;
+}
+
+/**
+@brief      Unpins page buffer so it can be replaced.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                In memory buffer containing page
+*/
+void dbbufferUnpin(dbbuffer *state, void* buffer)
+{
+	count_t bufnum = (buffer - state->buffer) / state->pageSize;
+
+	if (state->pinLevel == NULL || !DBBUFFER_IN_BUFFER(state, buffer) || state->pinLevel[bufnum] == NOT_PINNED_VAL)
+		return;
+	state->pinLevel[bufnum] = NOT_PINNED_VAL;
+	state->numPinned--;
+}
+
 /**
 @brief      Clear modified flag if page is present in a buffer.
 @param     	state
@@ -241,11 +679,29 @@ void dbbufferSetModified(dbbuffer *state, void* buffer, uint8_t level)
 */
 void dbbufferClearModified(dbbuffer *state, id_t pageNum)
 {
-	for (uint8_t i=0; i < state->numPages; i++)
+	count_t i;
+
+	if (state->hashTable != NULL)
+	{	/* Output buffer 0 is not indexed */
+		if (state->status[0] == pageNum)
+			i = 0;
+		else
+			i = dbbufferHashFind(state, pageNum);
+		if (i != BUFFER_HASH_EMPTY)
+		{
+			dbbufferSetStatus(state, i, BUFFER_EMPTY_ID);
+			state->modified[i] = NOT_MODIFIED_VAL;
+			dbbufferUnpin(state, state->buffer + i * state->pageSize);
+		}
+		return;
+	}
+
+	for (i=0; i < state->numPages; i++)
 		if (state->status[i] == pageNum)
 		{
 			state->status[i] = BUFFER_EMPTY_ID;
 			state->modified[i] = NOT_MODIFIED_VAL;
+			dbbufferUnpin(state, state->buffer + i * state->pageSize);
 			break;
 		}
 }
@@ -306,3 +762,57 @@ void dbbufferClearStats(dbbuffer *state)
 	state->numWrites = 0;
 	state->bufferHits = 0;	
 }
+
+/**
+@brief      Calculates checksum of page excluding checksum field.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                Page
+@return		Returns checksum.
+*/
+static uint32_t dbbufferPageChecksum(dbbuffer *state, void* buffer)
+{
+	uint32_t crc = state->checksum(0, buffer, DBBUFFER_CHECKSUM_OFFSET);
+	return state->checksum(crc, (int8_t*) buffer + DBBUFFER_CHECKSUM_OFFSET + sizeof(uint32_t), state->pageSize - DBBUFFER_CHECKSUM_OFFSET - sizeof(uint32_t));
+}
+
+/**
+@brief      Stores checksum of page in page header. No effect if checksum is not used.
+			Called by writePage(). Only needed for pages written directly to storage.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                In memory buffer containing page
+*/
+void dbbufferSetChecksum(dbbuffer *state, void* buffer)
+{
+	uint32_t crc;
+
+	if (state->checksum == NULL)
+		return;
+	crc = dbbufferPageChecksum(state, buffer);
+	memcpy((int8_t*) buffer + DBBUFFER_CHECKSUM_OFFSET, &crc, sizeof(uint32_t));
+}
+
+/**
+@brief      Verifies checksum stored in page header. Called for pages read from storage by readPageBuffer()
+			and dbbufferReadPageZeroCopy(). Counts mismatches in numChecksumErrors.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                Page to verify
+@return		Returns 0 if checksum matches or checksum is not used. Non-zero value if page is corrupt.
+*/
+int8_t dbbufferVerifyChecksum(dbbuffer *state, void* buffer)
+{
+	uint32_t crc;
+
+	if (state->checksum == NULL)
+		return 0;
+	memcpy(&crc, (int8_t*) buffer + DBBUFFER_CHECKSUM_OFFSET, sizeof(uint32_t));
+	if (crc == dbbufferPageChecksum(state, buffer))
+		return 0;
+	state->numChecksumErrors++;
+	return -1;
+}
@@ -40,17 +40,39 @@
 #include <stdio.h>
 
 #include "storage.h"
+#include "crc32c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 #define BUFFER_EMPTY_ID		2147483647
 
 #define NOT_MODIFIED_VAL	100
 
+#define NOT_PINNED_VAL		100
+
+/* Returns 1 if buffer page is pinned and cannot be replaced */
+#define DBBUFFER_IS_PINNED(state, i)	((state)->pinLevel != NULL && (state)->pinLevel[i] != NOT_PINNED_VAL)
+
+/* Returns 1 if pointer is to a buffer page (0 for page returned without copy from storage) */
+#define DBBUFFER_IN_BUFFER(state, buf)	((int8_t*) (buf) >= (int8_t*) (state)->buffer && (int8_t*) (buf) < (int8_t*) (state)->buffer + (uint32_t) (state)->numPages*(state)->pageSize)
+
+/* Page checksum (if used) is stored after 4 byte page id and 2 byte count */
+#define DBBUFFER_CHECKSUM_OFFSET	6
+
+/* Marks an unused slot in the page lookup hash table */
+#define BUFFER_HASH_EMPTY	65535
+
 /* Define type for page ids (physical and logical). */
 typedef uint32_t id_t;
 
 /* Define type for page record count. */
 typedef uint16_t count_t;
 
+struct dbbufferPolicy;
+typedef struct dbbufferPolicy dbbufferPolicy;
+
 typedef struct {
 	id_t*  	status;					/* Contents of buffer (physical page id)  */    
 	void*  	buffer;					/* Allocated memory for buffer */
@@ -66,8 +88,35 @@ typedef struct {
 	count_t nextBufferPage;			/* Next page buffer id to use. Round robin */
 	id_t* 	activePath;				/* Active path on insert. Also contains root. Helps to prioritize. */
 	uint8_t* modified;				/* Flag to indicate if buffer has been modified and contains node of active path */
+	count_t* hashTable;				/* Optional page id to buffer id hash table (open addressing). Allocate dbbufferHashSize(numPages) entries or set to NULL to use linear scan. */
+	uint32_t hashSize;				/* Number of entries in hash table (power of 2, calculated during init()) */
+	const dbbufferPolicy* policy;	/* Optional replacement policy (see dbbufferPolicy.h). NULL uses round robin with root reserved in buffer 1. */
+	void*	policyData;				/* Memory for replacement policy state. Allocate policy->dataSize(numPages) bytes. */
+	uint8_t* pinLevel;				/* Optional tree level of node pinned in buffer or NOT_PINNED_VAL. Allocate numPages entries or set to NULL to disable pinning. */
+	count_t numPinned;				/* Number of pinned buffer pages */
+	count_t maxPinned;				/* Maximum pinned buffer pages (calculated during init() to leave one buffer for leaf pages) */
+	crc32cFunc checksum;			/* Page checksum function or NULL if pages have no checksum (set after init(), e.g. by sbtree with SBTREE_PAGE_CHECKSUM) */
+	id_t	numChecksumErrors;		/* Number of pages read with checksum that does not match */
 } dbbuffer;
 
+/* Buffer replacement policy interface. Policies manage buffers 1 to numPages-1 (buffer 0 is output buffer) and must not return pinned buffers. */
+struct dbbufferPolicy
+{
+	uint32_t (*dataSize)(count_t numPages);							/* Bytes of policyData required for given number of buffer pages */
+	void	(*init)(dbbuffer *state);									/* Initializes policy state */
+	void	(*access)(dbbuffer *state, count_t bufferNum);				/* Page in buffer was requested and found (buffer hit) */
+	count_t	(*victim)(dbbuffer *state);									/* Returns buffer to replace. Empty buffers should be used first. */
+	void	(*load)(dbbuffer *state, count_t bufferNum);				/* Page was read into buffer. status[bufferNum] contains page id. */
+};
+
+/**
+@brief     	Returns number of hash table entries required for a buffer with given number of pages.
+@param     	numPages
+                Number of buffer pages
+@return		Number of entries to allocate for hashTable
+*/
+uint32_t dbbufferHashSize(count_t numPages);
+
 /**
 @brief     	Initializes buffer given page size and number of pages.
 @param     	state
@@ -86,6 +135,29 @@ void dbbufferInit(dbbuffer *state);
 */
 void* readPage(dbbuffer *state, id_t pageNum);
 
+/**
+@brief      Returns page if it is in buffer without reading it from storage.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+@return		Returns pointer to buffer page or NULL if page is not in buffer.
+*/
+void* dbbufferGetPage(dbbuffer *state, id_t pageNum);
+
+/**
+@brief      Reads page for read-only access without copying it into a buffer page if storage supports it.
+			Page in buffer is returned from buffer (buffer may have newer version than storage).
+			Otherwise, returns pointer into storage memory that is valid until the next page write.
+			Uses readPage() if storage does not support mapping pages.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+@return		Returns pointer to page (must not be modified) or NULL if error.
+*/
+void* dbbufferReadPageZeroCopy(dbbuffer *state, id_t pageNum);
+
 /**
 @brief      Reads page to a particular buffer number. Returns pointer to buffer if success.
 @param     	state
@@ -108,6 +180,34 @@ void* readPageBuffer(dbbuffer *state, id_t pageNum, count_t bufferNum);
 */
 int32_t writePage(dbbuffer *state, void* buffer);
 
+/**
+@brief      Writes consecutive pages in memory outside the buffer (e.g. leaves built by bulk load) to storage.
+			Pages are written with one storage request if storage supports writePages. Pages are not cached in buffer.
+@param     	state
+                DBbuffer state structure
+@param     	pages
+                Memory containing count pages
+@param     	count
+                Number of pages
+@return		Returns physical page id of first page if success. -1 if failure.
+*/
+int32_t dbbufferWritePages(dbbuffer *state, void* pages, id_t count);
+
+/**
+@brief      Reads consecutive pages from storage into memory outside the buffer (e.g. leaf read-ahead).
+			Pages are read with one storage request if storage supports readPages. Pages are not cached in buffer.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param     	count
+                Number of pages
+@param     	pages
+                Memory for count pages
+@return		Returns number of pages read before first page with invalid checksum. -1 if failure.
+*/
+int32_t dbbufferReadPages(dbbuffer *state, id_t pageNum, id_t count, void* pages);
+
 
 /**
 @brief     	Initialize in-memory buffer page.
@@ -152,6 +252,29 @@ void dbbufferClearStats(dbbuffer *state);
 */
 void dbbufferSetModified(dbbuffer *state, void* buffer, uint8_t level);
 
+/**
+@brief      Pins page buffer so it is not replaced. If the pin budget is used, takes the pin of another node
+			at the same level (unmodified preferred) or else of the deepest node below this level (larger level number).
+			Pinning an already pinned buffer updates its level.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                In memory buffer containing page
+@param		level
+				Tree level of node in buffer (0 is root)
+@return		Returns 1 if buffer is pinned, 0 otherwise.
+*/
+int8_t dbbufferPin(dbbuffer *state, void* buffer, uint8_t level);
+
+/**
+@brief      Unpins page buffer so it can be replaced.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                In memory buffer containing page
+*/
+void dbbufferUnpin(dbbuffer *state, void* buffer);
+
 /**
 @brief      Clear modified flag if page is present in a buffer.
 @param     	state
@@ -162,4 +285,40 @@ void dbbufferSetModified(dbbuffer *state, void* buffer, uint8_t level);
 */
 void dbbufferClearModified(dbbuffer *state, id_t pageNum);
 
+/**
+@brief      Starts asynchronous read of page from storage if page is not in buffer.
+			A later readPage() of the page does not wait for the device.
+			No effect if storage does not support prefetch.
+@param     	state
+                DBbuffer state structure
+@param     	pageNum
+                Physical page id (number)
+*/
+void dbbufferPrefetch(dbbuffer *state, id_t pageNum);
+
+/**
+@brief      Stores checksum of page in page header. No effect if checksum is not used.
+			Called by writePage(). Only needed for pages written directly to storage.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                In memory buffer containing page
+*/
+void dbbufferSetChecksum(dbbuffer *state, void* buffer);
+
+/**
+@brief      Verifies checksum stored in page header. Called for pages read from storage by readPageBuffer()
+			and dbbufferReadPageZeroCopy(). Counts mismatches in numChecksumErrors.
+@param     	state
+                DBbuffer state structure
+@param     	buffer
+                Page to verify
+@return		Returns 0 if checksum matches or checksum is not used. Non-zero value if page is corrupt.
+*/
+int8_t dbbufferVerifyChecksum(dbbuffer *state, void* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,317 @@
+/******************************************************************************/
+/**
+@file		dbbufferPolicy.c
+@author		Ramon Lawrence
+@brief		Buffer replacement policies (CLOCK, LRU-2, 2Q).
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#include <string.h>
+
+#include "dbbufferPolicy.h"
+
+/*
+CLOCK policy
+*/
+typedef struct {
+	count_t hand;				/* Next buffer to examine */
+	uint8_t ref[];				/* Reference bit for each buffer */
+} clockData;
+
+/**
+@brief     	Returns bytes of policy state required for CLOCK.
+*/
+static uint32_t clockDataSize(count_t numPages)
+{
+	return sizeof(clockData) + numPages;
+}
+
+/**
+@brief     	Initializes CLOCK state. All reference bits cleared.
+*/
+static void clockInit(dbbuffer *state)
+{
+	clockData *d = (clockData*) state->policyData;
+	d->hand = 1;
+	memset(d->ref, 0, state->numPages);
+}
+
+/**
+@brief     	Sets reference bit on buffer hit.
+*/
+static void clockAccess(dbbuffer *state, count_t bufferNum)
+{
+	((clockData*) state->policyData)->ref[bufferNum] = 1;
+}
+
+/**
+@brief     	Advances clock hand until finds empty buffer or buffer with reference bit clear. Clears reference bits passed over.
+*/
+static count_t clockVictim(dbbuffer *state)
+{
+	clockData *d = (clockData*) state->policyData;
+	count_t i;
+
+	while (1)
+	{
+		i = d->hand++;
+		if (d->hand >= state->numPages)
+			d->hand = 1;
+
+		if (DBBUFFER_IS_PINNED(state, i))
+			continue;
+		if (state->status[i] == BUFFER_EMPTY_ID || d->ref[i] == 0)
+			return i;
+		d->ref[i] = 0;			/* Second chance */
+	}
+}
+
+/**
+@brief     	Newly loaded page starts with reference bit clear.
+*/
+static void clockLoad(dbbuffer *state, count_t bufferNum)
+{
+	((clockData*) state->policyData)->ref[bufferNum] = 0;
+}
+
+const dbbufferPolicy dbbufferClockPolicy = { clockDataSize, clockInit, clockAccess, clockVictim, clockLoad };
+
+/*
+LRU-2 policy
+*/
+/* Number of references after a reference that page cannot be evicted. Covers a root to leaf traversal (up to 8 levels). */
+#define LRU2_CORRELATED_PERIOD	8
+
+typedef struct {
+	uint32_t time;				/* Logical time (incremented on each reference) */
+	uint32_t hist[][2];			/* Time of last (0) and second last (1) reference for each buffer. 0 if none. */
+} lru2Data;
+
+/**
+@brief     	Returns bytes of policy state required for LRU-2.
+*/
+static uint32_t lru2DataSize(count_t numPages)
+{
+	return sizeof(lru2Data) + (uint32_t) numPages * 2 * sizeof(uint32_t);
+}
+
+/**
+@brief     	Initializes LRU-2 state. No reference history.
+*/
+static void lru2Init(dbbuffer *state)
+{
+	lru2Data *d = (lru2Data*) state->policyData;
+	d->time = 0;
+	memset(d->hist, 0, (size_t) state->numPages * 2 * sizeof(uint32_t));
+}
+
+/**
+@brief     	Records reference time on buffer hit.
+*/
+static void lru2Access(dbbuffer *state, count_t bufferNum)
+{
+	lru2Data *d = (lru2Data*) state->policyData;
+	d->hist[bufferNum][1] = d->hist[bufferNum][0];
+	d->hist[bufferNum][0] = ++d->time;
+}
+
+/**
+@brief     	Returns empty buffer or buffer with largest backward 2-distance that is outside correlated reference period.
+*/
+static count_t lru2Victim(dbbuffer *state)
+{
+	lru2Data *d = (lru2Data*) state->policyData;
+	count_t i, best = 0, any = 0;
+
+	for (i=1; i < state->numPages; i++)
+	{
+		if (DBBUFFER_IS_PINNED(state, i))
+			continue;
+		if (state->status[i] == BUFFER_EMPTY_ID)
+			return i;
+
+		/* Largest backward 2-distance is smallest second last reference. Ties (e.g. only referenced once) broken by LRU. */
+		if (any == 0 || d->hist[i][1] < d->hist[any][1] || (d->hist[i][1] == d->hist[any][1] && d->hist[i][0] < d->hist[any][0]))
+			any = i;
+
+		/* Pages referenced within correlated reference period are not eligible */
+		if (d->time - d->hist[i][0] < LRU2_CORRELATED_PERIOD)
+			continue;
+		if (best == 0 || d->hist[i][1] < d->hist[best][1] || (d->hist[i][1] == d->hist[best][1] && d->hist[i][0] < d->hist[best][0]))
+			best = i;
+	}
+	return best == 0 ? any : best;
+}
+
+/**
+@brief     	Newly loaded page has a single reference. History is not retained after eviction.
+*/
+static void lru2Load(dbbuffer *state, count_t bufferNum)
+{
+	lru2Data *d = (lru2Data*) state->policyData;
+	d->hist[bufferNum][1] = 0;
+	d->hist[bufferNum][0] = ++d->time;
+}
+
+const dbbufferPolicy dbbufferLRU2Policy = { lru2DataSize, lru2Init, lru2Access, lru2Victim, lru2Load };
+
+/*
+2Q policy
+*/
+#define TWOQ_NONE	0
+#define TWOQ_A1IN	1
+#define TWOQ_AM		2
+
+typedef struct {
+	uint32_t time;				/* Logical time (incremented on each reference) */
+	count_t	kin;				/* Maximum size of A1in (resident FIFO) */
+	count_t	kout;				/* Maximum size of A1out (page ids of pages evicted from A1in) */
+	count_t	inCount;			/* Current size of A1in */
+	count_t	outNext;			/* Next A1out slot to overwrite (circular) */
+	count_t	outCount;			/* Current size of A1out */
+	/* Followed by: id_t out[kout]; uint32_t stamp[numPages]; uint8_t queue[numPages]; */
+} twoQData;
+
+#define TWOQ_KIN(n)			((n) / 4 > 0 ? (n) / 4 : 1)
+#define TWOQ_KOUT(n)		((n) / 2 > 0 ? (n) / 2 : 1)
+#define TWOQ_OUT(d)			((id_t*) ((uint8_t*) (d) + sizeof(twoQData)))
+#define TWOQ_STAMP(d)		((uint32_t*) (TWOQ_OUT(d) + (d)->kout))
+#define TWOQ_QUEUE(d, n)	((uint8_t*) (TWOQ_STAMP(d) + (n)))
+
+/**
+@brief     	Returns bytes of policy state required for 2Q.
+*/
+static uint32_t twoQDataSize(count_t numPages)
+{
+	return sizeof(twoQData) + TWOQ_KOUT(numPages) * sizeof(id_t) + (uint32_t) numPages * (sizeof(uint32_t) + sizeof(uint8_t));
+}
+
+/**
+@brief     	Initializes 2Q state. A1in is 1/4 of buffers and A1out remembers 1/2 as many page ids as buffers.
+*/
+static void twoQInit(dbbuffer *state)
+{
+	twoQData *d = (twoQData*) state->policyData;
+	d->time = 0;
+	d->kin = TWOQ_KIN(state->numPages-1);
+	d->kout = TWOQ_KOUT(state->numPages);
+	d->inCount = 0;
+	d->outNext = 0;
+	d->outCount = 0;
+	memset(TWOQ_STAMP(d), 0, (size_t) state->numPages * sizeof(uint32_t));
+	memset(TWOQ_QUEUE(d, state->numPages), TWOQ_NONE, state->numPages);
+}
+
+/**
+@brief     	Updates 2Q state on buffer hit.
+*/
+static void twoQAccess(dbbuffer *state, count_t bufferNum)
+{
+	twoQData *d = (twoQData*) state->policyData;
+
+	/* Hits in A1in are not promoted (correlated references). Hits in Am move page to most recently used. */
+	if (TWOQ_QUEUE(d, state->numPages)[bufferNum] == TWOQ_AM)
+		TWOQ_STAMP(d)[bufferNum] = ++d->time;
+}
+
+/**
+@brief     	Returns empty buffer, oldest A1in page if A1in is over its limit, otherwise least recently used Am page.
+*/
+static count_t twoQVictim(dbbuffer *state)
+{
+	twoQData *d = (twoQData*) state->policyData;
+	uint32_t *stamp = TWOQ_STAMP(d);
+	uint8_t	 *queue = TWOQ_QUEUE(d, state->numPages);
+	count_t  i, best = 0;
+	uint8_t  fromQueue = d->inCount > d->kin ? TWOQ_A1IN : TWOQ_AM;
+
+	for (i=1; i < state->numPages; i++)
+	{
+		if (DBBUFFER_IS_PINNED(state, i))
+			continue;
+		if (state->status[i] == BUFFER_EMPTY_ID)
+		{	best = i;
+			break;
+		}
+		if (queue[i] == fromQueue && (best == 0 || stamp[i] < stamp[best]))
+			best = i;
+	}
+
+	if (best == 0)
+	{	/* Preferred queue is empty. Take oldest unpinned page from any queue. */
+		for (i=1; i < state->numPages; i++)
+			if (!DBBUFFER_IS_PINNED(state, i) && (best == 0 || stamp[i] < stamp[best]))
+				best = i;
+	}
+
+	if (queue[best] == TWOQ_A1IN)
+	{
+		if (state->status[best] != BUFFER_EMPTY_ID)
+		{	/* Remember page id so that a later reference promotes it to Am */
+			TWOQ_OUT(d)[d->outNext] = state->status[best];
+			d->outNext = (d->outNext + 1) % d->kout;
+			if (d->outCount < d->kout)
+				d->outCount++;
+		}
+		d->inCount--;
+	}
+	queue[best] = TWOQ_NONE;
+	return best;
+}
+
+/**
+@brief     	Places newly loaded page in Am if its id is in A1out, otherwise in A1in.
+*/
+static void twoQLoad(dbbuffer *state, count_t bufferNum)
+{
+	twoQData *d = (twoQData*) state->policyData;
+	id_t	 *out = TWOQ_OUT(d);
+	uint8_t	 *queue = TWOQ_QUEUE(d, state->numPages);
+	id_t	 pageNum = state->status[bufferNum];
+
+	if (queue[bufferNum] == TWOQ_A1IN)
+		d->inCount--;
+
+	queue[bufferNum] = TWOQ_A1IN;
+	for (count_t i=0; i < d->outCount; i++)
+	{
+		if (out[i] == pageNum)
+		{
+			queue[bufferNum] = TWOQ_AM;
+			out[i] = BUFFER_EMPTY_ID;
+			break;
+		}
+	}
+	if (queue[bufferNum] == TWOQ_A1IN)
+		d->inCount++;
+	TWOQ_STAMP(d)[bufferNum] = ++d->time;
+}
+
+const dbbufferPolicy dbbuffer2QPolicy = { twoQDataSize, twoQInit, twoQAccess, twoQVictim, twoQLoad };
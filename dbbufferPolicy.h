@@ -0,0 +1,58 @@
+/******************************************************************************/
+/**
+@file		dbbufferPolicy.h
+@author		Ramon Lawrence
+@brief		Buffer replacement policies (CLOCK, LRU-2, 2Q).
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef DBBUFFERPOLICY_H
+#define DBBUFFERPOLICY_H
+
+#include "dbbuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CLOCK (second chance). One reference bit per buffer page. */
+extern const dbbufferPolicy dbbufferClockPolicy;
+
+/* LRU-K with K=2. Evicts page with oldest second most recent reference. Pages referenced once are evicted first (LRU order). */
+extern const dbbufferPolicy dbbufferLRU2Policy;
+
+/* 2Q. New pages enter a FIFO (A1in). Pages referenced again after leaving A1in (remembered in A1out) are promoted to an LRU (Am). */
+extern const dbbufferPolicy dbbuffer2QPolicy;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,267 @@
+/******************************************************************************/
+/**
+@file		fdStorage.c
+@author		Ramon Lawrence
+@brief		POSIX file descriptor storage using pread and pwrite (no stdio buffering).
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE				/* O_DIRECT */
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fdStorage.h"
+
+/**
+@brief     	Opens file and sets storage functions.
+@param		fs
+                File descriptor storage state structure
+@param		flags
+                File open flags
+@return		 Returns 0 if success, non-zero if failure.
+*/
+static int8_t fdStorageStart(fdStorageState *fs, int flags)
+{	 
+#ifdef O_DIRECT
+	if (fs->direct)
+		flags |= O_DIRECT;
+#endif
+	fs->fd = open(fs->fileName, flags, 0644);
+	if (fs->fd < 0)
+		return -1;
+
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+	/* macOS: disable caching on file descriptor */
+	if (fs->direct && fcntl(fs->fd, F_NOCACHE, 1) == -1)
+	{
+		close(fs->fd);
+		return -1;
+	}
+#endif
+
+	fs->storage.init = fdStorageInit;
+	fs->storage.close = fdStorageClose;
+	fs->storage.readPage = fdStorageReadPage;
+	fs->storage.writePage = fdStorageWritePage;
+	fs->storage.flush = fdStorageFlush;
+	fs->storage.prefetchPage = NULL;
+	fs->storage.mapPage = NULL;
+	fs->storage.writePages = fdStorageWritePages;
+	fs->storage.readPages = fdStorageReadPages;
+
+	return 0;	
+}
+
+/**
+@brief     	Initializes storage. Creates file (existing file is truncated).
+@param		state
+                File descriptor storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageInit(storageState *storage)
+{	 
+	return fdStorageStart((fdStorageState*) storage, O_RDWR | O_CREAT | O_TRUNC);
+}
+
+/**
+@brief     	Opens existing file without truncating it (see sbtreeOpen()).
+@param		state
+                File descriptor storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. file does not exist).
+*/
+int8_t fdStorageOpen(storageState *storage)
+{	 
+	return fdStorageStart((fdStorageState*) storage, O_RDWR);
+}
+
+/**
+@brief      Returns buffer to use for I/O. Direct I/O requires an aligned buffer so
+			unaligned pages use alignedBuffer if provided.
+@param     	fs
+                File descriptor storage state structure
+@param		buffer
+				Page buffer
+*/
+static void* fdStorageIOBuffer(fdStorageState *fs, void *buffer)
+{
+	if (fs->direct && fs->alignedBuffer != NULL && ((uintptr_t) buffer) % FD_STORAGE_ALIGNMENT != 0)
+		return fs->alignedBuffer;
+	return buffer;
+}
+
+/**
+@brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
+@param     	state
+                File descriptor storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{	
+	fdStorageState *fs = (fdStorageState*) storage;
+	void *buf = fdStorageIOBuffer(fs, buffer);
+
+	/* Read at page offset. File position is not used so concurrent readers can share descriptor. */
+	if (pread(fs->fd, buf, pageSize, (off_t) pageNum*pageSize) != pageSize)
+		return -1;
+
+	if (buf != buffer)
+		memcpy(buffer, buf, pageSize);
+	return 0;
+}
+
+/**
+@brief      Writes page from buffer into storage. Returns 0 if success, non-zero if failure.
+@param     	state
+                File descriptor storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{    
+	fdStorageState *fs = (fdStorageState*) storage;
+	void *buf = fdStorageIOBuffer(fs, buffer);
+
+	if (buf != buffer)
+		memcpy(buf, buffer, pageSize);
+
+	if (pwrite(fs->fd, buf, pageSize, (off_t) pageNum*pageSize) != pageSize)
+		return -1;
+	return 0;
+}
+
+
+/**
+@brief      Writes count consecutive pages from buffer into storage with one pwrite. Returns 0 if success, non-zero if failure.
+@param     	state
+                File descriptor storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to count pages to write
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageWritePages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer)
+{    
+	fdStorageState *fs = (fdStorageState*) storage;
+	size_t	size = (size_t) count*pageSize;
+
+	/* Unaligned pages with O_DIRECT are copied through the aligned page buffer one at a time */
+	if (fdStorageIOBuffer(fs, buffer) != buffer)
+	{
+		for (id_t i=0; i < count; i++)
+			if (fdStorageWritePage(storage, pageNum+i, pageSize, (int8_t*) buffer + (size_t) i*pageSize) != 0)
+				return -1;
+		return 0;
+	}
+
+	if (pwrite(fs->fd, buffer, size, (off_t) pageNum*pageSize) != (ssize_t) size)
+		return -1;
+	return 0;
+}
+
+/**
+@brief      Reads count consecutive pages from storage into buffer with one pread. Returns 0 if success, non-zero if failure.
+@param     	state
+                File descriptor storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to memory for count pages
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageReadPages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer)
+{    
+	fdStorageState *fs = (fdStorageState*) storage;
+	size_t	size = (size_t) count*pageSize;
+
+	/* Unaligned pages with O_DIRECT are copied through the aligned page buffer one at a time */
+	if (fdStorageIOBuffer(fs, buffer) != buffer)
+	{
+		for (id_t i=0; i < count; i++)
+			if (fdStorageReadPage(storage, pageNum+i, pageSize, (int8_t*) buffer + (size_t) i*pageSize) != 0)
+				return -1;
+		return 0;
+	}
+
+	if (pread(fs->fd, buffer, size, (off_t) pageNum*pageSize) != (ssize_t) size)
+		return -1;
+	return 0;
+}
+
+
+/**
+@brief     	Flush storage and ensure all data is written to device (fdatasync).
+@param     	state
+                File descriptor storage state structure
+*/
+void fdStorageFlush(storageState *storage)
+{
+	fdStorageState *fs = (fdStorageState*) storage;
+#if defined(__APPLE__)
+	fsync(fs->fd);
+#else
+	fdatasync(fs->fd);
+#endif
+}
+
+
+/**
+@brief     	Closes storage and performs any needed cleanup.
+@param     	state
+                File descriptor storage state structure
+*/
+void fdStorageClose(storageState *storage)
+{	
+	fdStorageState *fs = (fdStorageState*) storage;
+	close(fs->fd);
+}
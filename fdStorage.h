@@ -0,0 +1,161 @@
+/******************************************************************************/
+/**
+@file		fdStorage.h
+@author		Ramon Lawrence
+@brief		POSIX file descriptor storage using pread and pwrite (no stdio buffering).
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef FDSTORAGE_H
+#define FDSTORAGE_H
+
+#include <stdint.h>
+
+#include "storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Alignment of buffers and file offsets required for direct I/O */
+#define FD_STORAGE_ALIGNMENT	4096
+
+typedef struct {
+	storageState 	storage;			/* Base struct defining read/write page functions */
+	int				fd;					/* File descriptor */
+	char			*fileName;			/* File name for storage */
+	uint8_t			direct;				/* 1 to bypass OS page cache (O_DIRECT). Page size must be a multiple of the device block size. */
+	void			*alignedBuffer;		/* Page buffer aligned to FD_STORAGE_ALIGNMENT used for direct I/O when buffer page is not aligned. NULL if not used. */
+} fdStorageState;
+
+
+/**
+@brief     	Initializes storage. Creates file (existing file is truncated).
+@param		state
+                File descriptor storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageInit(storageState *storage);
+
+
+/**
+@brief     	Opens existing file without truncating it (see sbtreeOpen()).
+@param		state
+                File descriptor storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. file does not exist).
+*/
+int8_t fdStorageOpen(storageState *storage);
+
+
+/**
+@brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
+@param     	state
+                File descriptor storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Writes page from buffer into storage. Returns 0 if success, non-zero if failure.
+@param     	state
+                File descriptor storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Writes count consecutive pages from buffer into storage with one pwrite. Returns 0 if success, non-zero if failure.
+@param     	state
+                File descriptor storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to count pages to write
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageWritePages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Reads count consecutive pages from storage into buffer with one pread. Returns 0 if success, non-zero if failure.
+@param     	state
+                File descriptor storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to memory for count pages
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fdStorageReadPages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer);
+
+
+/**
+@brief     	Flush storage and ensure all data is written to device (fdatasync).
+@param     	state
+                File descriptor storage state structure
+*/
+void fdStorageFlush(storageState *storage);
+
+
+/**
+@brief     	Closes storage and performs any needed cleanup.
+@param     	state
+                File descriptor storage state structure
+*/
+void fdStorageClose(storageState *storage);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -37,16 +37,16 @@
 #include "fileStorage.h"
 
 /**
-@brief     	Initializes storage. Opens file.
-@param		state
+@brief     	Opens file and sets storage functions.
+@param		fs
                 File storage state structure
+@param		mode
+                File open mode
 @return		 Returns 0 if success, non-zero if failure.
 */
-int8_t fileStorageInit(storageState *storage)
-{	 
-	fileStorageState *fs = (fileStorageState*) storage;
-
-	fs->file = fopen(fs->fileName, "w+b");
+static int8_t fileStorageStart(fileStorageState *fs, const char *mode)
+{
+	fs->file = fopen(fs->fileName, mode);
     if (NULL == fs->file) 
 		return -1;
 
@@ -55,10 +55,36 @@ int8_t fileStorageInit(storageState *storage)
 	fs->storage.readPage = fileStorageReadPage;
 	fs->storage.writePage = fileStorageWritePage;
 	fs->storage.flush = fileStorageFlush;
+	fs->storage.prefetchPage = NULL;
+	fs->storage.mapPage = NULL;
+	fs->storage.writePages = fileStorageWritePages;
+	fs->storage.readPages = fileStorageReadPages;
 
 	return 0;	
 }
 
+/**
+@brief     	Initializes storage. Creates file (existing file is truncated).
+@param		state
+                File storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fileStorageInit(storageState *storage)
+{	 
+	return fileStorageStart((fileStorageState*) storage, "w+b");
+}
+
+/**
+@brief     	Opens existing file without truncating it (see sbtreeOpen()).
+@param		state
+                File storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. file does not exist).
+*/
+int8_t fileStorageOpen(storageState *storage)
+{	 
+	return fileStorageStart((fileStorageState*) storage, "r+b");
+}
+
 /**
 @brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
 @param     	state
@@ -112,6 +138,58 @@ int8_t fileStorageWritePage(storageState *storage, id_t pageNum, count_t pageSiz
 }
 
 
+/**
+@brief      Writes count consecutive pages from buffer into storage with one write. Returns 0 if success, non-zero if failure.
+@param     	state
+                File storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to count pages to write
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fileStorageWritePages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer)
+{    
+	fileStorageState *fs = (fileStorageState*) storage;
+
+	/* Seek flushes stdio buffer so pages are written with one seek */
+	fseek(fs->file, pageNum*pageSize, SEEK_SET);
+
+	if (fwrite(buffer, pageSize, count, fs->file) != count)
+		return -1;
+	return 0;
+}
+
+/**
+@brief      Reads count consecutive pages from storage into buffer with one read. Returns 0 if success, non-zero if failure.
+@param     	state
+                File storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to memory for count pages
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fileStorageReadPages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer)
+{    
+	fileStorageState *fs = (fileStorageState*) storage;
+
+	fseek(fs->file, pageNum*pageSize, SEEK_SET);
+
+	if (fread(buffer, pageSize, count, fs->file) != count)
+		return -1;
+	return 0;
+}
+
+
 /**
 @brief     	Flush storage and ensure all data is written.
 @param     	state
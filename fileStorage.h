@@ -40,6 +40,10 @@
 
 #include "storage.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 typedef struct {
 	storageState 	storage;			/* Base struct defining read/write page functions */
@@ -49,7 +53,7 @@ typedef struct {
 
 
 /**
-@brief     	Initializes storage. Opens file.
+@brief     	Initializes storage. Creates file (existing file is truncated).
 @param		state
                 File storage state structure
 @return		 Returns 0 if success, non-zero if failure.
@@ -57,6 +61,15 @@ typedef struct {
 int8_t fileStorageInit(storageState *storage);
 
 
+/**
+@brief     	Opens existing file without truncating it (see sbtreeOpen()).
+@param		state
+                File storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. file does not exist).
+*/
+int8_t fileStorageOpen(storageState *storage);
+
+
 /**
 @brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
 @param     	state
@@ -87,6 +100,40 @@ int8_t fileStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize
 int8_t fileStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
 
 
+/**
+@brief      Writes count consecutive pages from buffer into storage with one write. Returns 0 if success, non-zero if failure.
+@param     	state
+                File storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to count pages to write
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fileStorageWritePages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Reads count consecutive pages from storage into buffer with one read. Returns 0 if success, non-zero if failure.
+@param     	state
+                File storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to memory for count pages
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t fileStorageReadPages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer);
+
+
 /**
 @brief     	Flush storage and ensure all data is written.
 @param     	state
@@ -103,4 +150,8 @@ void fileStorageFlush(storageState *storage);
 void fileStorageClose(storageState *storage);
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
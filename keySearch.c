@@ -0,0 +1,238 @@
+/******************************************************************************/
+/**
+@file		keySearch.c
+@author		Ramon Lawrence
+@brief		Search of sorted fixed-width integer keys in a node with SIMD acceleration.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#include <stdint.h>
+
+#include "keySearch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KEY_SEARCH_X86
+#include <immintrin.h>
+#endif
+
+/* Binary search stops when this many keys remain. Remaining keys are counted with a linear (vectorized) scan. */
+#define KEY_SEARCH_WINDOW	16
+
+/*
+Key order of compareKey of SBTree. 4 byte keys are ordered by sign of their wrapped difference (as uint32Compare) so
+keys in a node may cross 0 or 2^31 if they are within 2^31 of each other. 8 byte keys are signed.
+*/
+#define KEY_LESS32(v, k)	((int32_t) ((uint32_t) (v) - (uint32_t) (k)) < 0)
+#define KEY_LESS64(v, k)	((v) < (k))
+
+/*
+Branchless binary search. Narrows [base, base+len) until at most KEY_SEARCH_WINDOW keys remain.
+All keys before base satisfy the comparison and no key after the window does.
+*/
+#define KEY_SEARCH_NARROW(type, less)														\
+	type k = *((type*) key);																\
+	int16_t base = 0, len = count, half;													\
+	while (len > KEY_SEARCH_WINDOW)															\
+	{																						\
+		half = len / 2;																		\
+		type v = *((type*) ((uint8_t*) keys + (base+half)*stride));							\
+		base += (less(v, k) | (orEqual & (v == k))) ? half : 0;							\
+		len -= half;																		\
+	}																						\
+	uint8_t *p = (uint8_t*) keys + base*stride;
+
+/* Counts remaining keys in window one at a time */
+#define KEY_SEARCH_TAIL(type, less)															\
+	for ( ; len > 0; len--, p += stride)													\
+	{																						\
+		type v = *((type*) p);																\
+		base += less(v, k) | (orEqual & (v == k));											\
+	}																						\
+	return base;
+
+/**
+@brief     	Counts 4 byte keys less than (or equal to) search key. Portable version.
+*/
+static int16_t keySearchScalar32(void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual)
+{
+	KEY_SEARCH_NARROW(uint32_t, KEY_LESS32)
+	KEY_SEARCH_TAIL(uint32_t, KEY_LESS32)
+}
+
+/**
+@brief     	Counts 8 byte keys less than (or equal to) search key. Portable version.
+*/
+static int16_t keySearchScalar64(void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual)
+{
+	KEY_SEARCH_NARROW(int64_t, KEY_LESS64)
+	KEY_SEARCH_TAIL(int64_t, KEY_LESS64)
+}
+
+#ifdef KEY_SEARCH_X86
+/**
+@brief     	Counts 4 byte keys less than (or equal to) search key. Compares 4 keys at a time with SSE.
+			Key is less than search key if their wrapped difference is negative.
+*/
+__attribute__((target("sse4.2,popcnt")))
+static int16_t keySearchSSE32(void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual)
+{
+	KEY_SEARCH_NARROW(uint32_t, KEY_LESS32)
+	__m128i kv = _mm_set1_epi32(k), zero = _mm_setzero_si128(), v, m;
+
+	for ( ; len >= 4; len -= 4, p += 4*stride)
+	{
+		if (stride == sizeof(int32_t))
+			v = _mm_loadu_si128((__m128i*) p);
+		else	/* Keys of strided leaf records */
+			v = _mm_set_epi32(*((int32_t*) (p+3*stride)), *((int32_t*) (p+2*stride)), *((int32_t*) (p+stride)), *((int32_t*) p));
+		m = _mm_cmpgt_epi32(zero, _mm_sub_epi32(v, kv));
+		if (orEqual)
+			m = _mm_or_si128(m, _mm_cmpeq_epi32(kv, v));
+		base += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+	}
+	KEY_SEARCH_TAIL(uint32_t, KEY_LESS32)
+}
+
+/**
+@brief     	Counts 8 byte keys less than (or equal to) search key. Compares 2 keys at a time with SSE4.2.
+*/
+__attribute__((target("sse4.2,popcnt")))
+static int16_t keySearchSSE64(void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual)
+{
+	KEY_SEARCH_NARROW(int64_t, KEY_LESS64)
+	__m128i kv = _mm_set1_epi64x(k), v, m;
+
+	for ( ; len >= 2; len -= 2, p += 2*stride)
+	{
+		if (stride == sizeof(int64_t))
+			v = _mm_loadu_si128((__m128i*) p);
+		else
+			v = _mm_set_epi64x(*((int64_t*) (p+stride)), *((int64_t*) p));
+		m = _mm_cmpgt_epi64(kv, v);
+		if (orEqual)
+			m = _mm_or_si128(m, _mm_cmpeq_epi64(kv, v));
+		base += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(m)));
+	}
+	KEY_SEARCH_TAIL(int64_t, KEY_LESS64)
+}
+
+/**
+@brief     	Counts 4 byte keys less than (or equal to) search key. Compares 8 keys at a time with AVX2.
+			Strided leaf records are loaded with a gather. Key is less than search key if their wrapped difference is negative.
+*/
+__attribute__((target("avx2,popcnt")))
+static int16_t keySearchAVX2_32(void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual)
+{
+	KEY_SEARCH_NARROW(uint32_t, KEY_LESS32)
+	__m256i kv = _mm256_set1_epi32(k), zero = _mm256_setzero_si256(), v, m;
+	__m256i idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+
+	for ( ; len >= 8; len -= 8, p += 8*stride)
+	{
+		if (stride == sizeof(int32_t))
+			v = _mm256_loadu_si256((__m256i*) p);
+		else
+			v = _mm256_i32gather_epi32((int const*) p, idx, 1);
+		m = _mm256_cmpgt_epi32(zero, _mm256_sub_epi32(v, kv));
+		if (orEqual)
+			m = _mm256_or_si256(m, _mm256_cmpeq_epi32(kv, v));
+		base += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+	}
+	KEY_SEARCH_TAIL(uint32_t, KEY_LESS32)
+}
+
+/**
+@brief     	Counts 8 byte keys less than (or equal to) search key. Compares 4 keys at a time with AVX2.
+			Strided leaf records are loaded with a gather.
+*/
+__attribute__((target("avx2,popcnt")))
+static int16_t keySearchAVX2_64(void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual)
+{
+	KEY_SEARCH_NARROW(int64_t, KEY_LESS64)
+	__m256i kv = _mm256_set1_epi64x(k), v, m;
+	__m128i idx = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(stride));
+
+	for ( ; len >= 4; len -= 4, p += 4*stride)
+	{
+		if (stride == sizeof(int64_t))
+			v = _mm256_loadu_si256((__m256i*) p);
+		else
+			v = _mm256_i32gather_epi64((long long const*) p, idx, 1);
+		m = _mm256_cmpgt_epi64(kv, v);
+		if (orEqual)
+			m = _mm256_or_si256(m, _mm256_cmpeq_epi64(kv, v));
+		base += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+	}
+	KEY_SEARCH_TAIL(int64_t, KEY_LESS64)
+}
+#endif
+
+/**
+@brief     	Returns key search function for given key size and implementation level.
+			CPU features are checked at runtime.
+@param     	keySize
+                Size of key in bytes. Only 4 and 8 byte integer keys are supported.
+@param     	level
+                Implementation level (KEY_SEARCH_BEST for best supported by CPU)
+@return		Function or NULL if key size or implementation level is not supported.
+*/
+keySearchFunc keySearchSelect(uint8_t keySize, uint8_t level)
+{
+	if (keySize != sizeof(int32_t) && keySize != sizeof(int64_t))
+		return NULL;
+
+#ifdef KEY_SEARCH_X86
+	__builtin_cpu_init();
+	int8_t hasAVX2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+	int8_t hasSSE42 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+
+	if (level == KEY_SEARCH_BEST)
+		level = hasAVX2 ? KEY_SEARCH_AVX2 : (hasSSE42 ? KEY_SEARCH_SSE42 : KEY_SEARCH_SCALAR);
+
+	if (level == KEY_SEARCH_AVX2)
+	{
+		if (!hasAVX2)
+			return NULL;
+		return keySize == sizeof(int32_t) ? keySearchAVX2_32 : keySearchAVX2_64;
+	}
+	if (level == KEY_SEARCH_SSE42)
+	{
+		if (!hasSSE42)
+			return NULL;
+		return keySize == sizeof(int32_t) ? keySearchSSE32 : keySearchSSE64;
+	}
+#else
+	if (level == KEY_SEARCH_BEST)
+		level = KEY_SEARCH_SCALAR;
+#endif
+	if (level != KEY_SEARCH_SCALAR)
+		return NULL;
+	return keySize == sizeof(int32_t) ? keySearchScalar32 : keySearchScalar64;
+}
@@ -0,0 +1,73 @@
+/******************************************************************************/
+/**
+@file		keySearch.h
+@author		Ramon Lawrence
+@brief		Search of sorted fixed-width integer keys in a node with SIMD acceleration.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Implementation levels for keySearchSelect() */
+#define KEY_SEARCH_BEST		0		/* Best implementation supported by CPU */
+#define KEY_SEARCH_SCALAR	1		/* Portable C */
+#define KEY_SEARCH_SSE42	2		/* x86 SSE4.2 */
+#define KEY_SEARCH_AVX2		3		/* x86 AVX2 */
+
+/*
+Counts keys less than (or less than or equal to if orEqual is 1) the search key.
+Keys are integers in compareKey order of SBTree (4 byte keys by sign of wrapped difference, 8 byte keys signed)
+starting at keys and separated by stride bytes.
+*/
+typedef int16_t (*keySearchFunc)(void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual);
+
+/**
+@brief     	Returns key search function for given key size and implementation level.
+			CPU features are checked at runtime.
+@param     	keySize
+                Size of key in bytes. Only 4 and 8 byte integer keys are supported.
+@param     	level
+                Implementation level (KEY_SEARCH_BEST for best supported by CPU)
+@return		Function or NULL if key size or implementation level is not supported.
+*/
+keySearchFunc keySearchSelect(uint8_t keySize, uint8_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
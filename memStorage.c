@@ -57,6 +57,10 @@ int8_t memStorageInit(storageState *storage)
 	mem->storage.readPage = memStorageReadPage;
 	mem->storage.writePage = memStorageWritePage;
 	mem->storage.flush = memStorageFlush;
+	mem->storage.prefetchPage = NULL;
+	mem->storage.mapPage = NULL;
+	mem->storage.writePages = NULL;
+	mem->storage.readPages = NULL;
 
 	return 0;
 }
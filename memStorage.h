@@ -40,6 +40,10 @@
 
 #include "storage.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 typedef struct {
 	storageState 	storage;			/* Base struct defining read/write page functions */
@@ -103,4 +107,8 @@ void memStorageFlush(storageState *storage);
 void memStorageClose(storageState *storage);
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
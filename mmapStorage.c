@@ -0,0 +1,346 @@
+/******************************************************************************/
+/**
+@file		mmapStorage.c
+@author		Ramon Lawrence
+@brief		Memory-mapped file storage with zero-copy page reads.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE				/* mremap */
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mmapStorage.h"
+
+/**
+@brief     	Applies access pattern hint to mapping.
+@param		ms
+                Memory-mapped storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+static int8_t mmapStorageApplyAdvice(mmapStorageState *ms)
+{
+	int advice = MADV_NORMAL;
+
+	if (ms->advice == MMAP_STORAGE_SEQUENTIAL)
+		advice = MADV_SEQUENTIAL;
+	else if (ms->advice == MMAP_STORAGE_RANDOM)
+		advice = MADV_RANDOM;
+	return madvise(ms->mapping, ms->mapSize, advice) == 0 ? 0 : -1;
+}
+
+/**
+@brief     	Opens file, maps it into memory and sets storage functions.
+@param		ms
+                Memory-mapped storage state structure
+@param		flags
+                File open flags
+@return		 Returns 0 if success, non-zero if failure.
+*/
+static int8_t mmapStorageStart(mmapStorageState *ms, int flags)
+{	 
+	struct stat st;
+
+	if (ms->mapSize == 0)
+		ms->mapSize = MMAP_STORAGE_DEFAULT_MAP;
+	if (ms->growSize == 0)
+		ms->growSize = MMAP_STORAGE_DEFAULT_GROW;
+
+	ms->fd = open(ms->fileName, flags, 0644);
+	if (ms->fd < 0)
+		return -1;
+
+	/* Existing file is mapped entirely */
+	if (fstat(ms->fd, &st) != 0)
+	{
+		close(ms->fd);
+		return -1;
+	}
+	ms->fileSize = (uint32_t) st.st_size;
+	ms->dataSize = ms->fileSize;
+	while (ms->mapSize < ms->fileSize)
+		ms->mapSize *= 2;
+
+	/* Mapping may be larger than file. Only pages within file are accessed. */
+	ms->mapping = mmap(NULL, ms->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, ms->fd, 0);
+	if (ms->mapping == MAP_FAILED)
+	{
+		close(ms->fd);
+		return -1;
+	}
+	mmapStorageApplyAdvice(ms);
+
+	ms->storage.init = mmapStorageInit;
+	ms->storage.close = mmapStorageClose;
+	ms->storage.readPage = mmapStorageReadPage;
+	ms->storage.writePage = mmapStorageWritePage;
+	ms->storage.flush = mmapStorageFlush;
+	ms->storage.prefetchPage = NULL;
+	ms->storage.mapPage = mmapStorageMapPage;
+	ms->storage.writePages = mmapStorageWritePages;
+	ms->storage.readPages = mmapStorageReadPages;
+
+	return 0;	
+}
+
+/**
+@brief     	Initializes storage. Creates file (existing file is truncated) and maps it into memory.
+@param		state
+                Memory-mapped storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageInit(storageState *storage)
+{	 
+	return mmapStorageStart((mmapStorageState*) storage, O_RDWR | O_CREAT | O_TRUNC);
+}
+
+/**
+@brief     	Opens existing file without truncating it (see sbtreeOpen()) and maps it into memory.
+@param		state
+                Memory-mapped storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. file does not exist).
+*/
+int8_t mmapStorageOpen(storageState *storage)
+{	 
+	return mmapStorageStart((mmapStorageState*) storage, O_RDWR);
+}
+
+/**
+@brief      Extends file to contain given size and grows mapping if file is larger than mapping.
+@param     	ms
+                Memory-mapped storage state structure
+@param		size
+				Required file size in bytes
+@return		 Returns 0 if success, non-zero if failure.
+*/
+static int8_t mmapStorageGrow(mmapStorageState *ms, uint32_t size)
+{
+	uint32_t fileSize = ms->fileSize + ms->growSize, mapSize = ms->mapSize;
+	void *mapping;
+
+	if (fileSize < size)
+		fileSize = size;
+	if (ftruncate(ms->fd, fileSize) != 0)
+		return -1;
+	ms->fileSize = fileSize;
+
+	if (fileSize <= ms->mapSize)
+		return 0;
+
+	while (mapSize < fileSize)
+		mapSize *= 2;
+#ifdef MREMAP_MAYMOVE
+	mapping = mremap(ms->mapping, ms->mapSize, mapSize, MREMAP_MAYMOVE);
+#else
+	munmap(ms->mapping, ms->mapSize);
+	mapping = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, ms->fd, 0);
+#endif
+	if (mapping == MAP_FAILED)
+		return -1;
+	ms->mapping = mapping;
+	ms->mapSize = mapSize;
+	mmapStorageApplyAdvice(ms);
+	return 0;
+}
+
+/**
+@brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{	
+	void *page = mmapStorageMapPage(storage, pageNum, pageSize);
+
+	if (page == NULL)
+		return -1;
+	memcpy(buffer, page, pageSize);
+	return 0;
+}
+
+/**
+@brief      Writes page from buffer into storage. File and mapping are extended if needed.
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to buffer to copy data from
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{    
+	mmapStorageState *ms = (mmapStorageState*) storage;
+	uint32_t end = (pageNum+1) * pageSize;
+
+	if (end > ms->fileSize && mmapStorageGrow(ms, end) != 0)
+		return -1;
+
+	memcpy((int8_t*) ms->mapping + pageNum * pageSize, buffer, pageSize);
+	if (end > ms->dataSize)
+		ms->dataSize = end;
+	return 0;
+}
+
+
+/**
+@brief      Writes count consecutive pages from buffer into storage with one copy. Returns 0 if success, non-zero if failure.
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to count pages to write
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageWritePages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer)
+{    
+	mmapStorageState *ms = (mmapStorageState*) storage;
+	uint32_t end = (pageNum+count) * pageSize;
+
+	if (end > ms->fileSize && mmapStorageGrow(ms, end) != 0)
+		return -1;
+
+	memcpy((int8_t*) ms->mapping + pageNum * pageSize, buffer, (size_t) count * pageSize);
+	if (end > ms->dataSize)
+		ms->dataSize = end;
+	return 0;
+}
+
+/**
+@brief      Reads count consecutive pages from storage into buffer with one copy. Returns 0 if success, non-zero if failure.
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to memory for count pages
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageReadPages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer)
+{    
+	mmapStorageState *ms = (mmapStorageState*) storage;
+
+	if ((pageNum+count) * pageSize > ms->fileSize)
+		return -1;
+
+	memcpy(buffer, (int8_t*) ms->mapping + pageNum * pageSize, (size_t) count * pageSize);
+	return 0;
+}
+
+/**
+@brief      Returns read-only pointer to page in mapping. Pointer is valid until next page write
+			(mapping may move when file grows).
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page in bytes
+@return		 Returns pointer to page or NULL if page is past end of file.
+*/
+void* mmapStorageMapPage(storageState *storage, id_t pageNum, count_t pageSize)
+{
+	mmapStorageState *ms = (mmapStorageState*) storage;
+
+	/* Accessing mapping past end of file raises SIGBUS */
+	if ((pageNum+1) * pageSize > ms->fileSize)
+		return NULL;
+	return (int8_t*) ms->mapping + pageNum * pageSize;
+}
+
+/**
+@brief     	Sets access pattern hint for mapping (madvise). Use MMAP_STORAGE_SEQUENTIAL before
+			iterator scans and MMAP_STORAGE_RANDOM before key lookups.
+@param     	state
+                Memory-mapped storage state structure
+@param		advice
+				Access pattern (MMAP_STORAGE_*)
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageAdvise(storageState *storage, uint8_t advice)
+{
+	mmapStorageState *ms = (mmapStorageState*) storage;
+
+	ms->advice = advice;
+	return mmapStorageApplyAdvice(ms);
+}
+
+/**
+@brief     	Flush storage and ensure all data is written to device (msync).
+@param     	state
+                Memory-mapped storage state structure
+*/
+void mmapStorageFlush(storageState *storage)
+{
+	mmapStorageState *ms = (mmapStorageState*) storage;
+
+	if (ms->fileSize > 0)
+		msync(ms->mapping, ms->fileSize, MS_SYNC);
+}
+
+/**
+@brief     	Closes storage and performs any needed cleanup.
+@param     	state
+                Memory-mapped storage state structure
+*/
+void mmapStorageClose(storageState *storage)
+{	
+	mmapStorageState *ms = (mmapStorageState*) storage;
+
+	munmap(ms->mapping, ms->mapSize);
+	/* Remove space added past last page by growSize */
+	if (ftruncate(ms->fd, ms->dataSize) == 0)
+		ms->fileSize = ms->dataSize;
+	close(ms->fd);
+}
@@ -0,0 +1,197 @@
+/******************************************************************************/
+/**
+@file		mmapStorage.h
+@author		Ramon Lawrence
+@brief		Memory-mapped file storage with zero-copy page reads.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef MMAPSTORAGE_H
+#define MMAPSTORAGE_H
+
+#include <stdint.h>
+
+#include "storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Access pattern hints for mmapStorageAdvise() */
+#define MMAP_STORAGE_NORMAL		0
+#define MMAP_STORAGE_SEQUENTIAL	1		/* Iterator scans. OS reads ahead and drops pages behind scan. */
+#define MMAP_STORAGE_RANDOM		2		/* Key lookups. OS does not read ahead. */
+
+/* Default initial mapping size and file growth in bytes */
+#define MMAP_STORAGE_DEFAULT_MAP	(1024*1024)
+#define MMAP_STORAGE_DEFAULT_GROW	(64*1024)
+
+typedef struct {
+	storageState 	storage;			/* Base struct defining read/write page functions */
+	int				fd;					/* File descriptor */
+	char			*fileName;			/* File name for storage */
+	void			*mapping;			/* Memory mapping of file */
+	uint32_t		mapSize;			/* Size of mapping in bytes. Set initial size before init() (0 uses MMAP_STORAGE_DEFAULT_MAP). Doubled when file grows past mapping. */
+	uint32_t		growSize;			/* Bytes file is extended by when page past end of file is written. Set before init() (0 uses MMAP_STORAGE_DEFAULT_GROW). */
+	uint32_t		fileSize;			/* Size of file in bytes */
+	uint32_t		dataSize;			/* Bytes up to end of last page written. File is truncated to this size on close. */
+	uint8_t			advice;				/* Access pattern hint (MMAP_STORAGE_*) applied to mapping */
+} mmapStorageState;
+
+
+/**
+@brief     	Initializes storage. Creates file (existing file is truncated) and maps it into memory.
+@param		state
+                Memory-mapped storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageInit(storageState *storage);
+
+
+/**
+@brief     	Opens existing file without truncating it (see sbtreeOpen()) and maps it into memory.
+@param		state
+                Memory-mapped storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. file does not exist).
+*/
+int8_t mmapStorageOpen(storageState *storage);
+
+
+/**
+@brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Writes page from buffer into storage. File and mapping are extended if needed.
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to buffer to copy data from
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Writes count consecutive pages from buffer into storage with one copy. Returns 0 if success, non-zero if failure.
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to count pages to write
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageWritePages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Reads count consecutive pages from storage into buffer with one copy. Returns 0 if success, non-zero if failure.
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number) of first page
+@param		count
+				Number of pages
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to memory for count pages
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageReadPages(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Returns read-only pointer to page in mapping. Pointer is valid until next page write
+			(mapping may move when file grows).
+@param     	state
+                Memory-mapped storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page in bytes
+@return		 Returns pointer to page or NULL if page is past end of file.
+*/
+void* mmapStorageMapPage(storageState *storage, id_t pageNum, count_t pageSize);
+
+
+/**
+@brief     	Sets access pattern hint for mapping (madvise). Use MMAP_STORAGE_SEQUENTIAL before
+			iterator scans and MMAP_STORAGE_RANDOM before key lookups.
+@param     	state
+                Memory-mapped storage state structure
+@param		advice
+				Access pattern (MMAP_STORAGE_*)
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t mmapStorageAdvise(storageState *storage, uint8_t advice);
+
+
+/**
+@brief     	Flush storage and ensure all data is written to device (msync).
+@param     	state
+                Memory-mapped storage state structure
+*/
+void mmapStorageFlush(storageState *storage);
+
+
+/**
+@brief     	Closes storage and performs any needed cleanup.
+@param     	state
+                Memory-mapped storage state structure
+*/
+void mmapStorageClose(storageState *storage);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -42,6 +42,38 @@
 
 #include "sbtree.h"
 
+static int8_t sbtreeWriteSuperblock(sbtreeState *state);
+static int8_t sbtreeRecoverCheckpoint(sbtreeState *state, void *buf);
+
+/*
+Leaf with SBTREE_DELTA_KEYS: header, first key, number of bits per delta (1 byte), key deltas from first key
+packed with that many bits each, free space, then data values stored from end of page (record 0 is last).
+Number of bits increases as larger deltas are added and existing deltas are repacked.
+*/
+#define SBTREE_DELTA_HEADER(state)	((state)->headerSize + (state)->keySize + 1)
+#define SBTREE_DELTA_MAX_BITS		56		/* Delta and bit offset within a byte fit in 64-bit word */
+#define SBTREE_DELTA_SLACK			7		/* Bytes after packed deltas so 8 byte words can be read */
+
+/*
+Interior node with SBTREE_PREFIX_KEYS: header, prefix length (1 byte), slot width (1 byte), prefix shared by all separators
+in node, then separators with prefix removed in slots of slot width bytes (zero padded), free space, then child ids stored
+from end of page (child 0 is last). Trailing zero bytes of a separator are not stored. Adding a separator may shorten the
+prefix or widen the slots, in which case existing slots are re-encoded.
+*/
+#define SBTREE_PREFIX_HEADER(state)	((state)->headerSize + 2)
+
+/*
+Interior node with child summaries (aggregates and bitmaps): header, keys, child ids, then a summary for each child pointer.
+Summary is aggregate summary (if aggregates used) followed by bitmap (if bitmaps used).
+*/
+#define SBTREE_AGGREGATE_SIZE(state)		((state)->aggregate != NULL ? (state)->aggregate->summarySize : 0)
+#define SBTREE_CHILD_SUMMARY_SIZE(state)	(SBTREE_AGGREGATE_SIZE(state) + ((state)->bitmap != NULL ? (state)->bitmap->bitmapSize : 0))
+
+/* Maximum bits set for a key in a leaf Bloom filter (bits are in one 64-bit block) */
+#define SBTREE_BLOOM_MAX_HASHES				8
+
+/* Bytes of values stored in a value log page after page header */
+#define SBTREE_VALUE_LOG_CAPACITY(state)	((uint32_t) (state)->buffer->pageSize - (state)->headerSize)
 
 /*
 Comparison functions. Code is adapted from ldbm.
@@ -61,6 +93,21 @@ static int8_t uint32Compare(void *a, void *b)
     return 0;	
 }
 
+/**
+@brief     	Compares two int64_t values.
+@param     	a
+                value 1
+@param     	b
+                value 2
+*/
+static int8_t int64Compare(void *a, void *b)
+{
+	int64_t x = *((int64_t*)a), y = *((int64_t*)b);
+	if(x < y) return -1;
+	if(x > y) return 1;
+    return 0;
+}
+
 /**
 @brief     	Compares two values by bytes. 
 @param     	a
@@ -75,11 +122,72 @@ static int8_t byteCompare(void *a, void *b, int16_t size)
 
 
 /**
-@brief     	Initialize an SBTree structure.
+@brief     	Returns integer key value. Key must be 4 or 8 bytes.
 @param     	state
                 SBTree algorithm state structure
+@param     	key
+                Key
 */
-void sbtreeInit(sbtreeState *state)
+static int64_t sbtreeIntKey(sbtreeState *state, void *key)
+{
+	if (state->keySize == sizeof(int64_t))
+		return *((int64_t*) key);
+	return *((int32_t*) key);
+}
+
+/**
+@brief     	Reads leaf page for search or iteration that does not modify it. With SBTREE_ZERO_COPY_READ,
+			storage that supports mapping pages returns the page without copying it into a buffer.
+			Interior nodes are read with readPage() so they stay pinned in the buffer.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageId
+                Physical page id
+@return		Return pointer to page or NULL if error.
+*/
+static void* sbtreeReadOnlyPage(sbtreeState *state, id_t pageId)
+{
+	if (state->parameters & SBTREE_ZERO_COPY_READ)
+		return dbbufferReadPageZeroCopy(state->buffer, pageId);
+	return readPage(state->buffer, pageId);
+}
+
+/**
+@brief     	Returns pointer to child id in interior node.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node
+@param		i
+				Child pointer index
+*/
+static void* sbtreeChildPtr(sbtreeState *state, void *buf, id_t i)
+{
+	if (state->parameters & SBTREE_PREFIX_KEYS)
+		return buf + state->buffer->pageSize - sizeof(id_t)*(i+1);
+	return buf + state->headerSize + state->keySize*state->maxInteriorRecordsPerPage + sizeof(id_t)*i;
+}
+
+/**
+@brief     	Returns pointer to summary of child in interior node with child summaries. Summaries follow child ids.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node
+@param		i
+				Child pointer index
+*/
+static void* sbtreeSummaryPtr(sbtreeState *state, void *buf, id_t i)
+{
+	return sbtreeChildPtr(state, buf, state->maxInteriorRecordsPerPage+1) + SBTREE_CHILD_SUMMARY_SIZE(state)*i;
+}
+
+/**
+@brief     	Initializes buffer and calculates page layout. Used by init() and open().
+@param     	state
+                SBTree algorithm state structure
+*/
+static void sbtreeSetup(sbtreeState *state)
 {
 	printf("Initializing SBTree.\n");
 	state->recordSize = state->keySize + state->dataSize;
@@ -88,338 +196,2177 @@ void sbtreeInit(sbtreeState *state)
 	dbbufferInit(state->buffer);
 	state->buffer->activePath = state->activePath;
 
-	state->compareKey = uint32Compare;
+	state->compareKey = state->keySize == sizeof(int64_t) ? int64Compare : uint32Compare;
+
+	/* Integer keys are searched without calling compareKey. Implementation is selected based on CPU. */
+	state->searchKeys = keySearchSelect(state->keySize, KEY_SEARCH_BEST);
+	state->numProbes = 0;
+	if (state->keySize != sizeof(int32_t) && state->keySize != sizeof(int64_t))
+	{
+		state->parameters &= ~(SBTREE_USE_INTERPOLATION | SBTREE_DELTA_KEYS);
+		state->spline = NULL;
+	}
+	/* Integer keys do not order as byte strings. Prefix nodes compare separators as bytes instead of using compareKey. */
+	if (state->keySize <= sizeof(int64_t) || state->keySize > SBTREE_MAX_KEY_SIZE)
+		state->parameters &= ~SBTREE_PREFIX_KEYS;
+	/* Prefix nodes store child ids from end of page so there is no space for child summaries */
+	if (state->parameters & SBTREE_PREFIX_KEYS)
+	{
+		state->aggregate = NULL;
+		state->bitmap = NULL;
+	}
+	if (state->bitmap != NULL && (state->bitmap->bitmapSize == 0 || state->bitmap->bitmapSize > sizeof(uint64_t)))
+		state->bitmap = NULL;
+	if (state->bloomFilter != NULL && state->bloomFilter->filterSize < sizeof(uint64_t))
+		state->bloomFilter = NULL;
+	if (state->spline != NULL)
+		splineInit(state->spline);
 	
 	/* Set block header size */
-	/* Header size fixed: 6 bytes: 4 byte id, 2 for record count. */	
+	/* Header size fixed: 6 bytes: 4 byte id, 2 for record count. Optional 4 byte checksum after count. */	
 	state->headerSize = 6;	
+	if (state->parameters & SBTREE_PAGE_CHECKSUM)
+	{
+		state->headerSize += sizeof(uint32_t);
+		state->buffer->checksum = crc32cSelect(CRC32C_BEST);
+	}
+	/* Optional bitmap of data values after count (and checksum) */
+	state->bmOffset = state->headerSize;
+	if (state->bitmap != NULL)
+		state->headerSize += state->bitmap->bitmapSize;
 
 	/* Calculate number of records per page */
 	state->maxRecordsPerPage = (state->buffer->pageSize - state->headerSize) / state->recordSize;
+	/* Delta leaves are filled until full. Limit is records that fit if all keys are equal (count field is below 10000). */
+	if (state->parameters & SBTREE_DELTA_KEYS)
+	{
+		state->maxRecordsPerPage = 9999;
+		if (state->dataSize > 0 && (state->buffer->pageSize - SBTREE_DELTA_HEADER(state) - SBTREE_DELTA_SLACK) / state->dataSize < 9999)
+			state->maxRecordsPerPage = (state->buffer->pageSize - SBTREE_DELTA_HEADER(state) - SBTREE_DELTA_SLACK) / state->dataSize;
+	}
 	/* Interior records consist of key and id reference. Note: One extra id reference (child pointer). If N keys, have N+1 id references (pointers). */
 	state->maxInteriorRecordsPerPage = (state->buffer->pageSize - state->headerSize -sizeof(id_t)) / (state->keySize+sizeof(id_t));
+	/* Prefix nodes are filled until full. Limit is separators that fit if they are all stored in the prefix. */
+	if (state->parameters & SBTREE_PREFIX_KEYS)
+		state->maxInteriorRecordsPerPage = (state->buffer->pageSize - SBTREE_PREFIX_HEADER(state) - sizeof(id_t)) / sizeof(id_t);
+	/* Aggregates of child: count (4 bytes), sum (8 bytes), min and max of column, smallest and largest key. One summary per child pointer. */
+	if (state->aggregate != NULL)
+		state->aggregate->summarySize = sizeof(uint32_t) + sizeof(int64_t) + 2*state->aggregate->size + 2*state->keySize;
+	if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0 && (state->buffer->pageSize - state->headerSize - sizeof(id_t) - SBTREE_CHILD_SUMMARY_SIZE(state))
+			/ (state->keySize + sizeof(id_t) + SBTREE_CHILD_SUMMARY_SIZE(state)) < 2)
+	{
+		printf("Aggregates and bitmaps not used. Page size too small for child summaries.\n");
+		state->aggregate = NULL;
+		state->bitmap = NULL;
+	}
+	if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0)
+		state->maxInteriorRecordsPerPage = (state->buffer->pageSize - state->headerSize - sizeof(id_t) - SBTREE_CHILD_SUMMARY_SIZE(state))
+											/ (state->keySize + sizeof(id_t) + SBTREE_CHILD_SUMMARY_SIZE(state));
+
+	/* Filters start unknown (all bits set) so leaves without a filter are read. Bits per key is about numHashes / ln 2. */
+	if (state->bloomFilter != NULL)
+	{
+		sbtreeBloomFilter *bf = state->bloomFilter;
+		uint32_t bitsPerKey = (uint32_t) (bf->filterSize - bf->filterSize % sizeof(uint64_t)) * 8 / state->maxRecordsPerPage;
+
+		bf->numHashes = bitsPerKey * 69 / 100;
+		if (bf->numHashes < 1)
+			bf->numHashes = 1;
+		if (bf->numHashes > SBTREE_BLOOM_MAX_HASHES)
+			bf->numHashes = SBTREE_BLOOM_MAX_HASHES;
+		bf->numSkipped = 0;
+		bf->numFalsePositives = 0;
+		memset(bf->filters, 0xFF, (size_t) bf->maxPages * bf->filterSize);
+	}
 
 	/* Hard-code for testing */
 //	state->maxRecordsPerPage = 10;
 //	state->maxInteriorRecordsPerPage = 3;	
 	state->levels = 1;
 	state->numNodes = 0;
+	if (state->readAhead != NULL)
+		state->readAhead->count = 0;
+}
+
+/**
+@brief     	Writes value log page being appended. Page is stamped with its page id and number of bytes used
+			like tree pages. A partial page is written again when it is flushed after more values are appended.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageId
+                Log page id
+@param     	used
+                Number of value bytes in page
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeValueLogWrite(sbtreeState *state, id_t pageId, count_t used)
+{
+	sbtreeValueLog *log = state->valueLog;
+
+	SBTREE_GET_ID(log->buffer) = pageId;
+	*((count_t*) (log->buffer + SBTREE_COUNT_OFFSET)) = used;
+	dbbufferSetChecksum(state->buffer, log->buffer);
+	if (log->storage->writePage(log->storage, pageId, state->buffer->pageSize, log->buffer) != 0)
+		return -1;
+	log->numWrites++;
+	return 0;
+}
+
+/**
+@brief     	Writes partial value log page and flushes log storage. Called before leaves that may refer to
+			values in the log are flushed so values are on storage before records.
+@param     	state
+                SBTree algorithm state structure
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeValueLogFlush(sbtreeState *state)
+{
+	sbtreeValueLog *log = state->valueLog;
+	uint32_t capacity = SBTREE_VALUE_LOG_CAPACITY(state);
+
+	if (log->end % capacity != 0 && sbtreeValueLogWrite(state, log->end / capacity, log->end % capacity) != 0)
+		return -1;
+	log->storage->flush(log->storage);
+	return 0;
+}
+
+/**
+@brief     	Initializes empty value log.
+@param     	state
+                SBTree algorithm state structure
+*/
+static void sbtreeValueLogInit(sbtreeState *state)
+{
+	sbtreeValueLog *log = state->valueLog;
+
+	log->end = 0;
+	log->readPageId = -1;
+	log->numReads = 0;
+	log->numWrites = 0;
+	memset(log->buffer, 0, state->buffer->pageSize);
+}
+
+/**
+@brief     	Initialize an SBTree structure.
+@param     	state
+                SBTree algorithm state structure
+*/
+void sbtreeInit(sbtreeState *state)
+{
+	sbtreeSetup(state);
+	if (state->valueLog != NULL)
+		sbtreeValueLogInit(state);
+
+	/* Reserve superblock pages */
+	if (state->checkpoint != NULL)
+	{
+		state->buffer->nextPageId = SBTREE_SUPERBLOCK_PAGES;
+		state->buffer->nextPageWriteId = SBTREE_SUPERBLOCK_PAGES;
+	}
 
 	/* Create and write empty root node */
 	state->writeBuffer = initBufferPage(state->buffer, 0);
 	SBTREE_SET_ROOT(state->writeBuffer);		
 	state->activePath[0] = writePage(state->buffer, state->writeBuffer);		/* Store root location */	
 
+	/* Write both superblocks so either can be read on open */
+	if (state->checkpoint != NULL)
+	{
+		state->checkpoint->sequence = 0;
+		state->checkpoint->numCheckpoints = 0;
+		state->checkpoint->numRelinked = 0;
+		sbtreeWriteSuperblock(state);
+		sbtreeWriteSuperblock(state);
+	}
+
 	/* Allocate first page of buffer as output page for data records */	
 	initBufferPage(state->buffer, 0);
 }
 
-
 /**
-@brief     	Return the smallest key in the node
+@brief     	Reads page from storage into buffer without using buffer pages. Pages are written
+			sequentially and physical page id is stamped in header by writePage().
 @param     	state
                 SBTree algorithm state structure
-@param     	buffer
-                In memory page buffer with node data
+@param     	storage
+                Storage of tree or value log
+@param     	pageId
+                Physical page id
+@param     	buf
+                Buffer to read page into
+@return		Return 1 if page was written by tree, 0 if page does not exist, was not written or is corrupt.
 */
-void* sbtreeGetMinKey(sbtreeState *state, void *buffer)
+static int8_t sbtreeReadStoredPage(sbtreeState *state, storageState *storage, id_t pageId, void *buf)
 {
-	return (void*) (buffer+state->headerSize);
+	state->buffer->numReads++;
+	if (storage->readPage(storage, pageId, state->buffer->pageSize, buf) != 0)
+		return 0;
+	return SBTREE_GET_ID(buf) == pageId && dbbufferVerifyChecksum(state->buffer, buf) == 0;
 }
 
 /**
-@brief     	Return the smallest key in the node
+@brief     	Finds end of written pages. Pages are written sequentially so uses exponential then binary search.
 @param     	state
                 SBTree algorithm state structure
-@param     	buffer
-                In memory page buffer with node data
+@param     	storage
+                Storage of tree or value log
+@param     	start
+                Physical page id to start search at. Pages before start are written.
+@param     	buf
+                Buffer for reading pages
+@return		Return first page id at or after start that is not written.
 */
-void* sbtreeGetMaxKey(sbtreeState *state, void *buffer)
+static id_t sbtreeFindEnd(sbtreeState *state, storageState *storage, id_t start, void *buf)
 {
-	int16_t count =  SBTREE_GET_COUNT(buffer); 
-	if (count == 0)
-		count = 1;		/* Force to have value in buffer. May not make sense but likely initialized to 0. */
-	return (void*) (buffer+state->headerSize+(count-1)*state->recordSize);
+	id_t	low = start, high = start+1, mid;
+
+	if (!sbtreeReadStoredPage(state, storage, start, buf))
+		return start;
+	while (sbtreeReadStoredPage(state, storage, high, buf))
+	{
+		low = high;
+		high = start + 2*(high-start);
+	}
+	while (high - low > 1)
+	{
+		mid = low + (high - low) / 2;
+		if (sbtreeReadStoredPage(state, storage, mid, buf))
+			low = mid;
+		else
+			high = mid;
+	}
+	return high;
 }
 
+/**
+@brief     	Opens value log. End of log is after the last value in the last page written. The last page
+			is read into the append page if it is partial so values are appended to it.
+@param     	state
+                SBTree algorithm state structure
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeValueLogOpen(sbtreeState *state)
+{
+	sbtreeValueLog *log = state->valueLog;
+	uint32_t capacity = SBTREE_VALUE_LOG_CAPACITY(state);
+	id_t	end;
+
+	sbtreeValueLogInit(state);
+	end = sbtreeFindEnd(state, log->storage, 0, log->buffer);
+	memset(log->buffer, 0, state->buffer->pageSize);
+	if (end == 0)
+		return 0;
+	if (!sbtreeReadStoredPage(state, log->storage, end-1, log->buffer))
+		return -1;
+	log->end = (end-1)*capacity + *((count_t*) (log->buffer + SBTREE_COUNT_OFFSET));
+	if (log->end % capacity == 0)
+		memset(log->buffer, 0, state->buffer->pageSize);
+	return 0;
+}
 
 /**
-@brief     	Print a node in an in-memory buffer.
+@brief     	Recovers active path from a root written by sbtreeSync(). Sync writes active path nodes
+			bottom up so the last child of each node was written immediately before the node.
 @param     	state
                 SBTree algorithm state structure
-@param     	pageNum
-                Physical page id (number)	
-@param     	depth
-                Used for nesting print out
-@param     	buffer
-                In memory page buffer with node data
+@param     	root
+                Physical page id of root
+@param     	buf
+                Buffer for reading pages
+@return		Return 0 if success. Non-zero value if page is not a root written by sync.
 */
-void sbtreePrintNodeBuffer(sbtreeState *state, int pageNum, int depth, void *buffer)
+static int8_t sbtreeRecoverPath(sbtreeState *state, id_t root, void *buf)
 {
-	int16_t c, count =  SBTREE_GET_COUNT(buffer); 
+	id_t	pageId = root, childId, nodes = 1, total = 1, fanout = state->maxInteriorRecordsPerPage+1;
+	count_t	count;
+	int8_t	l;
 
-	if (SBTREE_IS_INTERIOR(buffer))
-	{		
-		printf("%*cId: %d Page: %d Cnt: %d [%d, %d]\n", depth*3, ' ', SBTREE_GET_ID(buffer), pageNum, count, (SBTREE_IS_ROOT(buffer)), SBTREE_IS_INTERIOR(buffer));		
-		/* Print data records (optional) */	
-		printf("%*c", depth*3+2, ' ');	
-		for (c=0; c < count && c < state->maxInteriorRecordsPerPage; c++)
-		{			
-			int32_t key = *((int32_t*) (buffer+state->keySize * c + state->headerSize));
-			int32_t val = *((int32_t*) (buffer+state->keySize * state->maxInteriorRecordsPerPage + state->headerSize + c*sizeof(id_t)));
-			printf(" (%d, %d)", key, val);			
-		}
-		/* Print last pointer */
-		int32_t val = *((int32_t*) (buffer+state->keySize * state->maxInteriorRecordsPerPage + state->headerSize + c*sizeof(id_t)));
-		printf(" (, %d)\n", val);
-	}
-	else
-	{		
-		printf("%*cId: %d Pg: %d Cnt: %d (%d, %d)\n", depth*3, ' ', SBTREE_GET_ID(buffer), pageNum, count, *((int32_t*) sbtreeGetMinKey(state, buffer)), *((int32_t*) sbtreeGetMaxKey(state, buffer)));
-		/* Print data records (optional) */
-		/*
-		for (int c=0; c < count; c++)
+	/* Prefix nodes hold a variable number of children. Number of nodes is estimated as if separators are not compressed. */
+	if (state->parameters & SBTREE_PREFIX_KEYS)
+		fanout = (state->buffer->pageSize - SBTREE_PREFIX_HEADER(state) - sizeof(id_t)) / (state->keySize+sizeof(id_t)) + 1;
+
+	for (l=0; l < MAX_LEVEL; l++)
+	{
+		if (!sbtreeReadStoredPage(state, state->buffer->storage, pageId, buf) || !SBTREE_IS_INTERIOR(buf) || SBTREE_IS_ROOT(buf) != (l == 0))
+			return -1;
+		state->activePath[l] = pageId;
+		count = SBTREE_GET_COUNT(buf);
+		childId = *((id_t*) sbtreeChildPtr(state, buf, count));
+
+		/* Root above leaf level has at least one key. Empty root means no leaves were written. */
+		if (l == 0 && count == 0)
 		{
-			int32_t key = *((int32_t*) (buffer + state->headerSize + state->recordSize * c));
-			int32_t val = *((int32_t*) (buffer + state->headerSize + state->recordSize * c + state->keySize));
-			printf("%*cKey: %d Value: %d\n", depth*3+2, ' ', key, val);			
-		}	
-		*/
+			state->levels = 1;
+			state->numNodes = 0;
+			return 0;
+		}
+
+		/* Node is above leaf level if first child is a leaf */
+		if (!sbtreeReadStoredPage(state, state->buffer->storage, *((id_t*) sbtreeChildPtr(state, buf, 0)), buf))
+			return -1;
+		/* Nodes on active path are last node at their level. Other nodes at level are full (maxInteriorRecordsPerPage+1 children). */
+		if (!SBTREE_IS_INTERIOR(buf))
+		{	/* Count leaves. Initial root is not counted. */
+			state->levels = l+1;
+			state->numNodes = total-1 + (nodes-1)*fanout + count;
+			return 0;
+		}
+		nodes = (nodes-1)*fanout + count+1;
+		total += nodes;
+		if (childId != pageId-1)
+			return -1;
+		pageId = childId;
 	}
+	return -1;
 }
 
-
 /**
-@brief     	Print a node read from storage.
+@brief     	Opens an SBTree structure previously written to storage and synced with sbtreeSync().
+			Storage must be opened without truncating (e.g. fileStorageOpen()).
+			Active path, levels, number of nodes (including leaves written by flush) and next page
+			to write are recovered from the last root written by sync. Reads O(log N + levels) pages.
+			Records inserted after the last sync may not be recovered. Spline (if used) is not rebuilt and is disabled.
 @param     	state
                 SBTree algorithm state structure
-@param     	pageNum
-                Physical page id (number)	
-@param     	depth
-                Used for nesting print out
+@return		Return 0 if success. Non-zero value if storage does not contain a tree.
 */
-void sbtreePrintNode(sbtreeState *state, int pageNum, int depth)
+int8_t sbtreeOpen(sbtreeState *state)
 {
-	void* buf = readPage(state->buffer, pageNum);
-	
-	int16_t c, count =  SBTREE_GET_COUNT(buf); 	
+	id_t	low, mid;
+	void	*buf;
 
-	sbtreePrintNodeBuffer(state, pageNum, depth, buf);
-	if (SBTREE_IS_INTERIOR(buf))
-	{				
-		for (c=0; c < count && c < state->maxInteriorRecordsPerPage; c++)
-		{			
-			int32_t val = *((int32_t*) (buf+state->keySize * state->maxInteriorRecordsPerPage + state->headerSize + c*sizeof(id_t)));
-			
-			sbtreePrintNode(state, val, depth+1);	
-			buf = readPage(state->buffer, pageNum);			
-		}	
-		/* Print last child node if active */
-		int32_t val = *((int32_t*) (buf+state->keySize * state->maxInteriorRecordsPerPage + state->headerSize + c*sizeof(id_t)));
-		if (val != 0)	
-		{
-			if (depth+1 < state->levels && pageNum == state->activePath[depth])
-			{	/* Current pointer is on active path. */
-				if (state->activePath[depth+1] != val)
-					printf("%*cNode mapping. Node: %lu Current: %lu\n",depth*3, ' ', val, state->activePath[depth+1]);
-				val = state->activePath[depth+1];
-			}	
-			sbtreePrintNode(state, val, depth+1);	
-		}
-	}	
+	state->spline = NULL;
+	sbtreeSetup(state);
+	buf = initBufferPage(state->buffer, 0);
+
+	if (state->valueLog != NULL && sbtreeValueLogOpen(state) != 0)
+		return -1;
+
+	if (state->checkpoint != NULL)
+		return sbtreeRecoverCheckpoint(state, buf);
+
+	if (!sbtreeReadStoredPage(state, state->buffer->storage, 0, buf))
+		return -1;
+	low = sbtreeFindEnd(state, state->buffer->storage, 0, buf) - 1;
+
+	/* Last root written by sync. Pages after it were written after sync and are not in tree. */
+	for (mid = low+1; mid > 0; mid--)
+	{
+		if (sbtreeReadStoredPage(state, state->buffer->storage, mid-1, buf) && SBTREE_IS_ROOT(buf) && sbtreeRecoverPath(state, mid-1, buf) == 0)
+			break;
+	}
+	if (mid == 0)
+		return -1;
+
+	/* New pages are written after all existing pages */
+	state->buffer->nextPageId = low+1;
+	state->buffer->nextPageWriteId = low+1;
+
+	/* Allocate first page of buffer as output page for data records */
+	state->writeBuffer = initBufferPage(state->buffer, 0);
+	return 0;
 }
 
 
 /**
-@brief     	Print current SBTree as written on storage.
-@param     	state
-                SBTree algorithm state structure
+@brief     	Reads bits from a 64-bit word starting at bit position.
+@param     	p
+                Start of bit-packed values
+@param     	pos
+                Bit position of value
+@param     	bits
+                Number of bits in value (at most SBTREE_DELTA_MAX_BITS)
 */
-void sbtreePrint(sbtreeState *state)
-{	
-	printf("\n\nPrint tree:\n");
-	sbtreePrintNode(state, state->activePath[0], 0);
+static uint64_t sbtreeGetBits(uint8_t *p, uint32_t pos, uint8_t bits)
+{
+	uint64_t w;
+
+	memcpy(&w, p + pos/8, sizeof(uint64_t));
+	return (w >> (pos % 8)) & ((((uint64_t) 1) << bits) - 1);
 }
 
+/**
+@brief     	Writes bits into a 64-bit word starting at bit position. Other bits are not changed.
+@param     	p
+                Start of bit-packed values
+@param     	pos
+                Bit position of value
+@param     	bits
+                Number of bits in value (at most SBTREE_DELTA_MAX_BITS)
+@param     	v
+                Value
+*/
+static void sbtreeSetBits(uint8_t *p, uint32_t pos, uint8_t bits, uint64_t v)
+{
+	uint64_t w, mask = ((((uint64_t) 1) << bits) - 1) << (pos % 8);
+
+	memcpy(&w, p + pos/8, sizeof(uint64_t));
+	w = (w & ~mask) | ((v << (pos % 8)) & mask);
+	memcpy(p + pos/8, &w, sizeof(uint64_t));
+}
 
 /**
-@brief     	Updates the B-tree index structure from leaf node to root node as required.
+@brief     	Returns difference between key and base key (key must not be less than base).
 @param     	state
                 SBTree algorithm state structure
-@param     	minkey
-                smallest key in currently full buffer page
 @param     	key
-                current key being inserted				
-@param     	pageNum
-                Physical page id of full leaf page just written to storage
+                Key
+@param     	base
+                Base (first) key of leaf
 */
-int8_t sbtreeUpdateIndex(sbtreeState *state, void *minkey, void *key, id_t pageNum)
-{		
+static uint64_t sbtreeKeyDelta(sbtreeState *state, void *key, void *base)
+{
+	if (state->keySize == sizeof(int64_t))
+		return (uint64_t) *((int64_t*) key) - (uint64_t) *((int64_t*) base);
+	return (uint32_t) (*((uint32_t*) key) - *((uint32_t*) base));
+}
+
+/**
+@brief     	Returns key delta of record in leaf with SBTREE_DELTA_KEYS.
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                In memory page buffer with leaf
+@param     	i
+                Record number
+*/
+static uint64_t sbtreeLeafDelta(sbtreeState *state, void *buffer, count_t i)
+{
+	uint8_t bits = *((uint8_t*) buffer + state->headerSize + state->keySize);
+	return sbtreeGetBits((uint8_t*) buffer + SBTREE_DELTA_HEADER(state), (uint32_t) i*bits, bits);
+}
+
+/**
+@brief     	Copies key of record in leaf.
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                In memory page buffer with leaf
+@param     	i
+                Record number
+@param     	key
+                Pre-allocated memory for key
+*/
+static void sbtreeLeafKey(sbtreeState *state, void *buffer, count_t i, void *key)
+{
+	uint64_t delta;
+
+	if (!(state->parameters & SBTREE_DELTA_KEYS))
+	{
+		memcpy(key, buffer + state->headerSize + state->recordSize*i, state->keySize);
+		return;
+	}
+	delta = sbtreeLeafDelta(state, buffer, i);
+	if (state->keySize == sizeof(int64_t))
+		*((uint64_t*) key) = *((uint64_t*) (buffer + state->headerSize)) + delta;
+	else
+		*((uint32_t*) key) = *((uint32_t*) (buffer + state->headerSize)) + (uint32_t) delta;
+}
+
+/**
+@brief     	Returns pointer to data of record in leaf.
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                In memory page buffer with leaf
+@param     	i
+                Record number
+*/
+static void* sbtreeLeafData(sbtreeState *state, void *buffer, count_t i)
+{
+	if (state->parameters & SBTREE_DELTA_KEYS)
+		return buffer + state->buffer->pageSize - (i+1)*state->dataSize;
+	return buffer + state->headerSize + state->recordSize*i + state->keySize;
+}
+
+/**
+@brief     	Returns 1 if record with key can be added to leaf with SBTREE_DELTA_KEYS.
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                In memory page buffer with leaf
+@param     	count
+                Number of records in leaf
+@param     	key
+                Key of record to add
+*/
+static int8_t sbtreeDeltaLeafFits(sbtreeState *state, void *buffer, count_t count, void *key)
+{
+	uint8_t bits = *((uint8_t*) buffer + state->headerSize + state->keySize);
+	uint64_t delta;
+
+	if (count == 0)
+		return 1;
+	delta = sbtreeKeyDelta(state, key, buffer + state->headerSize);
+	while (bits < SBTREE_DELTA_MAX_BITS && (delta >> bits) != 0)
+		bits++;
+	if ((delta >> bits) != 0)
+		return 0;
+	return SBTREE_DELTA_HEADER(state) + ((uint32_t) (count+1)*bits + 7)/8 + SBTREE_DELTA_SLACK + (uint32_t) (count+1)*state->dataSize <= state->buffer->pageSize;
+}
+
+/**
+@brief     	Adds record to leaf with SBTREE_DELTA_KEYS. Record must fit (see sbtreeDeltaLeafFits()).
+			Existing deltas are repacked if the new delta needs more bits. Count is not updated.
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                In memory page buffer with leaf
+@param     	count
+                Number of records in leaf
+@param     	key
+                Key for record
+@param     	data
+                Data for record
+*/
+static void sbtreeDeltaLeafAdd(sbtreeState *state, void *buffer, count_t count, void *key, void *data)
+{
+	uint8_t *bits = (uint8_t*) buffer + state->headerSize + state->keySize, *deltas = (uint8_t*) buffer + SBTREE_DELTA_HEADER(state);
+	uint8_t newBits;
+	uint64_t delta = 0;
+	int32_t i;
+
+	if (count == 0)
+	{
+		memcpy(buffer + state->headerSize, key, state->keySize);
+		*bits = 0;
+	}
+	else
+		delta = sbtreeKeyDelta(state, key, buffer + state->headerSize);
+
+	for (newBits = *bits; (delta >> newBits) != 0; newBits++);
+	if (newBits > *bits)
+	{	/* Repack from last delta so deltas not yet moved are not overwritten */
+		for (i=count-1; i >= 0; i--)
+			sbtreeSetBits(deltas, (uint32_t) i*newBits, newBits, sbtreeGetBits(deltas, (uint32_t) i*(*bits), *bits));
+		*bits = newBits;
+	}
+	sbtreeSetBits(deltas, (uint32_t) count*newBits, newBits, delta);
+	memcpy(sbtreeLeafData(state, buffer, count), data, state->dataSize);
+}
+
+/**
+@brief     	Searches leaf with SBTREE_DELTA_KEYS. Deltas are sorted so binary search compares deltas
+			without decoding keys.
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                In memory page buffer with leaf
+@param     	key
+                Search key
+@param		range
+				1 if range query so return pointer to first record <= key, 0 if exact query so much return first exact match record
+@return		Record number or -1 if not found.
+*/
+static id_t sbtreeSearchDeltaLeaf(sbtreeState *state, void *buffer, void *key, int8_t range)
+{
+	int16_t first = 0, last = SBTREE_GET_COUNT(buffer), middle;
+	uint64_t delta = 0;
+
+	if (last > 0 && state->compareKey(key, buffer + state->headerSize) >= 0)
+	{	/* First record with delta >= search key delta */
+		delta = sbtreeKeyDelta(state, key, buffer + state->headerSize);
+		while (first < last)
+		{
+			middle = (first + last)/2;
+			state->numProbes++;
+			if (sbtreeLeafDelta(state, buffer, middle) < delta)
+				first = middle + 1;
+			else
+				last = middle;
+		}
+		if (first < SBTREE_GET_COUNT(buffer) && sbtreeLeafDelta(state, buffer, first) == delta)
+			return first;
+	}
+	if (range)
+		return first > 0 ? first-1 : 0;
+	return -1;
+}
+
+/**
+@brief     	Returns length of key without trailing zero bytes.
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key
+*/
+static uint8_t sbtreeKeyLength(sbtreeState *state, void *key)
+{
+	uint8_t len = state->keySize;
+
+	while (len > 0 && ((uint8_t*) key)[len-1] == 0)
+		len--;
+	return len;
+}
+
+/**
+@brief     	Returns separator i of interior node. With SBTREE_PREFIX_KEYS, separator is decoded into key.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node
+@param		i
+				Separator index
+@param     	key
+                Pre-allocated memory for key (used if separator is decoded)
+@return		Pointer to separator.
+*/
+static void* sbtreeSeparator(sbtreeState *state, void *buf, count_t i, void *key)
+{
+	uint8_t *p = (uint8_t*) buf + state->headerSize;
+
+	if (!(state->parameters & SBTREE_PREFIX_KEYS))
+		return p + state->keySize*i;
+	memset(key, 0, state->keySize);
+	memcpy(key, p + 2, p[0]);
+	memcpy(key + p[0], p + 2 + p[0] + p[1]*i, p[1]);
+	return key;
+}
+
+/**
+@brief     	Calculates prefix length and slot width of interior node with SBTREE_PREFIX_KEYS after adding a separator.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node
+@param     	count
+                Number of separators in node
+@param     	key
+                Separator to add
+@param     	len
+                Prefix length (returned)
+@param     	width
+                Slot width (returned)
+*/
+static void sbtreePrefixLayout(sbtreeState *state, void *buf, count_t count, void *key, uint8_t *len, uint8_t *width)
+{
+	uint8_t *p = (uint8_t*) buf + state->headerSize, keyLen = sbtreeKeyLength(state, key), n = 0;
+
+	if (count == 0)
+	{
+		*len = keyLen;
+		*width = 0;
+		return;
+	}
+	while (n < p[0] && p[2+n] == ((uint8_t*) key)[n])
+		n++;
+	*len = n;
+	*width = p[0] + p[1] - n;
+	if (keyLen > n && keyLen - n > *width)
+		*width = keyLen - n;
+}
+
+/**
+@brief     	Returns 1 if separator and one more child id fit in interior node with SBTREE_PREFIX_KEYS.
+			Child id after last separator is kept empty for nodes above leaf level.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node
+@param     	count
+                Number of separators in node
+@param     	key
+                Separator to add
+*/
+static int8_t sbtreePrefixFits(sbtreeState *state, void *buf, count_t count, void *key)
+{
+	uint8_t len, width;
+
+	sbtreePrefixLayout(state, buf, count, key, &len, &width);
+	return SBTREE_PREFIX_HEADER(state) + len + (uint32_t) (count+1)*width + (uint32_t) (count+2)*sizeof(id_t) <= state->buffer->pageSize;
+}
+
+/**
+@brief     	Stores separator at index count of interior node. With SBTREE_PREFIX_KEYS, existing slots are
+			re-encoded if prefix becomes shorter or slots wider. Separator must fit (see sbtreePrefixFits()).
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node
+@param     	count
+                Number of separators in node
+@param     	key
+                Separator to add
+*/
+static void sbtreeSetSeparator(sbtreeState *state, void *buf, count_t count, void *key)
+{
+	uint8_t *p = (uint8_t*) buf + state->headerSize, len, width, oldLen = p[0], oldWidth = p[1];
+	uint8_t prefix[SBTREE_MAX_KEY_SIZE], slot[SBTREE_MAX_KEY_SIZE];
+	int16_t i;
+
+	if (!(state->parameters & SBTREE_PREFIX_KEYS))
+	{
+		memcpy(p + state->keySize*count, key, state->keySize);
+		return;
+	}
+	sbtreePrefixLayout(state, buf, count, key, &len, &width);
+	if (count == 0)
+		memcpy(p + 2, key, len);
+	else if (len != oldLen || width != oldWidth)
+	{	/* Slots move to higher offsets (except first) so re-encode from last to first. Removed prefix bytes start each slot. */
+		memcpy(prefix, p + 2, oldLen);
+		memset(slot, 0, width);
+		memcpy(slot, prefix + len, oldLen - len);
+		for (i = count-1; i >= 0; i--)
+		{
+			memcpy(slot + oldLen - len, p + 2 + oldLen + oldWidth*i, oldWidth);
+			memcpy(p + 2 + len + width*i, slot, width);
+		}
+	}
+	p[0] = len;
+	p[1] = width;
+	memset(p + 2 + len + width*count, 0, width);
+	memcpy(p + 2 + len + width*count, key + len, sbtreeKeyLength(state, key) > len ? sbtreeKeyLength(state, key) - len : 0);
+}
+
+/**
+@brief     	Returns number of separators <= key in interior node with SBTREE_PREFIX_KEYS.
+			Separators are zero padded so a separator with the same bytes as the start of the key is <= key.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node
+@param     	key
+                Search key
+*/
+static int16_t sbtreeSearchPrefixNode(sbtreeState *state, void *buf, void *key)
+{
+	uint8_t *p = (uint8_t*) buf + state->headerSize, len = p[0], width = p[1];
+	int16_t first = 0, last = SBTREE_GET_COUNT(buf), middle;
+	int		c;
+
+	if (last == 0)
+		return 0;
+	c = memcmp(key, p + 2, len);
+	if (c != 0)
+		return c < 0 ? 0 : last;
+	while (first < last)
+	{
+		middle = (first + last)/2;
+		state->numProbes++;
+		if (memcmp(key + len, p + 2 + len + width*middle, width) >= 0)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+/**
+@brief     	Sets next to a key greater than key. Integer keys are incremented. Other keys are incremented as
+			unsigned byte strings (smallest greater key if keys order as byte strings). If compareKey does not
+			order the result after key, first 4 bytes are incremented as an integer as for default comparison.
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key
+@param     	next
+                Pre-allocated memory for next key
+*/
+static void sbtreeNextKey(sbtreeState *state, void *key, void *next)
+{
+	int16_t i;
+
+	memcpy(next, key, state->keySize);
+	if (state->keySize == sizeof(int64_t))
+	{
+		*((int64_t*) next) = *((int64_t*) key)+1;
+		return;
+	}
+	if (state->keySize != sizeof(int32_t))
+	{
+		for (i = state->keySize-1; i >= 0 && ++((uint8_t*) next)[i] == 0; i--)
+			;
+		if ((state->parameters & SBTREE_PREFIX_KEYS) || state->compareKey(next, key) > 0)
+			return;
+		memcpy(next, key, state->keySize);
+	}
+	*((int32_t*) next) = *((int32_t*) key)+1;
+}
+
+/**
+@brief     	Sets separator between a leaf with largest key prev and the next leaf with smallest key next.
+			With SBTREE_PREFIX_KEYS, separator is the shortest prefix of next that is greater than prev
+			(zero padded). Otherwise, separator is next.
+@param     	state
+                SBTree algorithm state structure
+@param     	prev
+                Largest key of leaf
+@param     	next
+                Smallest key of next leaf
+@param     	sep
+                Pre-allocated memory for separator
+*/
+static void sbtreeSeparatorKey(sbtreeState *state, void *prev, void *next, void *sep)
+{
+	uint8_t len = 0;
+
+	memcpy(sep, next, state->keySize);
+	if (!(state->parameters & SBTREE_PREFIX_KEYS))
+		return;
+	while (len < state->keySize && ((uint8_t*) prev)[len] == ((uint8_t*) next)[len])
+		len++;
+	if (len < state->keySize)
+		memset(sep + len + 1, 0, state->keySize - len - 1);
+}
+
+/**
+@brief     	Return the smallest key in the node
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                In memory page buffer with node data
+*/
+void* sbtreeGetMinKey(sbtreeState *state, void *buffer)
+{
+	return (void*) (buffer+state->headerSize);
+}
+
+/**
+@brief     	Return the smallest key in the node
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                In memory page buffer with node data
+*/
+void* sbtreeGetMaxKey(sbtreeState *state, void *buffer)
+{
+	int16_t count =  SBTREE_GET_COUNT(buffer); 
+	if (count == 0)
+		count = 1;		/* Force to have value in buffer. May not make sense but likely initialized to 0. */
+	if (state->parameters & SBTREE_DELTA_KEYS)
+	{	/* Key is decoded into temporary key */
+		sbtreeLeafKey(state, buffer, count-1, state->tempKey);
+		return state->tempKey;
+	}
+	return (void*) (buffer+state->headerSize+(count-1)*state->recordSize);
+}
+
+
+/**
+@brief     	Print a node in an in-memory buffer.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageNum
+                Physical page id (number)	
+@param     	depth
+                Used for nesting print out
+@param     	buffer
+                In memory page buffer with node data
+*/
+void sbtreePrintNodeBuffer(sbtreeState *state, int pageNum, int depth, void *buffer)
+{
+	int16_t c, count =  SBTREE_GET_COUNT(buffer); 
+	int64_t sepKey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+
+	if (SBTREE_IS_INTERIOR(buffer))
+	{		
+		printf("%*cId: %d Page: %d Cnt: %d [%d, %d]\n", depth*3, ' ', SBTREE_GET_ID(buffer), pageNum, count, (SBTREE_IS_ROOT(buffer)), SBTREE_IS_INTERIOR(buffer));		
+		/* Print data records (optional) */	
+		printf("%*c", depth*3+2, ' ');	
+		for (c=0; c < count && c < state->maxInteriorRecordsPerPage; c++)
+		{			
+			int32_t key = *((int32_t*) sbtreeSeparator(state, buffer, c, sepKey));
+			int32_t val = *((int32_t*) sbtreeChildPtr(state, buffer, c));
+			printf(" (%d, %d)", key, val);			
+		}
+		/* Print last pointer */
+		int32_t val = *((int32_t*) sbtreeChildPtr(state, buffer, c));
+		printf(" (, %d)\n", val);
+	}
+	else
+	{		
+		printf("%*cId: %d Pg: %d Cnt: %d (%d, %d)\n", depth*3, ' ', SBTREE_GET_ID(buffer), pageNum, count, *((int32_t*) sbtreeGetMinKey(state, buffer)), *((int32_t*) sbtreeGetMaxKey(state, buffer)));
+		/* Print data records (optional) */
+		/*
+		for (int c=0; c < count; c++)
+		{
+			int32_t key = *((int32_t*) (buffer + state->headerSize + state->recordSize * c));
+			int32_t val = *((int32_t*) (buffer + state->headerSize + state->recordSize * c + state->keySize));
+			printf("%*cKey: %d Value: %d\n", depth*3+2, ' ', key, val);			
+		}	
+		*/
+	}
+}
+
+
+/**
+@brief     	Print a node read from storage.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageNum
+                Physical page id (number)	
+@param     	depth
+                Used for nesting print out
+*/
+void sbtreePrintNode(sbtreeState *state, int pageNum, int depth)
+{
+	void* buf = readPage(state->buffer, pageNum);
+	
+	int16_t c, count =  SBTREE_GET_COUNT(buf); 	
+
+	sbtreePrintNodeBuffer(state, pageNum, depth, buf);
+	if (SBTREE_IS_INTERIOR(buf))
+	{				
+		for (c=0; c < count && c < state->maxInteriorRecordsPerPage; c++)
+		{			
+			int32_t val = *((int32_t*) sbtreeChildPtr(state, buf, c));
+			
+			sbtreePrintNode(state, val, depth+1);	
+			buf = readPage(state->buffer, pageNum);			
+		}	
+		/* Print last child node if active */
+		int32_t val = *((int32_t*) sbtreeChildPtr(state, buf, c));
+		if (val != 0)	
+		{
+			if (depth+1 < state->levels && pageNum == state->activePath[depth])
+			{	/* Current pointer is on active path. */
+				if (state->activePath[depth+1] != val)
+					printf("%*cNode mapping. Node: %lu Current: %lu\n",depth*3, ' ', val, state->activePath[depth+1]);
+				val = state->activePath[depth+1];
+			}	
+			sbtreePrintNode(state, val, depth+1);	
+		}
+	}	
+}
+
+
+/**
+@brief     	Print current SBTree as written on storage.
+@param     	state
+                SBTree algorithm state structure
+*/
+void sbtreePrint(sbtreeState *state)
+{	
+	printf("\n\nPrint tree:\n");
+	sbtreePrintNode(state, state->activePath[0], 0);
+}
+
+
+/**
+@brief     	Returns value of integer column. Little-endian column is sign-extended.
+@param     	p
+                Column in record data or child summary
+@param     	size
+                Size of column in bytes
+*/
+static int64_t sbtreeColumnValue(void *p, uint8_t size)
+{
+	int64_t	value = 0;
+
+	memcpy(&value, p, size);
+	if (size < sizeof(int64_t) && (value >> (size*8-1)) & 1)
+		value |= (int64_t) (~(uint64_t) 0 << (size*8));
+	return value;
+}
+
+/**
+@brief     	Returns bitmap with bit of bucket of bitmap column value.
+@param     	state
+                SBTree algorithm state structure
+@param     	value
+                Column value
+*/
+static uint64_t sbtreeBitmapBit(sbtreeState *state, int64_t value)
+{
+	sbtreeBitmap *bm = state->bitmap;
+	uint8_t	bits = bm->bitmapSize*8;
+
+	if (value <= bm->minValue)
+		return 1;
+	if (value >= bm->maxValue)
+		return (uint64_t) 1 << (bits-1);
+	/* Bucket width rounds up so largest value is in last bucket */
+	return (uint64_t) 1 << (((uint64_t) value - (uint64_t) bm->minValue) / (((uint64_t) bm->maxValue - (uint64_t) bm->minValue) / bits + 1));
+}
+
+/**
+@brief     	Returns bitmap of buckets with values in range. Returns 0 if range is empty.
+@param     	state
+                SBTree algorithm state structure
+@param     	min
+                Minimum column value (inclusive). NULL for no minimum.
+@param     	max
+                Maximum column value (inclusive). NULL for no maximum.
+*/
+static uint64_t sbtreeBitmapRange(sbtreeState *state, void *min, void *max)
+{
+	uint8_t	size = state->bitmap->size;
+	uint64_t first = 1, last = (uint64_t) 1 << (state->bitmap->bitmapSize*8-1);
+
+	if (min != NULL && max != NULL && sbtreeColumnValue(min, size) > sbtreeColumnValue(max, size))
+		return 0;
+	if (min != NULL)
+		first = sbtreeBitmapBit(state, sbtreeColumnValue(min, size));
+	if (max != NULL)
+		last = sbtreeBitmapBit(state, sbtreeColumnValue(max, size));
+	/* Bits from first to last bucket */
+	return (last - first) | last;
+}
+
+/**
+@brief     	Adds bucket of record data to bitmap in leaf header. Does nothing if bitmaps are not used.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing leaf
+@param     	data
+                Data of record
+*/
+static void sbtreeLeafBitmapAdd(sbtreeState *state, void *buf, void *data)
+{
+	uint64_t bitmap = 0;
+
+	if (state->bitmap == NULL)
+		return;
+	memcpy(&bitmap, buf + state->bmOffset, state->bitmap->bitmapSize);
+	bitmap |= sbtreeBitmapBit(state, sbtreeColumnValue(data + state->bitmap->offset, state->bitmap->size));
+	memcpy(buf + state->bmOffset, &bitmap, state->bitmap->bitmapSize);
+}
+
+/**
+@brief     	Adds record to summary. Records are added in key order.
+@param     	state
+                SBTree algorithm state structure
+@param     	s
+                Summary
+@param     	key
+                Key of record
+@param     	data
+                Data of record
+*/
+static void sbtreeSummaryAdd(sbtreeState *state, sbtreeSummary *s, void *key, void *data)
+{
+	int64_t value = sbtreeColumnValue(data + state->aggregate->offset, state->aggregate->size);
+
+	if (state->bitmap != NULL)
+		s->bitmap |= sbtreeBitmapBit(state, sbtreeColumnValue(data + state->bitmap->offset, state->bitmap->size));
+	if (s->count == 0 || value < s->min)
+		s->min = value;
+	if (s->count == 0 || value > s->max)
+		s->max = value;
+	if (s->count == 0)
+		memcpy(s->minKey, key, state->keySize);
+	memcpy(s->maxKey, key, state->keySize);
+	s->sum += value;
+	s->count++;
+}
+
+/**
+@brief     	Merges summary t into summary s. Records of t are after records of s in key order.
+@param     	state
+                SBTree algorithm state structure
+@param     	s
+                Summary updated
+@param     	t
+                Summary merged
+*/
+static void sbtreeSummaryMerge(sbtreeState *state, sbtreeSummary *s, sbtreeSummary *t)
+{
+	s->bitmap |= t->bitmap;
+	if (t->count == 0)
+		return;
+	if (s->count == 0)
+	{
+		s->min = t->min;
+		s->max = t->max;
+		memcpy(s->minKey, t->minKey, state->keySize);
+	}
+	if (t->min < s->min)
+		s->min = t->min;
+	if (t->max > s->max)
+		s->max = t->max;
+	memcpy(s->maxKey, t->maxKey, state->keySize);
+	s->sum += t->sum;
+	s->count += t->count;
+}
+
+/**
+@brief     	Copies child summary between interior node and summary structure. Aggregates are stored as count, sum,
+			column minimum and maximum (column size) and smallest and largest key. Bitmap follows aggregates.
+@param     	state
+                SBTree algorithm state structure
+@param     	p
+                Child summary in node
+@param     	s
+                Summary
+@param     	store
+                1 to store summary in node, 0 to load summary from node
+*/
+static void sbtreeSummaryCopy(sbtreeState *state, void *p, sbtreeSummary *s, int8_t store)
+{
+	uint8_t	size;
+	int64_t	*field[2] = { &s->min, &s->max };
+	int8_t	i;
+
+	if (!store)
+	{
+		s->count = 0;
+		s->bitmap = 0;
+	}
+	if (state->bitmap != NULL)
+	{
+		if (store)
+			memcpy(p + SBTREE_AGGREGATE_SIZE(state), &s->bitmap, state->bitmap->bitmapSize);
+		else
+			memcpy(&s->bitmap, p + SBTREE_AGGREGATE_SIZE(state), state->bitmap->bitmapSize);
+	}
+	if (state->aggregate == NULL)
+		return;
+
+	size = state->aggregate->size;
+	if (store)
+	{
+		memcpy(p, &s->count, sizeof(uint32_t));
+		memcpy(p + sizeof(uint32_t), &s->sum, sizeof(int64_t));
+		for (i=0; i < 2; i++)
+			memcpy(p + sizeof(uint32_t) + sizeof(int64_t) + size*i, field[i], size);
+		memcpy(p + sizeof(uint32_t) + sizeof(int64_t) + 2*size, s->minKey, state->keySize);
+		memcpy(p + sizeof(uint32_t) + sizeof(int64_t) + 2*size + state->keySize, s->maxKey, state->keySize);
+		return;
+	}
+	memcpy(&s->count, p, sizeof(uint32_t));
+	memcpy(&s->sum, p + sizeof(uint32_t), sizeof(int64_t));
+	for (i=0; i < 2; i++)
+		*field[i] = sbtreeColumnValue(p + sizeof(uint32_t) + sizeof(int64_t) + size*i, size);
+	memcpy(s->minKey, p + sizeof(uint32_t) + sizeof(int64_t) + 2*size, state->keySize);
+	memcpy(s->maxKey, p + sizeof(uint32_t) + sizeof(int64_t) + 2*size + state->keySize, state->keySize);
+}
+
+/**
+@brief     	Computes summary of all records in leaf. Does nothing if child summaries are not used.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing leaf
+@param     	s
+                Summary of leaf
+*/
+static void sbtreeLeafSummary(sbtreeState *state, void *buf, sbtreeSummary *s)
+{
+	int64_t	key[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+	count_t	i, count = SBTREE_GET_COUNT(buf);
+
+	if (SBTREE_CHILD_SUMMARY_SIZE(state) == 0)
+		return;
+	s->count = 0;
+	s->sum = 0;
+	s->bitmap = 0;
+	if (state->bitmap != NULL)
+		memcpy(&s->bitmap, buf + state->bmOffset, state->bitmap->bitmapSize);
+	if (state->aggregate == NULL)
+		return;
+	/* Key is copied to local memory as sbtreeGetMaxKey() and put use tempKey */
+	for (i=0; i < count; i++)
+	{
+		sbtreeLeafKey(state, buf, i, key);
+		sbtreeSummaryAdd(state, s, key, sbtreeLeafData(state, buf, i));
+	}
+}
+
+/**
+@brief     	Computes summary of interior node from summaries of its children.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node
+@param     	last
+                Index of last child
+@param     	s
+                Summary of node
+*/
+static void sbtreeNodeSummary(sbtreeState *state, void *buf, int32_t last, sbtreeSummary *s)
+{
+	sbtreeSummary child;
+	int32_t	i;
+
+	s->count = 0;
+	s->sum = 0;
+	s->bitmap = 0;
+	for (i=0; i <= last; i++)
+	{
+		sbtreeSummaryCopy(state, sbtreeSummaryPtr(state, buf, i), &child, 0);
+		sbtreeSummaryMerge(state, s, &child);
+	}
+}
+
+/**
+@brief     	Returns 64-bit hash of key (FNV-1a of key bytes with final mixing).
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key
+*/
+static uint64_t sbtreeKeyHash(sbtreeState *state, void *key)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	uint8_t	i;
+
+	for (i=0; i < state->keySize; i++)
+	{
+		h ^= ((uint8_t*) key)[i];
+		h *= 0x100000001b3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/**
+@brief     	Returns bits of key in its block of a leaf filter and sets block to byte offset of block in filter.
+			High bits of hash select the block and numHashes bits in the block are selected with double hashing.
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key
+@param     	block
+                Offset of block in filter (set)
+*/
+static uint64_t sbtreeFilterBits(sbtreeState *state, void *key, uint32_t *block)
+{
+	uint64_t h = sbtreeKeyHash(state, key), bits = 0;
+	uint32_t numBlocks = state->bloomFilter->filterSize / sizeof(uint64_t);
+	uint8_t	pos = h & 63, step = ((h >> 6) & 63) | 1, i;
+
+	*block = (uint32_t) (((h >> 32) * numBlocks) >> 32) * sizeof(uint64_t);
+	for (i=0; i < state->bloomFilter->numHashes; i++, pos = (pos + step) & 63)
+		bits |= (uint64_t) 1 << pos;
+	return bits;
+}
+
+/**
+@brief     	Returns pointer to filter of leaf or NULL if leaf has no filter.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageId
+                Page id of leaf
+*/
+static void* sbtreeLeafFilter(sbtreeState *state, id_t pageId)
+{
+	if (state->bloomFilter == NULL || pageId < 0 || pageId >= state->bloomFilter->maxPages)
+		return NULL;
+	return state->bloomFilter->filters + (size_t) pageId*state->bloomFilter->filterSize;
+}
+
+/**
+@brief     	Returns 1 if key may be in leaf with filter and 0 if key is not in leaf.
+@param     	state
+                SBTree algorithm state structure
+@param     	filter
+                Filter of leaf
+@param     	key
+                Key
+*/
+static int8_t sbtreeFilterContains(sbtreeState *state, void *filter, void *key)
+{
+	uint32_t block;
+	uint64_t bits = sbtreeFilterBits(state, key, &block), word;
+
+	memcpy(&word, filter + block, sizeof(uint64_t));
+	return (word & bits) == bits;
+}
+
+/**
+@brief     	Sets filter of leaf from keys in leaf. Called when leaf is written (and when it is read after open).
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing leaf
+@param     	pageId
+                Page id of leaf
+*/
+static void sbtreeLeafFilterSet(sbtreeState *state, void *buf, id_t pageId)
+{
+	int64_t	key[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+	void	*filter = sbtreeLeafFilter(state, pageId);
+	count_t	i, count = SBTREE_GET_COUNT(buf);
+	uint32_t block;
+	uint64_t bits, word;
+
+	if (filter == NULL)
+		return;
+	memset(filter, 0, state->bloomFilter->filterSize);
+	for (i=0; i < count; i++)
+	{
+		sbtreeLeafKey(state, buf, i, key);
+		bits = sbtreeFilterBits(state, key, &block);
+		memcpy(&word, filter + block, sizeof(uint64_t));
+		word |= bits;
+		memcpy(filter + block, &word, sizeof(uint64_t));
+	}
+}
+
+/**
+@brief     	Updates the B-tree index structure from leaf node to root node as required.
+@param     	state
+                SBTree algorithm state structure
+@param     	minkey
+                smallest key in currently full buffer page
+@param     	key
+                current key being inserted				
+@param     	pageNum
+                Physical page id of full leaf page just written to storage
+@param     	summary
+                Summary of leaf records (sbtreeLeafSummary()). Not used if aggregates are not used.
+*/
+int8_t sbtreeUpdateIndex(sbtreeState *state, void *minkey, void *key, id_t pageNum, sbtreeSummary *summary)
+{		
 	/* Read parent pages (nodes) until find space for new interior pointer (key, pageNum) */
 	int8_t l = 0;
 	int16_t count;
 	int32_t prevPageNum = -1;
-	void *buf;
+	void *buf, *sep;
+	sbtreeSummary prevSummary;					/* Summary of full node prevPageNum */
+
+	for (l=state->levels-1; l >= 0; l--)
+	{
+		/* Forcing all reads to buffer 0 guarantees no read conflicts but results in more I/Os */
+		// buf = readPageBuffer(state->buffer, state->activePath[l], 0);
+		buf = readPage(state->buffer, state->activePath[l]);	
+		if (buf == NULL)
+			return -1;		
+
+		/* Keep active path nodes in buffer so deferred updates are not written out by reads */
+		dbbufferPin(state->buffer, buf, l);
+		
+		/* Determine if there is space in the page */		
+		count =  SBTREE_GET_COUNT(buf); 
+		sep = l == state->levels-1 ? key : minkey;
+					
+		if ((state->parameters & SBTREE_PREFIX_KEYS) ? !sbtreePrefixFits(state, buf, count, sep) :
+			(count > state->maxInteriorRecordsPerPage) || (l < state->levels-1 && count >= state->maxInteriorRecordsPerPage))
+		{	/* Interior node at this level is full. Create a new node. */	
+
+			/* If tree is beyond level 1, update parent node last child pointer as will have changed. Currently in buffer. */
+			/* Summary of full node is computed from its children for its parent */
+			if (l < state->levels - 1)
+			{								
+				memcpy(sbtreeChildPtr(state, buf, count), &prevPageNum, sizeof(id_t));											
+				if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0)
+				{
+					sbtreeSummaryCopy(state, sbtreeSummaryPtr(state, buf, count), &prevSummary, 1);
+					sbtreeNodeSummary(state, buf, count, &prevSummary);
+				}
+				state->activePath[l]  = writePage(state->buffer, buf);				
+			}
+			else
+			{	/* If using deferred update, must write out full node */
+				if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0)
+					sbtreeNodeSummary(state, buf, count-1, &prevSummary);
+			 	state->activePath[l]  = writePage(state->buffer, buf);
+			}
+			/* Full node is no longer on active path */
+			dbbufferUnpin(state->buffer, buf);
+
+			state->numNodes++;
+			initBufferPage(state->buffer, 0);
+			SBTREE_SET_INTERIOR(state->writeBuffer);
+			buf = state->writeBuffer;
+
+			/* Store pointer to new leaf node */
+			/* For first interior node level above leaf the separator is the currently inserted key. For other levels no key inserted just pointer. */
+			if (l == state->levels-1)
+			{	sbtreeSetSeparator(state, buf, 0, key);
+				SBTREE_INC_COUNT(buf);	
+				if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0)
+					sbtreeSummaryCopy(state, sbtreeSummaryPtr(state, buf, 0), summary, 1);
+			}			
+			
+			/* Insert child pointer into new node */
+			memcpy(sbtreeChildPtr(state, buf, 0), &pageNum, sizeof(id_t));
+
+			/* Write page. Update active page mapping. */
+			prevPageNum = state->activePath[l];			
+			state->activePath[l] = writePage(state->buffer, buf);												
+			pageNum = state->activePath[l];						
+		}
+		else 
+		{
+			/* Copy record onto page */
+			/* Record is key just trying to insert (as above values already in block) and pageNum just written with previous data page */
+			/* Keep keys and data as contiguous sorted arrays */
+			if (count < state->maxInteriorRecordsPerPage)
+			{	/* Do not store key for last child pointer */ 
+				sbtreeSetSeparator(state, buf, count, sep);
+			}
+		
+			if (l == 0 && state->levels > 1)
+			{	/* Root is special case */
+				memcpy(sbtreeChildPtr(state, buf, count+1), &pageNum, sizeof(id_t));		
+				
+				/* Update previous pointer as may have changed due to writes. */
+				if (count > 0 && prevPageNum != -1)
+				{
+					memcpy(sbtreeChildPtr(state, buf, count), &prevPageNum, sizeof(id_t));	
+					if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0)
+						sbtreeSummaryCopy(state, sbtreeSummaryPtr(state, buf, count), &prevSummary, 1);
+				}
+			}
+			else
+			{
+				/* Update previous pointer as may have changed due to writes. */
+				if (prevPageNum != -1)
+				{										
+					memcpy(sbtreeChildPtr(state, buf, count), &prevPageNum, sizeof(id_t));	
+					if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0)
+						sbtreeSummaryCopy(state, sbtreeSummaryPtr(state, buf, count), &prevSummary, 1);
+					count++;					
+				}
+			
+				/* Add new child pointer to page */
+				memcpy(sbtreeChildPtr(state, buf, count), &pageNum, sizeof(id_t));						
+				/* Last child of nodes above is active so only leaves have a summary when added */
+				if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0 && l == state->levels-1)
+					sbtreeSummaryCopy(state, sbtreeSummaryPtr(state, buf, count), summary, 1);
+			}						
+				
+			/* Update count */
+			SBTREE_INC_COUNT(buf);	
+
+			/* Write updated interior page */								
+			/* Update location of page */
+			// state->activePath[l] = writePage(state->buffer, buf);
+
+			/* Deferring write and keeping updated page in buffer. */
+			/* Note: Requires writing page and updating active path if buffer is used for reading. */							
+			dbbufferSetModified(state->buffer, buf, l);					
+			break;
+		}		
+	}		 
+	
+	/* Handle the case where root is currently full */
+	/* Grow one level, shift everything down, and create new root */
+	if (l == -1)
+	{			
+		initBufferPage(state->buffer, 0);
+
+		/* Copy record onto page (minkey, prevPageNum) */
+		sbtreeSetSeparator(state, state->writeBuffer, 0, minkey);		
+		memcpy(sbtreeChildPtr(state, state->writeBuffer, 0), &prevPageNum, sizeof(id_t));
+		if (SBTREE_CHILD_SUMMARY_SIZE(state) > 0)
+			sbtreeSummaryCopy(state, sbtreeSummaryPtr(state, state->writeBuffer, 0), &prevSummary, 1);
+		
+		/* Copy greater than record on to page. Note: Basically child pointer and infinity for key */		
+		memcpy(sbtreeChildPtr(state, state->writeBuffer, 1), &state->activePath[0], sizeof(id_t));		
+
+		/* Update count */
+		SBTREE_INC_COUNT(state->writeBuffer);	
+		SBTREE_SET_ROOT(state->writeBuffer);
+		
+		for (l=state->levels; l > 0; l--)
+			state->activePath[l] = state->activePath[l-1]; 
+		state->activePath[0] = writePage(state->buffer, state->writeBuffer);	/* Store root location */			
+		state->levels++;
+		state->numNodes++;		
+	}
+	return 0;
+}
+
+/* Superblock identifier ("SBTC") */
+#define SBTREE_SUPERBLOCK_MAGIC		0x53425443
+
+/* Superblock stored after page header in page 0 or 1. Page with higher valid sequence number is current. */
+typedef struct {
+	uint32_t magic;
+	uint32_t sequence;
+	id_t	nextPageId;							/* Next page to write when checkpoint was written */
+	id_t	numNodes;
+	id_t	activePath[MAX_LEVEL];
+	uint8_t	levels;
+	uint8_t	keySize;
+	uint8_t	dataSize;
+	uint8_t	unused;
+	uint32_t checksum;							/* CRC32C of fields above */
+} sbtreeSuperblock;
+
+/**
+@brief     	Returns CRC32C checksum of superblock fields before checksum.
+@param     	sb
+                Superblock
+*/
+static uint32_t sbtreeSuperblockChecksum(sbtreeSuperblock *sb)
+{
+	return crc32cSelect(CRC32C_BEST)(0, sb, (uint32_t) ((int8_t*) &sb->checksum - (int8_t*) sb));
+}
+
+/**
+@brief     	Writes active path nodes from leaf level up. Each node stores the page id of its
+			last child, which is only kept in the active path while the node is in the buffer.
+@param     	state
+                SBTree algorithm state structure
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeWritePath(sbtreeState *state)
+{
+	void	*buf;
+	int8_t	l;
+
+	for (l=state->levels-1; l >= 0; l--)
+	{
+		buf = readPage(state->buffer, state->activePath[l]);
+		if (buf == NULL)
+			return -1;
+		if (l < state->levels-1)
+			memcpy(sbtreeChildPtr(state, buf, SBTREE_GET_COUNT(buf)), &state->activePath[l+1], sizeof(id_t));
+		state->activePath[l] = writePage(state->buffer, buf);
+	}
+	return 0;
+}
+
+/**
+@brief     	Writes next superblock (alternating between page 0 and 1) with current active path.
+			Superblock is built in output buffer, which must be empty. Storage is flushed after write.
+@param     	state
+                SBTree algorithm state structure
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeWriteSuperblock(sbtreeState *state)
+{
+	sbtreeCheckpoint *cp = state->checkpoint;
+	sbtreeSuperblock sb;
+	void	*buf;
+	id_t	pageId;
+
+	memset(&sb, 0, sizeof(sbtreeSuperblock));
+	sb.magic = SBTREE_SUPERBLOCK_MAGIC;
+	sb.sequence = cp->sequence+1;
+	sb.nextPageId = state->buffer->nextPageWriteId;
+	sb.numNodes = state->numNodes;
+	memcpy(sb.activePath, state->activePath, sizeof(id_t)*MAX_LEVEL);
+	sb.levels = state->levels;
+	sb.keySize = state->keySize;
+	sb.dataSize = state->dataSize;
+	sb.checksum = sbtreeSuperblockChecksum(&sb);
+
+	/* Superblock page is stamped with its page id like other pages */
+	pageId = sb.sequence % SBTREE_SUPERBLOCK_PAGES;
+	buf = initBufferPage(state->buffer, 0);
+	SBTREE_GET_ID(buf) = pageId;
+	memcpy(buf + state->headerSize, &sb, sizeof(sbtreeSuperblock));
+	dbbufferSetChecksum(state->buffer, buf);
+	if (state->buffer->storage->writePage(state->buffer->storage, pageId, state->buffer->pageSize, buf) != 0)
+		return -1;
+	state->buffer->numWrites++;
+	state->buffer->storage->flush(state->buffer->storage);
+	initBufferPage(state->buffer, 0);
+
+	cp->sequence = sb.sequence;
+	cp->lastPageId = state->buffer->nextPageId;
+	cp->lastTime = cp->getTime != NULL ? cp->getTime() : 0;
+	return 0;
+}
+
+/**
+@brief     	Writes a checkpoint. Active path nodes are written and storage is flushed before the superblock
+			is written so a superblock only refers to pages in storage. Output buffer must be empty.
+@param     	state
+                SBTree algorithm state structure
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeCheckpointWrite(sbtreeState *state)
+{
+	if (state->valueLog != NULL && sbtreeValueLogFlush(state) != 0)
+		return -1;
+	if (sbtreeWritePath(state) != 0)
+		return -1;
+	state->buffer->storage->flush(state->buffer->storage);
+	if (sbtreeWriteSuperblock(state) != 0)
+		return -1;
+	state->checkpoint->numCheckpoints++;
+	return 0;
+}
+
+/**
+@brief     	Returns 1 if checkpoint page or time interval has passed since last checkpoint.
+@param     	state
+                SBTree algorithm state structure
+*/
+static int8_t sbtreeCheckpointDue(sbtreeState *state)
+{
+	sbtreeCheckpoint *cp = state->checkpoint;
+
+	if (cp->maxPages > 0 && state->buffer->nextPageId - cp->lastPageId >= cp->maxPages)
+		return 1;
+	return cp->maxTime > 0 && cp->getTime != NULL && cp->getTime() - cp->lastTime >= cp->maxTime;
+}
+
+/**
+@brief     	Returns 1 if values of leaf records that are in value log are before end of log. Values are
+			appended in record order so only the last record with a value in the log is checked.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing leaf
+*/
+static int8_t sbtreeLeafValuesInLog(sbtreeState *state, void *buf)
+{
+	int16_t	i;
+	void	*data;
+	uint32_t offset;
+
+	for (i = SBTREE_GET_COUNT(buf)-1; i >= 0; i--)
+	{
+		data = sbtreeLeafData(state, buf, i);
+		if (sbtreeValueLength(state, data) > state->dataSize - SBTREE_VALUE_LENGTH_SIZE)
+		{
+			memcpy(&offset, data + SBTREE_VALUE_LENGTH_SIZE, sizeof(uint32_t));
+			return (uint64_t) offset + sbtreeValueLength(state, data) <= state->valueLog->end;
+		}
+	}
+	return 1;
+}
+
+/**
+@brief     	Recovers tree from the superblock with highest valid sequence number. Leaves written after the
+			checkpoint are re-linked into the tree in page order. Interior nodes written after the checkpoint
+			are not used. Writes a new checkpoint if any leaves were re-linked. With a value log, re-linking
+			stops at the first leaf with values that were not written to the log.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Output buffer (used for reading pages)
+@return		Return 0 if success. Non-zero value if no valid superblock or error.
+*/
+static int8_t sbtreeRecoverCheckpoint(sbtreeState *state, void *buf)
+{
+	sbtreeCheckpoint *cp = state->checkpoint;
+	sbtreeSuperblock sb, last;
+	id_t	pageId, end, prevPageId = 0;
+	int64_t	minKey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)], nextKey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+	int64_t	maxKey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)], sep[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+	sbtreeSummary summary, prevSummary;
+	int8_t	i, found = 0;
+
+	for (i=0; i < SBTREE_SUPERBLOCK_PAGES; i++)
+	{
+		if (!sbtreeReadStoredPage(state, state->buffer->storage, i, buf))
+			continue;
+		memcpy(&sb, buf + state->headerSize, sizeof(sbtreeSuperblock));
+		if (sb.magic != SBTREE_SUPERBLOCK_MAGIC || sb.checksum != sbtreeSuperblockChecksum(&sb)
+			|| sb.keySize != state->keySize || sb.dataSize != state->dataSize || sb.levels == 0 || sb.levels > MAX_LEVEL)
+			continue;
+		if (!found || sb.sequence > last.sequence)
+			last = sb;
+		found = 1;
+	}
+	if (!found)
+		return -1;
+
+	state->levels = last.levels;
+	state->numNodes = last.numNodes;
+	memcpy(state->activePath, last.activePath, sizeof(id_t)*MAX_LEVEL);
+	cp->sequence = last.sequence;
+	cp->numCheckpoints = 0;
+	cp->numRelinked = 0;
+
+	/* New pages are written after all existing pages */
+	end = sbtreeFindEnd(state, state->buffer->storage, last.nextPageId, buf);
+	state->buffer->nextPageId = end;
+	state->buffer->nextPageWriteId = end;
+	state->writeBuffer = buf;
+
+	/* Separator for a leaf is the first key of the next leaf. Last leaf uses its largest key + 1 as in flush. */
+	/* Keys are copied before updating index as buffer is reused for new interior nodes. */
+	for (pageId = last.nextPageId; pageId < end; pageId++)
+	{
+		if (!sbtreeReadStoredPage(state, state->buffer->storage, pageId, buf))
+			return -1;
+		if (SBTREE_IS_INTERIOR(buf) || SBTREE_GET_COUNT(buf) == 0)
+			continue;
+		if (state->valueLog != NULL && !sbtreeLeafValuesInLog(state, buf))
+			break;
+
+		memcpy(nextKey, buf + state->headerSize, state->keySize);
+		if (cp->numRelinked > 0)
+			sbtreeSeparatorKey(state, maxKey, nextKey, sep);
+		memcpy(maxKey, sbtreeGetMaxKey(state, buf), state->keySize);
+		sbtreeLeafSummary(state, buf, &summary);
+
+		if (cp->numRelinked > 0 && sbtreeUpdateIndex(state, minKey, sep, prevPageId, &prevSummary) != 0)
+			return -1;
+		memcpy(minKey, nextKey, state->keySize);
+		prevPageId = pageId;
+		prevSummary = summary;
+		cp->numRelinked++;
+		state->numNodes++;
+	}
+
+	if (cp->numRelinked == 0)
+	{
+		initBufferPage(state->buffer, 0);
+		cp->lastPageId = end;
+		cp->lastTime = cp->getTime != NULL ? cp->getTime() : 0;
+		return 0;
+	}
+	sbtreeNextKey(state, maxKey, nextKey);
+	sbtreeSeparatorKey(state, maxKey, nextKey, sep);
+	if (sbtreeUpdateIndex(state, minKey, sep, prevPageId, &prevSummary) != 0)
+		return -1;
+	initBufferPage(state->buffer, 0);
+	return sbtreeCheckpointWrite(state);
+}
+
+/**
+@brief     	Puts a given key, data pair into structure.
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key for record
+@param     	data
+                Data for record
+@return		Return 0 if success. Non-zero value if error.
+*/
+int8_t sbtreePut(sbtreeState *state, void* key, void *data)
+{		
+	int16_t count =  SBTREE_GET_COUNT(state->writeBuffer); 
+	int64_t sep[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+	void	*sepKey = key;
+	sbtreeSummary summary;
 
-	for (l=state->levels-1; l >= 0; l--)
+	/* Write current page if full */
+	if (count >= state->maxRecordsPerPage || ((state->parameters & SBTREE_DELTA_KEYS) && !sbtreeDeltaLeafFits(state, state->writeBuffer, count, key)))
+	{	
+		/* Write page first so can use buffer for updating tree structure */
+		int32_t pageNum = writePage(state->buffer, state->writeBuffer);				
+
+		/* Add pointer to page to B-tree structure */
+		/* Second pointer parameter is minimum key in currently full leaf node of data */
+		/* Need to copy key from current write buffer as will reuse buffer */
+		memcpy(state->tempKey, (void*) (state->writeBuffer+state->headerSize), state->keySize); 
+		if (state->spline != NULL)
+			splineAdd(state->spline, sbtreeIntKey(state, state->tempKey), pageNum);
+		/* Separator is shortest key after largest key in full leaf */
+		if (state->parameters & SBTREE_PREFIX_KEYS)
+		{
+			sbtreeSeparatorKey(state, sbtreeGetMaxKey(state, state->writeBuffer), key, sep);
+			sepKey = sep;
+		}
+		sbtreeLeafSummary(state, state->writeBuffer, &summary);
+		sbtreeLeafFilterSet(state, state->writeBuffer, pageNum);
+		if (sbtreeUpdateIndex(state, state->tempKey, sepKey, pageNum, &summary))
+			return -1;
+
+		count = 0;			
+		initBufferPage(state->buffer, 0);	
+		state->numNodes++; 				
+
+		if (state->checkpoint != NULL && sbtreeCheckpointDue(state) && sbtreeCheckpointWrite(state) != 0)
+			return -1;
+	}
+
+	/* Copy record onto page */
+	if (state->parameters & SBTREE_DELTA_KEYS)
+		sbtreeDeltaLeafAdd(state, state->writeBuffer, count, key, data);
+	else
 	{
-		/* Forcing all reads to buffer 0 guarantees no read conflicts but results in more I/Os */
-		// buf = readPageBuffer(state->buffer, state->activePath[l], 0);
-		buf = readPage(state->buffer, state->activePath[l]);	
-		if (buf == NULL)
-			return -1;		
-		
-		/* Determine if there is space in the page */		
-		count =  SBTREE_GET_COUNT(buf); 
-					
-		if ( (count > state->maxInteriorRecordsPerPage) || (l < state->levels-1 && count >= state->maxInteriorRecordsPerPage))
-		{	/* Interior node at this level is full. Create a new node. */	
+		memcpy(state->writeBuffer + state->recordSize * count + state->headerSize, key, state->keySize);
+		memcpy(state->writeBuffer + state->recordSize * count + state->headerSize + state->keySize, data, state->dataSize);
+	}
+	sbtreeLeafBitmapAdd(state, state->writeBuffer, data);
 
-			/* If tree is beyond level 1, update parent node last child pointer as will have changed. Currently in buffer. */
-			if (l < state->levels - 1)
-			{								
-				memcpy(buf + state->keySize * state->maxInteriorRecordsPerPage + sizeof(id_t) * (count) + state->headerSize, &prevPageNum, sizeof(id_t));											
-				state->activePath[l]  = writePage(state->buffer, buf);				
-			}
-			else
-			{	/* If using deferred update, must write out full node */
-			 	state->activePath[l]  = writePage(state->buffer, buf);
-			}
+	/* Update count */
+	SBTREE_INC_COUNT(state->writeBuffer);	
 
-			state->numNodes++;
-			initBufferPage(state->buffer, 0);
-			SBTREE_SET_INTERIOR(state->writeBuffer);
-			buf = state->writeBuffer;
+	return 0;
+}
 
-			/* Store pointer to new leaf node */
-			/* For first interior node level above leaf the separator is the currently inserted key. For other levels no key inserted just pointer. */
-			if (l == state->levels-1)
-			{	memcpy(buf + state->headerSize, key, state->keySize);
-				SBTREE_INC_COUNT(buf);	
-			}			
-			
-			/* Insert child pointer into new node */
-			memcpy(buf + state->keySize * state->maxInteriorRecordsPerPage + state->headerSize, &pageNum, sizeof(id_t));
+/**
+@brief     	Writes batch of leaves built by bulk load and adds them to index. Separator of a leaf is computed
+			from first key of next leaf (nextKey for last leaf) as in put.
+@param     	state
+                SBTree algorithm state structure
+@param     	reader
+                Reader with leaves in pages
+@param     	count
+                Number of leaves
+@param     	nextKey
+                First key after last leaf
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeBulkWrite(sbtreeState *state, sbtreeReader *reader, id_t count, void *nextKey)
+{
+	int64_t sep[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+	void	*leaf, *next, *sepKey;
+	sbtreeSummary summary;
+	int32_t	pageNum;
+	id_t	i;
+
+	pageNum = dbbufferWritePages(state->buffer, reader->pages, count);
+	if (pageNum < 0)
+		return -1;
 
-			/* Write page. Update active page mapping. */
-			prevPageNum = state->activePath[l];			
-			state->activePath[l] = writePage(state->buffer, buf);												
-			pageNum = state->activePath[l];						
+	for (i=0; i < count; i++)
+	{
+		leaf = reader->pages + (size_t) i*state->buffer->pageSize;
+		next = i+1 < count ? leaf + state->buffer->pageSize + state->headerSize : nextKey;
+		memcpy(state->tempKey, leaf + state->headerSize, state->keySize);
+		if (state->spline != NULL)
+			splineAdd(state->spline, sbtreeIntKey(state, state->tempKey), pageNum+i);
+		sepKey = next;
+		if (state->parameters & SBTREE_PREFIX_KEYS)
+		{
+			sbtreeSeparatorKey(state, sbtreeGetMaxKey(state, leaf), next, sep);
+			sepKey = sep;
 		}
-		else 
+		sbtreeLeafSummary(state, leaf, &summary);
+		sbtreeLeafFilterSet(state, leaf, pageNum+i);
+		if (sbtreeUpdateIndex(state, state->tempKey, sepKey, pageNum+i, &summary) != 0)
+			return -1;
+		state->numNodes++;
+	}
+	initBufferPage(state->buffer, 0);
+
+	if (state->checkpoint != NULL && sbtreeCheckpointDue(state) && sbtreeCheckpointWrite(state) != 0)
+		return -1;
+	return 0;
+}
+
+/**
+@brief     	Puts all records of reader into structure. Leaves are filled directly from blocks of reader.
+@param     	state
+                SBTree algorithm state structure
+@param     	reader
+                Reader providing blocks of records
+@return		Return 0 if success. Non-zero value if error.
+*/
+int8_t sbtreeBulkLoad(sbtreeState *state, sbtreeReader *reader)
+{
+	count_t	pageSize = state->buffer->pageSize;
+	void	*leaf = reader->pages, *records, *rec;
+	int32_t	n, i, j, copy;
+	int16_t	count;
+	id_t	cur = 0;
+
+	if (reader->numPages == 0)
+		return -1;
+
+	/* Records in output buffer start first leaf */
+	memcpy(leaf, state->writeBuffer, pageSize);
+	count = SBTREE_GET_COUNT(leaf);
+
+	while ((n = reader->read(reader, &records)) > 0)
+	{
+		for (i=0; i < n; i += copy)
 		{
-			/* Copy record onto page */
-			/* Record is key just trying to insert (as above values already in block) and pageNum just written with previous data page */
-			/* Keep keys and data as contiguous sorted arrays */
-			if (count < state->maxInteriorRecordsPerPage)
-			{	/* Do not store key for last child pointer */ 
-				if (l == state->levels-1)
-					memcpy(buf + state->keySize * count + state->headerSize, key, state->keySize);
-				else
-					memcpy(buf + state->keySize * count + state->headerSize, minkey, state->keySize);				
+			rec = records + (size_t) i*state->recordSize;
+			if (count >= state->maxRecordsPerPage || ((state->parameters & SBTREE_DELTA_KEYS) && !sbtreeDeltaLeafFits(state, leaf, count, rec)))
+			{	/* Leaf is full. Batch is written once its last leaf is full as separator needs next key. */
+				if (++cur == reader->numPages)
+				{
+					if (sbtreeBulkWrite(state, reader, cur, rec) != 0)
+						return -1;
+					cur = 0;
+				}
+				leaf = reader->pages + (size_t) cur*pageSize;
+				memset(leaf, 0, pageSize);
+				count = 0;
 			}
-		
-			if (l == 0 && state->levels > 1)
-			{	/* Root is special case */
-				memcpy(buf + state->keySize * state->maxInteriorRecordsPerPage + sizeof(id_t) * (count+1) + state->headerSize, &pageNum, sizeof(id_t));		
-				
-				/* Update previous pointer as may have changed due to writes. */
-				if (count > 0 && prevPageNum != -1)
-					memcpy(buf + state->keySize * state->maxInteriorRecordsPerPage + sizeof(id_t) * (count) + state->headerSize, &prevPageNum, sizeof(id_t));	
+
+			/* Input records have leaf record layout so runs of records are copied at once */
+			if (state->parameters & SBTREE_DELTA_KEYS)
+			{
+				sbtreeDeltaLeafAdd(state, leaf, count, rec, rec + state->keySize);
+				copy = 1;
 			}
 			else
 			{
-				/* Update previous pointer as may have changed due to writes. */
-				if (prevPageNum != -1)
-				{										
-					memcpy(buf + state->keySize * state->maxInteriorRecordsPerPage + sizeof(id_t) * (count) + state->headerSize, &prevPageNum, sizeof(id_t));	
-					count++;					
-				}
-			
-				/* Add new child pointer to page */
-				memcpy(buf + state->keySize * state->maxInteriorRecordsPerPage + sizeof(id_t) * (count) + state->headerSize, &pageNum, sizeof(id_t));						
-			}						
-				
-			/* Update count */
-			SBTREE_INC_COUNT(buf);	
+				copy = state->maxRecordsPerPage - count;
+				if (copy > n - i)
+					copy = n - i;
+				memcpy(leaf + state->headerSize + (size_t) count*state->recordSize, rec, (size_t) copy*state->recordSize);
+			}
+			if (state->bitmap != NULL)
+			{
+				for (j=0; j < copy; j++)
+					sbtreeLeafBitmapAdd(state, leaf, rec + (size_t) j*state->recordSize + state->keySize);
+			}
+			count += copy;
+			SBTREE_SET_COUNT(leaf, count);
+		}
+	}
+	if (n < 0)
+		return -1;
 
-			/* Write updated interior page */								
-			/* Update location of page */
-			// state->activePath[l] = writePage(state->buffer, buf);
+	/* Last leaf is not written so puts can continue. It is written by flush like leaves of put. */
+	if (cur > 0 && sbtreeBulkWrite(state, reader, cur, leaf + state->headerSize) != 0)
+		return -1;
+	memcpy(initBufferPage(state->buffer, 0), leaf, pageSize);
+	return 0;
+}
 
-			/* Deferring write and keeping updated page in buffer. */
-			/* Note: Requires writing page and updating active path if buffer is used for reading. */							
-			dbbufferSetModified(state->buffer, buf, l);					
-			break;
-		}		
-	}		 
-	
-	/* Handle the case where root is currently full */
-	/* Grow one level, shift everything down, and create new root */
-	if (l == -1)
-	{			
-		initBufferPage(state->buffer, 0);
+/**
+@brief     	Appends value to value log.
+@param     	state
+                SBTree algorithm state structure
+@param     	value
+                Value
+@param     	length
+                Length of value in bytes
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeValueLogAppend(sbtreeState *state, void *value, uint16_t length)
+{
+	sbtreeValueLog *log = state->valueLog;
+	uint32_t capacity = SBTREE_VALUE_LOG_CAPACITY(state), pos, n;
 
-		/* Copy record onto page (minkey, prevPageNum) */
-		memcpy(state->writeBuffer + state->headerSize, minkey, state->keySize);		
-		memcpy(state->writeBuffer + state->headerSize + state->keySize * state->maxInteriorRecordsPerPage, &prevPageNum, sizeof(id_t));
-		
-		/* Copy greater than record on to page. Note: Basically child pointer and infinity for key */		
-		memcpy(state->writeBuffer + state->keySize * state->maxInteriorRecordsPerPage + state->headerSize + sizeof(id_t), &state->activePath[0], sizeof(id_t));		
+	while (length > 0)
+	{
+		pos = log->end % capacity;
+		n = capacity - pos < length ? capacity - pos : length;
+		memcpy(log->buffer + state->headerSize + pos, value, n);
+		log->end += n;
+		value += n;
+		length -= n;
+		if (log->end % capacity == 0)
+		{	/* Page is full */
+			if (sbtreeValueLogWrite(state, log->end / capacity - 1, capacity) != 0)
+				return -1;
+			memset(log->buffer, 0, state->buffer->pageSize);
+		}
+	}
+	return 0;
+}
 
-		/* Update count */
-		SBTREE_INC_COUNT(state->writeBuffer);	
-		SBTREE_SET_ROOT(state->writeBuffer);
-		
-		for (l=state->levels; l > 0; l--)
-			state->activePath[l] = state->activePath[l-1]; 
-		state->activePath[0] = writePage(state->buffer, state->writeBuffer);	/* Store root location */			
-		state->levels++;
-		state->numNodes++;		
+/**
+@brief     	Returns value log page. Page being appended is in memory. Other pages are read into the read page.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageId
+                Log page id
+@return		Return pointer to page or NULL if error.
+*/
+static void* sbtreeValueLogPage(sbtreeState *state, id_t pageId)
+{
+	sbtreeValueLog *log = state->valueLog;
+	void	*buf = log->buffer + state->buffer->pageSize;
+
+	if (pageId == log->end / SBTREE_VALUE_LOG_CAPACITY(state))
+		return log->buffer;
+	if (pageId != log->readPageId)
+	{
+		log->numReads++;
+		log->readPageId = -1;
+		if (log->storage->readPage(log->storage, pageId, state->buffer->pageSize, buf) != 0
+			|| SBTREE_GET_ID(buf) != pageId || dbbufferVerifyChecksum(state->buffer, buf) != 0)
+			return NULL;
+		log->readPageId = pageId;
+	}
+	return buf;
+}
+
+/**
+@brief     	Puts a key and variable-length value into structure. Value is stored in record data if it fits
+			after its length and is appended to value log otherwise. Use sbtreeValueLength() and sbtreeReadValue()
+			on data returned by sbtreeGet() or sbtreeNext() to read value. Do not mix with sbtreePut() in one tree.
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key for record
+@param     	value
+                Value for record
+@param     	length
+                Length of value in bytes
+@return		Return 0 if success. Non-zero value if error (value does not fit in data and no value log).
+*/
+int8_t sbtreePutVar(sbtreeState *state, void* key, void *value, uint16_t length)
+{
+	uint8_t data[UINT8_MAX];
+
+	memset(data, 0, state->dataSize);
+	memcpy(data, &length, SBTREE_VALUE_LENGTH_SIZE);
+	if (length <= state->dataSize - SBTREE_VALUE_LENGTH_SIZE)
+		memcpy(data + SBTREE_VALUE_LENGTH_SIZE, value, length);
+	else
+	{	/* Value is appended before record is added as adding record may write a checkpoint that flushes the log */
+		if (state->valueLog == NULL || state->dataSize < SBTREE_VALUE_REF_SIZE)
+			return -1;
+		memcpy(data + SBTREE_VALUE_LENGTH_SIZE, &state->valueLog->end, sizeof(uint32_t));
+		if (sbtreeValueLogAppend(state, value, length) != 0)
+			return -1;
+	}
+	return sbtreePut(state, key, data);
+}
+
+/**
+@brief     	Returns length of variable-length value in record data.
+@param     	state
+                SBTree algorithm state structure
+@param     	data
+                Record data written by sbtreePutVar()
+*/
+uint16_t sbtreeValueLength(sbtreeState *state, void *data)
+{
+	uint16_t length;
+
+	memcpy(&length, data, SBTREE_VALUE_LENGTH_SIZE);
+	return length;
+}
+
+/**
+@brief     	Copies variable-length value of record data. Values in value log are read only when requested.
+@param     	state
+                SBTree algorithm state structure
+@param     	data
+                Record data written by sbtreePutVar()
+@param     	value
+                Pre-allocated memory for sbtreeValueLength() bytes
+@return		Return 0 if success. Non-zero value if error (value is not in log, e.g. log not flushed before crash).
+*/
+int8_t sbtreeReadValue(sbtreeState *state, void *data, void *value)
+{
+	uint16_t length = sbtreeValueLength(state, data);
+	uint32_t capacity, offset, n;
+	void	*page;
+
+	if (length <= state->dataSize - SBTREE_VALUE_LENGTH_SIZE)
+	{
+		memcpy(value, data + SBTREE_VALUE_LENGTH_SIZE, length);
+		return 0;
+	}
+	if (state->valueLog == NULL)
+		return -1;
+	memcpy(&offset, data + SBTREE_VALUE_LENGTH_SIZE, sizeof(uint32_t));
+	if ((uint64_t) offset + length > state->valueLog->end)
+		return -1;
+
+	capacity = SBTREE_VALUE_LOG_CAPACITY(state);
+	while (length > 0)
+	{
+		page = sbtreeValueLogPage(state, offset / capacity);
+		if (page == NULL)
+			return -1;
+		n = capacity - offset % capacity < length ? capacity - offset % capacity : length;
+		memcpy(value, page + state->headerSize + offset % capacity, n);
+		offset += n;
+		value += n;
+		length -= n;
+	}
+	return 0;
+}
+
+/* Interpolation search stops when this many keys remain. Remaining keys are scanned sequentially. */
+#define SBTREE_INTERPOLATION_WINDOW	4
+
+/**
+@brief     	Returns integer key value ordered as compareKey for interpolation. 4 byte keys are ordered by sign of their
+			wrapped difference, so they are returned as signed offset from base key (keys in node are within 2^31 of it).
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key
+@param     	base
+                First key of node
+*/
+static int64_t sbtreeKeyOffset(sbtreeState *state, void *key, void *base)
+{
+	if (state->keySize == sizeof(int64_t))
+		return *((int64_t*) key);
+	return (int32_t) (*((uint32_t*) key) - *((uint32_t*) base));
+}
+
+/**
+@brief     	Interpolation-sequential search for integer keys. Estimates position of search key assuming keys
+			are uniform between the known lower and upper keys and narrows the range until only a few keys remain,
+			which are scanned sequentially. If an estimate does not at least halve the range (skewed keys),
+			the next step uses the midpoint as in binary search.
+@param     	state
+                SBTree algorithm state structure
+@param     	keys
+                Pointer to first key
+@param     	stride
+                Bytes between keys
+@param     	count
+                Number of keys
+@param     	key
+                Search key
+@param     	orEqual
+                1 to count keys <= search key, 0 to count keys < search key
+@return		Number of keys less than (or equal to) search key
+*/
+static int16_t sbtreeInterpolationSearch(sbtreeState *state, void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual)
+{
+	int64_t k, low, high, v;
+	int16_t first, last, pos, size;
+	int8_t	bisect = 0;
+
+	if (count == 0)
+		return 0;
+
+	k = sbtreeKeyOffset(state, key, keys);
+	low = sbtreeKeyOffset(state, keys, keys);
+	state->numProbes++;
+	if (!(low < k || (orEqual && low == k)))
+		return 0;
+	high = sbtreeKeyOffset(state, keys + (count-1)*stride, keys);
+	state->numProbes++;
+	if (high < k || (orEqual && high == k))
+		return count;
+
+	/* Answer is in [first, last]. Key at first-1 (low) satisfies comparison, key at last (high) does not. */
+	first = 1;
+	last = count-1;
+	while (last - first > SBTREE_INTERPOLATION_WINDOW)
+	{
+		size = last - first;
+		if (bisect)
+			pos = (first + last) / 2;
+		else
+		{
+			pos = first - 1 + (int16_t) ((double) (k - low) / (double) (high - low) * (last - first + 1));
+			if (pos < first)
+				pos = first;
+			if (pos > last-1)
+				pos = last-1;
+		}
+
+		v = sbtreeKeyOffset(state, keys + pos*stride, keys);
+		state->numProbes++;
+		if (v < k || (orEqual && v == k))
+		{
+			first = pos + 1;
+			low = v;
+		}
+		else
+		{
+			last = pos;
+			high = v;
+		}
+		bisect = !bisect && (last - first) > size / 2;
 	}
-	return 0;
+
+	for ( ; first < last; first++)
+	{
+		v = sbtreeKeyOffset(state, keys + first*stride, keys);
+		state->numProbes++;
+		if (!(v < k || (orEqual && v == k)))
+			break;
+	}
+	return first;
 }
 
 /**
-@brief     	Puts a given key, data pair into structure.
+@brief     	Counts keys less than (or equal to) search key using interpolation search or integer key search.
 @param     	state
                 SBTree algorithm state structure
+@param     	keys
+                Pointer to first key
+@param     	stride
+                Bytes between keys
+@param     	count
+                Number of keys
 @param     	key
-                Key for record
-@param     	data
-                Data for record
-@return		Return 0 if success. Non-zero value if error.
+                Search key
+@param     	orEqual
+                1 to count keys <= search key, 0 to count keys < search key
 */
-int8_t sbtreePut(sbtreeState *state, void* key, void *data)
-{		
-	int16_t count =  SBTREE_GET_COUNT(state->writeBuffer); 
-
-	/* Write current page if full */
-	if (count >= state->maxRecordsPerPage)
-	{	
-		/* Write page first so can use buffer for updating tree structure */
-		int32_t pageNum = writePage(state->buffer, state->writeBuffer);				
-
-		/* Add pointer to page to B-tree structure */
-		/* Second pointer parameter is minimum key in currently full leaf node of data */
-		/* Need to copy key from current write buffer as will reuse buffer */
-		memcpy(state->tempKey, (void*) (state->writeBuffer+state->headerSize), state->keySize); 
-		if (sbtreeUpdateIndex(state, state->tempKey, key, pageNum))
-			return -1;
-
-		count = 0;			
-		initBufferPage(state->buffer, 0);	
-		state->numNodes++; 				
-	}
-
-	/* Copy record onto page */
-	memcpy(state->writeBuffer + state->recordSize * count + state->headerSize, key, state->keySize);
-	memcpy(state->writeBuffer + state->recordSize * count + state->headerSize + state->keySize, data, state->dataSize);
-
-	/* Update count */
-	SBTREE_INC_COUNT(state->writeBuffer);	
-
-	return 0;
+static int16_t sbtreeCountKeys(sbtreeState *state, void *keys, uint8_t stride, int16_t count, void *key, int8_t orEqual)
+{
+	if (state->parameters & SBTREE_USE_INTERPOLATION)
+		return sbtreeInterpolationSearch(state, keys, stride, count, key, orEqual);
+	return state->searchKeys(keys, stride, count, key, orEqual);
 }
 
 /**
@@ -447,6 +2394,29 @@ id_t sbtreeSearchNode(sbtreeState *state, void *buffer, void* key, id_t pageId,
 	count = SBTREE_GET_COUNT(buffer);  
 	interior = SBTREE_IS_INTERIOR(buffer);
 
+	if (!interior && (state->parameters & SBTREE_DELTA_KEYS))
+		return sbtreeSearchDeltaLeaf(state, buffer, key, range);
+	if (interior && (state->parameters & SBTREE_PREFIX_KEYS))
+		return sbtreeSearchPrefixNode(state, buffer, key);
+
+	if (state->searchKeys != NULL || (state->parameters & SBTREE_USE_INTERPOLATION))
+	{
+		if (interior)
+		{	/* Child to follow is number of keys <= search key */
+			if (count > state->maxInteriorRecordsPerPage)
+				count = state->maxInteriorRecordsPerPage;
+			return sbtreeCountKeys(state, buffer+state->headerSize, state->keySize, count, key, 1);
+		}
+
+		/* Leaf: first record >= search key */
+		first = sbtreeCountKeys(state, buffer+state->headerSize, state->recordSize, count, key, 0);
+		if (first < count && state->compareKey(buffer+state->headerSize+state->recordSize*first, key) == 0)
+			return first;
+		if (range)
+			return first > 0 ? first-1 : 0;
+		return -1;
+	}
+
 	if (interior)
 	{
 		if (count == 0)	/* Only one child pointer */
@@ -454,6 +2424,7 @@ id_t sbtreeSearchNode(sbtreeState *state, void *buffer, void* key, id_t pageId,
 		if (count == 1)	/* One key and two children pointers */
 		{
 			mkey = buffer+state->headerSize;   /* Key at index 0 */
+			state->numProbes++;
 			compare = state->compareKey(key, mkey);
 			if (compare < 0)
 				return 0;
@@ -468,6 +2439,7 @@ id_t sbtreeSearchNode(sbtreeState *state, void *buffer, void* key, id_t pageId,
 		while (first < last) 
 		{			
 			mkey = buffer+state->headerSize+state->keySize*middle;
+			state->numProbes++;
 			compare = state->compareKey(key,mkey);
 			if (compare > 0)
 				first = middle + 1;
@@ -491,6 +2463,7 @@ id_t sbtreeSearchNode(sbtreeState *state, void *buffer, void* key, id_t pageId,
 		while (first <= last) 
 		{			
 			mkey = buffer+state->headerSize+state->recordSize*middle;
+			state->numProbes++;
 			compare = state->compareKey(mkey, key);
 			if (compare < 0)
 				first = middle + 1;
@@ -531,16 +2504,128 @@ id_t getChildPageId(sbtreeState *state, void *buf, id_t pageId, int8_t level, id
 	}
 	
 	/* Retrieve page number for child */
-	id_t nextId = *((id_t*) (buf + state->headerSize + state->keySize*state->maxInteriorRecordsPerPage + sizeof(id_t)*childNum));
+	id_t nextId = *((id_t*) sbtreeChildPtr(state, buf, childNum));
 	if (nextId == 0 && childNum==(SBTREE_GET_COUNT(buf)))	/* Last child which is empty */
 		return -1;
 	return nextId;
 }
 
+/* Number of leaf pages read ahead by iterator and batch get if storage supports prefetch */
+#define SBTREE_PREFETCH_PAGES	4
+
+/**
+@brief     	Starts asynchronous read of leaf pages that are children of a node above leaf level.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node at level levels-1
+@param     	pageId
+                Page id for node
+@param		first
+				First child index to prefetch
+@param		last
+				Last child index to prefetch
+*/
+static void sbtreePrefetchLeaves(sbtreeState *state, void *buf, id_t pageId, id_t first, id_t last)
+{
+	id_t	childId;
+	count_t	count = SBTREE_GET_COUNT(buf);
+
+	if (state->buffer->storage->prefetchPage == NULL || count == 0)
+		return;
+
+	/* Above leaf level, child index count only exists if node is full */
+	if (last >= count)
+		last = count-1;
+	for ( ; first <= last; first++)
+	{
+		childId = getChildPageId(state, buf, pageId, state->levels-1, first);
+		if (childId != -1)
+			dbbufferPrefetch(state->buffer, childId);
+	}
+}
+
+/* Interior pages are written between leaf pages. Spline search extends this many pages past the spline error. */
+#define SBTREE_SPLINE_SLACK		2
+
+/**
+@brief     	Finds key using leaf page predicted by spline. Pages within error of the prediction
+			are searched. Interior pages are skipped and leaf pages are in key order.
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key for record
+@param     	data
+                Pre-allocated memory to copy data for record
+@return		Return 0 if found, -1 if not found or error, 1 if leaf was not found within error.
+*/
+static int8_t sbtreeSplineGet(sbtreeState *state, void* key, void *data)
+{
+	uint32_t predicted;
+	id_t	pageId, low, high, below, above, nextId;
+	int8_t	dir = 1, leafBelow = 0, leafAbove = 0;
+	void	*buf;
+
+	if (state->buffer->nextPageWriteId == 0 || splinePredict(state->spline, sbtreeIntKey(state, key), &predicted) != 0)
+		return 1;
+
+	low = predicted > state->spline->maxError + SBTREE_SPLINE_SLACK ? predicted - state->spline->maxError - SBTREE_SPLINE_SLACK : 0;
+	high = predicted + state->spline->maxError + SBTREE_SPLINE_SLACK;
+	if (high >= state->buffer->nextPageWriteId)
+		high = state->buffer->nextPageWriteId - 1;
+	pageId = predicted > high ? high : predicted;
+	below = above = pageId;
+
+	/* Pages in [below, above] have been read. Search continues from the edge of that range in direction of key. */
+	while (pageId >= low && pageId <= high)
+	{
+		buf = sbtreeReadOnlyPage(state, pageId);
+		if (buf == NULL)
+			return -1;
+		if (pageId < below)
+			below = pageId;
+		if (pageId > above)
+			above = pageId;
+
+		if (!SBTREE_IS_INTERIOR(buf) && SBTREE_GET_COUNT(buf) > 0)
+		{
+			if (state->compareKey(key, sbtreeGetMinKey(state, buf)) < 0)
+			{	/* Key is in an earlier leaf */
+				if (pageId == 0)
+					return -1;
+				high = pageId - 1;
+				dir = -1;
+				leafAbove = 1;
+			}
+			else if (state->compareKey(key, sbtreeGetMaxKey(state, buf)) > 0)
+			{	/* Key is in a later leaf */
+				low = pageId + 1;
+				dir = 1;
+				leafBelow = 1;
+			}
+			else
+			{
+				nextId = sbtreeSearchNode(state, buf, key, pageId, 0);
+				if (nextId == -1)
+					return -1;
+				memcpy(data, sbtreeLeafData(state, buf, nextId), state->dataSize);
+				return 0;
+			}
+		}
+		pageId = dir < 0 ? below - 1 : above + 1;
+	}
+
+	/* All pages between two adjacent leaves were read. Key is not in tree. */
+	if (leafBelow && leafAbove)
+		return -1;
+	return 1;
+}
+
 /**
 @brief     	Given a key, returns data associated with key.
 			Note: Space for data must be already allocated.
 			Data is copied from database into data buffer.
+			With leaf Bloom filters, leaf is not read if key is not in its filter (not used for leaf predicted by spline).
 @param     	state
                 SBTree algorithm state structure
 @param     	key
@@ -553,12 +2638,23 @@ int8_t sbtreeGet(sbtreeState *state, void* key, void *data)
 {
 	/* Starting at root search for key */
 	int8_t 	l;
-	void	*buf;
-	id_t 	childNum, nextId = state->activePath[0];
+	void	*buf, *filter;
+	id_t 	childNum, leafId, nextId = state->activePath[0];
+
+	/* Use leaf page predicted by spline. Traverse tree if leaf is not within error. */
+	if (state->spline != NULL)
+	{
+		l = sbtreeSplineGet(state, key, data);
+		if (l != 1)
+			return l;
+	}
 	
 	for (l=0; l < state->levels; l++)
 	{		
 		buf = readPage(state->buffer, nextId);		
+		if (buf == NULL)
+			return -1;
+		dbbufferPin(state->buffer, buf, l);
 
 		/* Find the key within the node. Sorted by key. Use binary search. */
 		childNum = sbtreeSearchNode(state, buf, key, nextId, 0);
@@ -567,15 +2663,467 @@ int8_t sbtreeGet(sbtreeState *state, void* key, void *data)
 			return -1;		
 	}
 
-	/* Search the leaf node and return search result */
-	buf = readPage(state->buffer, nextId);
-	nextId = sbtreeSearchNode(state, buf, key, nextId, 0);
-	if (nextId != -1)
-	{	/* Key found */
-		memcpy(data, (void*) (buf+state->headerSize+state->recordSize*nextId+state->keySize), state->dataSize);
-		return 0;
-	}
-	return -1;
+	/* Key is not in leaf if it is not in leaf filter */
+	filter = sbtreeLeafFilter(state, nextId);
+	if (filter != NULL && !sbtreeFilterContains(state, filter, key))
+	{
+		state->bloomFilter->numSkipped++;
+		return -1;
+	}
+
+	/* Search the leaf node and return search result */
+	buf = sbtreeReadOnlyPage(state, nextId);
+	if (buf == NULL)
+		return -1;
+	leafId = nextId;
+	nextId = sbtreeSearchNode(state, buf, key, nextId, 0);
+	if (nextId != -1)
+	{	/* Key found */
+		memcpy(data, sbtreeLeafData(state, buf, nextId), state->dataSize);
+		return 0;
+	}
+	/* False positive or filter unknown after open */
+	if (filter != NULL)
+	{
+		state->bloomFilter->numFalsePositives++;
+		sbtreeLeafFilterSet(state, buf, leafId);
+	}
+	return -1;
+}
+
+/**
+@brief     	Swaps two keys.
+@param     	a
+                First key
+@param     	b
+                Second key
+@param     	size
+                Key size in bytes
+*/
+static void sbtreeSwapKeys(int8_t *a, int8_t *b, uint8_t size)
+{
+	int8_t tmp;
+	int64_t tmp64;
+
+	if (size == sizeof(int32_t) || size == sizeof(int64_t))
+	{	/* Integer keys */
+		memcpy(&tmp64, a, size);
+		memcpy(a, b, size);
+		memcpy(b, &tmp64, size);
+		return;
+	}
+	for (uint8_t i=0; i < size; i++)
+	{
+		tmp = a[i];
+		a[i] = b[i];
+		b[i] = tmp;
+	}
+}
+
+/* Ranges of at most this many keys are sorted using insertion sort */
+#define SBTREE_SORT_INSERTION	16
+
+/**
+@brief     	Sorts keys in place (quicksort) so no memory is allocated. Recursion is on the smaller
+			partition so stack depth is at most log2(n).
+@param     	state
+                SBTree algorithm state structure
+@param     	keys
+                Array of keys
+@param     	n
+                Number of keys
+*/
+static void sbtreeQuickSortKeys(sbtreeState *state, int8_t *keys, uint32_t n)
+{
+	uint32_t i, j;
+	uint8_t size = state->keySize;
+
+	while (n > SBTREE_SORT_INSERTION)
+	{	/* Median of first, middle and last key is pivot. Pivot is moved to first position. */
+		int8_t *mid = keys + (n/2)*size, *last = keys + (n-1)*size;
+		if (state->compareKey(mid, keys) < 0)
+			sbtreeSwapKeys(mid, keys, size);
+		if (state->compareKey(last, mid) < 0)
+		{
+			sbtreeSwapKeys(last, mid, size);
+			if (state->compareKey(mid, keys) < 0)
+				sbtreeSwapKeys(mid, keys, size);
+		}
+		sbtreeSwapKeys(keys, mid, size);
+
+		/* Partition. Keys before i are <= pivot and keys after j are >= pivot. */
+		i = 0;
+		j = n;
+		while (1)
+		{
+			do i++; while (i < n && state->compareKey(keys + i*size, keys) < 0);
+			do j--; while (state->compareKey(keys + j*size, keys) > 0);
+			if (i >= j)
+				break;
+			sbtreeSwapKeys(keys + i*size, keys + j*size, size);
+		}
+		sbtreeSwapKeys(keys, keys + j*size, size);
+
+		if (j < n-j-1)
+		{
+			sbtreeQuickSortKeys(state, keys, j);
+			keys += (j+1)*size;
+			n -= j+1;
+		}
+		else
+		{
+			sbtreeQuickSortKeys(state, keys + (j+1)*size, n-j-1);
+			n = j;
+		}
+	}
+
+	for (i=1; i < n; i++)
+		for (j=i; j > 0 && state->compareKey(keys + (j-1)*size, keys + j*size) > 0; j--)
+			sbtreeSwapKeys(keys + (j-1)*size, keys + j*size, size);
+}
+
+/**
+@brief     	Sorts keys in place. Keys already in order are not moved.
+@param     	state
+                SBTree algorithm state structure
+@param     	keys
+                Array of keys
+@param     	n
+                Number of keys
+*/
+static void sbtreeSortKeys(sbtreeState *state, int8_t *keys, uint32_t n)
+{
+	uint32_t i;
+
+	for (i=1; i < n; i++)
+		if (state->compareKey(keys + (i-1)*state->keySize, keys + i*state->keySize) > 0)
+			break;
+	if (i < n)
+		sbtreeQuickSortKeys(state, keys, n);
+}
+
+/**
+@brief     	Starts asynchronous read of the next leaf pages that keys after the current key route to.
+			Leaves that no key routes to are not read.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node at level levels-1
+@param     	pageId
+                Page id for node
+@param		first
+				First child index to consider (after child of current key)
+@param		last
+				Last child index to consider
+@param     	keys
+                Sorted array of n keys
+@param     	n
+                Number of keys
+@param     	next
+                Index of current key
+@return		Index of first child not considered for prefetch.
+*/
+static id_t sbtreeGetBatchPrefetch(sbtreeState *state, void *buf, id_t pageId, id_t first, id_t last, int8_t *keys, uint32_t n, uint32_t next)
+{
+	count_t	count = SBTREE_GET_COUNT(buf);
+	id_t	child = first;
+	int64_t	sepKey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+
+	if (state->buffer->storage->prefetchPage == NULL)
+		return -1;
+
+	for ( ; child <= last && child < count; child++)
+	{	/* Skip keys in previous child. Key i is upper bound of child i. Last child of full node has no key. */
+		while (next < n && state->compareKey(keys + next*state->keySize, sbtreeSeparator(state, buf, child-1, sepKey)) <= 0)
+			next++;
+		if (next >= n)
+			break;
+		if (child < state->maxInteriorRecordsPerPage && state->compareKey(keys + next*state->keySize, sbtreeSeparator(state, buf, child, sepKey)) > 0)
+			continue;
+		sbtreePrefetchLeaves(state, buf, pageId, child, child);
+	}
+	return child;
+}
+
+/**
+@brief     	Searches node for sorted keys starting at keys[*next]. Interior nodes pass keys to the child
+			the first key routes to and return when a key routes to another child. Leaf nodes are read once
+			for all keys up to their largest key.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageId
+                Page id of node
+@param     	level
+                Level of node (state->levels for leaf)
+@param     	keys
+                Sorted keys
+@param     	n
+                Number of keys
+@param     	next
+                Index of next key to find (updated)
+@param     	outData
+                Pre-allocated memory for n data values
+@param     	outFound
+                Pre-allocated array of n flags set to 1 if key found and 0 otherwise
+@return		Number of keys processed (0 if leaf and key at next is after all keys in leaf) or -1 if error.
+*/
+static int32_t sbtreeGetBatchNode(sbtreeState *state, id_t pageId, int8_t level, int8_t *keys, uint32_t n, uint32_t *next, int8_t *outData, int8_t *outFound)
+{
+	void 	*buf, *key;
+	int32_t	processed = 0, r;
+	id_t	childNum, childId, prevChild = 0, prefetched = 0;
+	count_t	count, lastChild;
+	int8_t	onPath;
+
+	if (level == state->levels)
+	{	/* Leaf node. Process keys up to largest key on page. */
+		buf = sbtreeReadOnlyPage(state, pageId);
+		if (buf == NULL)
+			return -1;
+		if (SBTREE_GET_COUNT(buf) == 0)
+			return 0;
+
+		for ( ; *next < n; (*next)++, processed++)
+		{
+			key = keys + *next * state->keySize;
+			if (state->compareKey(key, sbtreeGetMaxKey(state, buf)) > 0)
+				break;
+			childNum = sbtreeSearchNode(state, buf, key, pageId, 0);
+			outFound[*next] = childNum != -1;
+			if (childNum != -1)
+				memcpy(outData + *next * state->dataSize, sbtreeLeafData(state, buf, childNum), state->dataSize);
+		}
+		return processed;
+	}
+
+	onPath = pageId == state->activePath[level];
+	while (*next < n)
+	{	/* Child may have replaced node in buffer. Read again (buffer hit if pinned). */
+		/* Modified node on active path is written to a new page if it was replaced. */
+		if (onPath)
+			pageId = state->activePath[level];
+		buf = readPage(state->buffer, pageId);
+		if (buf == NULL)
+			return -1;
+		dbbufferPin(state->buffer, buf, level);
+
+		key = keys + *next * state->keySize;
+		count = SBTREE_GET_COUNT(buf);
+		childNum = sbtreeSearchNode(state, buf, key, pageId, 0);
+
+		/* Return to parent once keys route to a different child or to the last child (key may be after node). Parent routes next key. */
+		/* Full node above leaf level has a last child with no key. */
+		lastChild = level == state->levels-1 && count > state->maxInteriorRecordsPerPage ? count-1 : count;
+		if (processed > 0 && (childNum != prevChild || childNum >= lastChild))
+			break;
+		prevChild = childNum;
+
+		/* Above leaf level, keys are upper bounds of children so there is no child after last key */
+		if (level == state->levels-1 && childNum >= count)
+			childId = -1;
+		else
+			childId = getChildPageId(state, buf, pageId, level, childNum);
+
+		if (level == state->levels-1 && childId != -1)
+		{	/* Keep leaves of the next keys in flight while child is searched */
+			if (prefetched <= childNum)
+				prefetched = childNum+1;
+			prefetched = sbtreeGetBatchPrefetch(state, buf, pageId, prefetched, childNum+SBTREE_PREFETCH_PAGES, keys, n, *next);
+		}
+
+		r = childId == -1 ? 0 : sbtreeGetBatchNode(state, childId, level+1, keys, n, next, outData, outFound);
+		if (r < 0)
+			return -1;
+		if (r == 0)
+		{	/* Key routes to child but is not in child */
+			outFound[(*next)++] = 0;
+			r = 1;
+		}
+		processed += r;
+	}
+	return processed;
+}
+
+/**
+@brief     	Given an array of keys, returns data associated with each key.
+			Keys are sorted in place (unless already sorted) and results are in sorted key order.
+			Each node on the path to the keys is searched once for all keys routed through it.
+@param     	state
+                SBTree algorithm state structure
+@param     	keys
+                Array of n keys (sorted on return)
+@param     	n
+                Number of keys
+@param     	outData
+                Pre-allocated memory for n data values. Data for keys[i] is copied to outData + i*dataSize.
+@param     	outFound
+                Pre-allocated array of n flags. outFound[i] is 1 if keys[i] was found and 0 otherwise.
+@return		Return 0 if success. Non-zero value if error.
+*/
+int8_t sbtreeGetBatch(sbtreeState *state, void *keys, uint32_t n, void *outData, int8_t *outFound)
+{
+	uint32_t next = 0;
+
+	if (n == 0)
+		return 0;
+
+	sbtreeSortKeys(state, (int8_t*) keys, n);
+	while (next < n)
+	{
+		if (sbtreeGetBatchNode(state, state->activePath[0], 0, (int8_t*) keys, n, &next, (int8_t*) outData, outFound) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+@brief     	Adds records of leaf with key in range to summary.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing leaf
+@param     	pageId
+                Page id of leaf
+@param     	minKey
+                Minimum key (inclusive). NULL for no minimum.
+@param     	maxKey
+                Maximum key (inclusive). NULL for no maximum.
+@param     	out
+                Summary updated
+*/
+static void sbtreeAggregateLeaf(sbtreeState *state, void *buf, id_t pageId, void *minKey, void *maxKey, sbtreeSummary *out)
+{
+	int64_t	key[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+	count_t	i, count = SBTREE_GET_COUNT(buf);
+
+	if (count == 0)
+		return;
+	/* Search returns record <= minKey so records before minKey are skipped */
+	i = minKey == NULL ? 0 : sbtreeSearchNode(state, buf, minKey, pageId, 1);
+	for ( ; i < count; i++)
+	{
+		sbtreeLeafKey(state, buf, i, key);
+		if (minKey != NULL && state->compareKey(key, minKey) < 0)
+			continue;
+		if (maxKey != NULL && state->compareKey(key, maxKey) > 0)
+			break;
+		sbtreeSummaryAdd(state, out, key, sbtreeLeafData(state, buf, i));
+	}
+}
+
+/**
+@brief     	Adds records of subtree with key in range to summary. Children with a summary that is inside
+			the range are added without being read. Children at the range boundaries are read.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageId
+                Page id of interior node
+@param     	level
+                Level of node (0 is root)
+@param     	minKey
+                Minimum key (inclusive). NULL for no minimum.
+@param     	maxKey
+                Maximum key (inclusive). NULL for no maximum.
+@param     	out
+                Summary updated
+@return		Return 0 if success. Non-zero value if error.
+*/
+static int8_t sbtreeAggregateNode(sbtreeState *state, id_t pageId, int8_t level, void *minKey, void *maxKey, sbtreeSummary *out)
+{
+	sbtreeSummary child;
+	void	*buf;
+	id_t	childId;
+	int32_t	i, first, last;
+	count_t	count;
+	int8_t	onPath = pageId == state->activePath[level];
+
+	buf = readPage(state->buffer, pageId);
+	if (buf == NULL)
+		return -1;
+	dbbufferPin(state->buffer, buf, level);
+	count = SBTREE_GET_COUNT(buf);
+
+	/* Above leaf level, keys are upper bounds of children so there is no child after last key */
+	last = level == state->levels-1 ? count-1 : count;
+	if (maxKey != NULL && (int32_t) sbtreeSearchNode(state, buf, maxKey, pageId, 1) < last)
+		last = sbtreeSearchNode(state, buf, maxKey, pageId, 1);
+	first = minKey == NULL ? 0 : sbtreeSearchNode(state, buf, minKey, pageId, 1);
+
+	for (i = first; i <= last; i++)
+	{
+		if (i > first)
+		{	/* Child may have replaced node in buffer. Read again (buffer hit if pinned). */
+			/* Modified node on active path is written to a new page if it was replaced. */
+			if (onPath)
+				pageId = state->activePath[level];
+			buf = readPage(state->buffer, pageId);
+			if (buf == NULL)
+				return -1;
+			dbbufferPin(state->buffer, buf, level);
+		}
+
+		childId = getChildPageId(state, buf, pageId, level, i);
+		if (childId == -1)
+			continue;
+
+		/* Last child of a node on active path above leaf level is changing and has no summary */
+		if (level == state->levels-1 || !onPath || i < count)
+		{
+			sbtreeSummaryCopy(state, sbtreeSummaryPtr(state, buf, i), &child, 0);
+			if (child.count == 0 || (minKey != NULL && state->compareKey(child.maxKey, minKey) < 0)
+				|| (maxKey != NULL && state->compareKey(child.minKey, maxKey) > 0))
+				continue;
+			if ((minKey == NULL || state->compareKey(child.minKey, minKey) >= 0)
+				&& (maxKey == NULL || state->compareKey(child.maxKey, maxKey) <= 0))
+			{
+				sbtreeSummaryMerge(state, out, &child);
+				continue;
+			}
+		}
+
+		if (level < state->levels-1)
+		{
+			if (sbtreeAggregateNode(state, childId, level+1, minKey, maxKey, out) != 0)
+				return -1;
+		}
+		else
+		{
+			buf = sbtreeReadOnlyPage(state, childId);
+			if (buf == NULL)
+				return -1;
+			sbtreeAggregateLeaf(state, buf, childId, minKey, maxKey, out);
+		}
+	}
+	return 0;
+}
+
+/**
+@brief     	Computes record count, smallest and largest key and minimum, maximum and sum of aggregate column
+			for records with key in range (including records in output buffer). Children inside the range are
+			taken from summaries in interior nodes, so only nodes and leaves at the range boundaries are read.
+@param     	state
+                SBTree algorithm state structure
+@param     	minKey
+                Minimum key (inclusive). NULL for no minimum.
+@param     	maxKey
+                Maximum key (inclusive). NULL for no maximum.
+@param     	out
+                Summary of records in range
+@return		Return 0 if success. Non-zero value if error (or aggregates not used).
+*/
+int8_t sbtreeAggregate(sbtreeState *state, void *minKey, void *maxKey, sbtreeSummary *out)
+{
+	out->count = 0;
+	out->sum = 0;
+	out->bitmap = 0;
+	if (state->aggregate == NULL)
+		return -1;
+	if (sbtreeAggregateNode(state, state->activePath[0], 0, minKey, maxKey, out) != 0)
+		return -1;
+
+	/* Records in output buffer are not in tree yet */
+	sbtreeAggregateLeaf(state, state->writeBuffer, 0, minKey, maxKey, out);
+	return 0;
 }
 
 /**
@@ -585,6 +3133,10 @@ int8_t sbtreeGet(sbtreeState *state, void* key, void *data)
 */
 int8_t sbtreeFlush(sbtreeState *state)
 {
+	/* Values are on storage before records that refer to them */
+	if (state->valueLog != NULL && sbtreeValueLogFlush(state) != 0)
+		return -1;
+
 	int32_t pageNum = writePage(state->buffer, state->writeBuffer);	
 
 	/* Add pointer to page to B-tree structure */		
@@ -598,11 +3150,17 @@ int8_t sbtreeFlush(sbtreeState *state)
 	*/
 	// TODO: Look at what the key should be when flush. Needs to be one bigger than data set 
 
-	void *maxkey = state->writeBuffer + state->recordSize * (SBTREE_GET_COUNT(state->writeBuffer)-1) + state->headerSize;
-	int32_t mkey = *((int32_t*) maxkey)+1;
-	maxkey = state->writeBuffer + state->headerSize;
-	int32_t minKey = *((int32_t*) maxkey);
-	if (sbtreeUpdateIndex(state, &minKey, &mkey, pageNum) != 0)
+	void *maxkey = sbtreeGetMaxKey(state, state->writeBuffer);
+	int64_t mkey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)], minKey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)], sep[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];
+	sbtreeSummary summary;
+	sbtreeNextKey(state, maxkey, mkey);
+	sbtreeSeparatorKey(state, maxkey, mkey, sep);
+	memcpy(minKey, state->writeBuffer + state->headerSize, state->keySize);
+	if (state->spline != NULL)
+		splineAdd(state->spline, sbtreeIntKey(state, minKey), pageNum);
+	sbtreeLeafSummary(state, state->writeBuffer, &summary);
+	sbtreeLeafFilterSet(state, state->writeBuffer, pageNum);
+	if (sbtreeUpdateIndex(state, minKey, sep, pageNum, &summary) != 0)
 		return -1;
 		
 	state->buffer->storage->flush(state->buffer->storage);
@@ -612,31 +3170,249 @@ int8_t sbtreeFlush(sbtreeState *state)
 	return 0;
 }
 
+/**
+@brief     	Writes records in output buffer and active path nodes to storage so tree can be reopened
+			with sbtreeOpen(). If checkpoint is used, also writes a superblock.
+@param     	state
+                SBTree algorithm state structure
+@return		Return 0 if success. Non-zero value if error.
+*/
+int8_t sbtreeSync(sbtreeState *state)
+{
+	if (SBTREE_GET_COUNT(state->writeBuffer) > 0 && sbtreeFlush(state) != 0)
+		return -1;
+
+	if (state->checkpoint != NULL)
+		return sbtreeCheckpointWrite(state);
+
+	if (sbtreeWritePath(state) != 0)
+		return -1;
+	state->buffer->storage->flush(state->buffer->storage);
+	return 0;
+}
+
 
 /**
-@brief     	Initialize iterator on SBTree structure.
+@brief     	Returns pointer to key of record in leaf. Keys of leaves with SBTREE_DELTA_KEYS are decoded into iterator.
 @param     	state
                 SBTree algorithm state structure
 @param     	it
                 SBTree iterator state structure
+@param     	buf
+                Buffer containing leaf
+@param     	i
+                Record number
 */
-void sbtreeInitIterator(sbtreeState *state, sbtreeIterator *it)
-{	
-	/* Find start location */
-	/* Starting at root search for key */
-	int8_t 	l;
+static void* sbtreeIteratorKey(sbtreeState *state, sbtreeIterator *it, void *buf, count_t i)
+{
+	if (state->parameters & SBTREE_DELTA_KEYS)
+	{
+		sbtreeLeafKey(state, buf, i, &it->key);
+		return &it->key;
+	}
+	return buf+state->headerSize+i*state->recordSize;
+}
+
+/**
+@brief     	Returns leaf if it is in read-ahead frames. Returns NULL otherwise.
+@param     	state
+                SBTree algorithm state structure
+@param     	pageId
+                Page id of leaf
+*/
+static void* sbtreeReadAheadPage(sbtreeState *state, id_t pageId)
+{
+	sbtreeReadAhead *ra = state->readAhead;
+
+	/* Page ids may be reused after pages are written (e.g. storage wraps around) */
+	if (ra == NULL || ra->count == 0 || ra->writeId != state->buffer->nextPageWriteId
+		|| pageId < ra->firstPage || pageId >= ra->firstPage + ra->count)
+		return NULL;
+	return (int8_t*) ra->pages + (size_t) (pageId - ra->firstPage) * state->buffer->pageSize;
+}
+
+/**
+@brief     	Reads leaf that iterator moves to. Leaf and following leaves with adjacent page ids in node above leaves
+			are read with one storage request into read-ahead frames.
+@param     	state
+                SBTree algorithm state structure
+@param     	buf
+                Buffer containing node above leaves
+@param     	pageId
+                Page id of node above leaves
+@param     	childNum
+                Child index of leaf in node
+@param     	leafId
+                Page id of leaf
+@return		Return pointer to leaf (must not be modified) or NULL if error.
+*/
+static void* sbtreeReadLeaf(sbtreeState *state, void *buf, id_t pageId, count_t childNum, id_t leafId)
+{
+	sbtreeReadAhead *ra = state->readAhead;
+	void	*leaf = sbtreeReadAheadPage(state, leafId);
+	id_t	n = 1;
+	int32_t	numRead;
+	count_t	count = SBTREE_GET_COUNT(buf);
+
+	if (leaf != NULL)
+		return leaf;
+
+	/* Zero-copy leaves are read from storage memory without a copy */
+	if (ra == NULL || (state->parameters & SBTREE_ZERO_COPY_READ))
+		return sbtreeReadOnlyPage(state, leafId);
+
+	while (n < ra->numPages && childNum+n < count && getChildPageId(state, buf, pageId, state->levels-1, childNum+n) == leafId+n)
+		n++;
+	if (n == 1)
+		return sbtreeReadOnlyPage(state, leafId);
+
+	numRead = dbbufferReadPages(state->buffer, leafId, n, ra->pages);
+	ra->count = numRead > 0 ? numRead : 0;
+	ra->firstPage = leafId;
+	ra->writeId = state->buffer->nextPageWriteId;
+	ra->numRequests++;
+	ra->numReads += ra->count;
+	if (numRead == -1)
+		return sbtreeReadOnlyPage(state, leafId);
+	return numRead > 0 ? ra->pages : NULL;
+}
+
+/**
+@brief     	Returns 1 if child may have records with values in iterator filter range (bitmap of child has a bucket
+			of range). Returns 1 if there is no filter, if child has no bitmap and if iterator ends in child (child
+			is after maximum key or before minimum key for reverse iterator).
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+@param     	buf
+                Buffer containing interior node
+@param     	pageId
+                Page id of node
+@param     	l
+                Level of node
+@param     	childNum
+                Child index
+@param     	reverse
+                1 for reverse iterator
+*/
+static int8_t sbtreeIteratorChildMatches(sbtreeState *state, sbtreeIterator *it, void *buf, id_t pageId, int8_t l, id_t childNum, int8_t reverse)
+{
+	uint64_t bitmap = 0;
+	count_t	count = SBTREE_GET_COUNT(buf);
+
+	if (state->bitmap == NULL || (it->minData == NULL && it->maxData == NULL))
+		return 1;
+	/* Last child of a node on active path above leaf level is changing and has no summary */
+	if (l < state->levels-1 && childNum == count && pageId == state->activePath[l])
+		return 1;
+	/* Keys of child are at least key before it and at most key after it */
+	if (!reverse && childNum > 0 && it->maxKey != NULL && state->compareKey(buf + state->headerSize + state->keySize*(childNum-1), it->maxKey) > 0)
+		return 1;
+	if (reverse && childNum < count && childNum < state->maxInteriorRecordsPerPage && it->minKey != NULL
+		&& state->compareKey(buf + state->headerSize + state->keySize*childNum, it->minKey) < 0)
+		return 1;
+	memcpy(&bitmap, sbtreeSummaryPtr(state, buf, childNum) + SBTREE_AGGREGATE_SIZE(state), state->bitmap->bitmapSize);
+	return (bitmap & sbtreeBitmapRange(state, it->minData, it->maxData)) != 0;
+}
+
+/**
+@brief     	Returns 1 if record data has value in iterator filter range or if there is no filter.
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+@param     	data
+                Data of record
+*/
+static int8_t sbtreeIteratorDataMatches(sbtreeState *state, sbtreeIterator *it, void *data)
+{
+	int64_t	value;
+	uint8_t	size;
+
+	if (state->bitmap == NULL)
+		return 1;
+	size = state->bitmap->size;
+	value = sbtreeColumnValue(data + state->bitmap->offset, size);
+	return (it->minData == NULL || value >= sbtreeColumnValue(it->minData, size))
+		&& (it->maxData == NULL || value <= sbtreeColumnValue(it->maxData, size));
+}
+
+/**
+@brief     	Returns first record in leaf with key >= search key (count of leaf if none). NULL key returns first record.
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+@param     	buf
+                Buffer containing leaf
+@param     	pageId
+                Page id of leaf
+@param     	key
+                Search key
+*/
+static count_t sbtreeIteratorFirst(sbtreeState *state, sbtreeIterator *it, void *buf, id_t pageId, void *key)
+{
+	count_t i, count = SBTREE_GET_COUNT(buf);
+
+	if (key == NULL)
+		return 0;
+
+	/* Search finds a record <= key. Move to first record >= key including duplicates before it. */
+	i = sbtreeSearchNode(state, buf, key, pageId, 1);
+	while (i < count && state->compareKey(sbtreeIteratorKey(state, it, buf, i), key) < 0)
+		i++;
+	while (i > 0 && state->compareKey(sbtreeIteratorKey(state, it, buf, i-1), key) >= 0)
+		i--;
+	return i;
+}
+
+/**
+@brief     	Descends from node at level l of iterator path to first record >= key.
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+@param     	l
+                Level of node
+@param     	nextId
+                Page id of node
+@param     	key
+                Search key (NULL for first record)
+*/
+static void sbtreeIteratorDescend(sbtreeState *state, sbtreeIterator *it, int8_t l, id_t nextId, void *key)
+{
 	void	*buf;	
-	id_t 	childNum, nextId = state->activePath[0];
-	
+	id_t 	childNum;
+	int32_t	last;
+
 	it->currentBuffer = NULL;
+	it->numNodes = state->numNodes;
+	if (l == 0 || it->activeLevels > l)
+		it->activeLevels = l;
 
-	for (l=0; l < state->levels; l++)
+	for ( ; l < state->levels; l++)
 	{		
 		it->activeIteratorPath[l] = nextId;		
+		if (it->activeLevels == l && nextId == state->activePath[l])
+			it->activeLevels++;
 		buf = readPage(state->buffer, nextId);		
+		if (buf == NULL)
+			return;
+		dbbufferPin(state->buffer, buf, l);
 
-		/* Find the key within the node. Sorted by key. Use binary search. */
-		childNum = sbtreeSearchNode(state, buf, it->minKey, nextId, 1);
+		/* Find the key within the node. Sorted by key. Use binary search. No key starts at first child. */
+		childNum = key == NULL ? 0 : sbtreeSearchNode(state, buf, key, nextId, 1);
+
+		/* Children without values in filter range are skipped. Records of later children are after key. */
+		last = l == state->levels-1 ? SBTREE_GET_COUNT(buf)-1 : SBTREE_GET_COUNT(buf);
+		while ((int32_t) childNum < last && !sbtreeIteratorChildMatches(state, it, buf, nextId, l, childNum, 0))
+		{
+			childNum++;
+			key = NULL;
+		}
+		if (l == state->levels-1)
+			sbtreePrefetchLeaves(state, buf, nextId, childNum+1, childNum+SBTREE_PREFETCH_PAGES);
 		nextId = getChildPageId(state, buf, nextId, l, childNum);
 		if (nextId == -1)
 			return;	
@@ -646,10 +3422,90 @@ void sbtreeInitIterator(sbtreeState *state, sbtreeIterator *it)
 
 	/* Search the leaf node and return search result */
 	it->activeIteratorPath[l] = nextId;	
-	buf = readPage(state->buffer, nextId);
+	buf = sbtreeReadOnlyPage(state, nextId);
 	it->currentBuffer = buf;
-	childNum = sbtreeSearchNode(state, buf, it->minKey, nextId, 1);		
-	it->lastIterRec[l] = childNum;
+	if (buf == NULL)
+		return;
+	it->lastIterRec[l] = sbtreeIteratorFirst(state, it, buf, nextId, key);
+}
+
+/**
+@brief     	Initialize iterator on SBTree structure.
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+*/
+void sbtreeInitIterator(sbtreeState *state, sbtreeIterator *it)
+{	
+	/* Starting at root search for key */
+	sbtreeIteratorDescend(state, it, 0, state->activePath[0], it->minKey);
+}
+
+/**
+@brief     	Moves iterator to first record >= key using current iterator path. Path is climbed only until key
+			is between separators of a node (a node without siblings that may hold key) and followed down from there.
+			If nodes were added since the path was read, search starts at the root.
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+@param     	key
+                Search key
+*/
+void sbtreeIteratorSeek(sbtreeState *state, sbtreeIterator *it, void *key)
+{	
+	int8_t 	l = state->levels;
+	void	*buf;
+	id_t	pageId, childNum;
+	count_t	count;
+
+	if (it->currentBuffer != NULL && it->numNodes == state->numNodes)
+	{
+		/* Key is in current leaf. Buffer page may have been reused so leaf is found again. Nodes on path are only
+		   checked if they are in buffer as reading one that does not contain key costs more than init. */
+		pageId = it->activeIteratorPath[l];
+		buf = sbtreeReadAheadPage(state, pageId);
+		if (buf == NULL)
+			buf = (state->parameters & SBTREE_ZERO_COPY_READ) ? sbtreeReadOnlyPage(state, pageId) : dbbufferGetPage(state->buffer, pageId);
+		count = buf != NULL ? SBTREE_GET_COUNT(buf) : 0;
+		if (count > 0 && state->compareKey(key, sbtreeIteratorKey(state, it, buf, 0)) > 0
+			&& state->compareKey(key, sbtreeIteratorKey(state, it, buf, count-1)) <= 0)
+		{
+			it->currentBuffer = buf;
+			it->lastIterRec[l] = sbtreeIteratorFirst(state, it, buf, pageId, key);
+			return;
+		}
+
+		/* Key is in a node if it is after the first separator and before the last separator */
+		for (l=state->levels-1; l > 0; l--)
+		{
+			if (l < it->activeLevels)
+				it->activeIteratorPath[l] = state->activePath[l];
+			pageId = it->activeIteratorPath[l];
+			buf = dbbufferGetPage(state->buffer, pageId);
+			if (buf == NULL)
+				continue;
+			dbbufferPin(state->buffer, buf, l);
+
+			/* Last child of full node above leaves has no separator */
+			count = SBTREE_GET_COUNT(buf);
+			if (count > state->maxInteriorRecordsPerPage)
+				count = state->maxInteriorRecordsPerPage;
+			childNum = sbtreeSearchNode(state, buf, key, pageId, 1);
+			if (childNum > 0 && childNum < count)
+			{
+				if (l == state->levels-1)
+					sbtreePrefetchLeaves(state, buf, pageId, childNum+1, childNum+SBTREE_PREFETCH_PAGES);
+				it->lastIterRec[l] = childNum;
+				sbtreeIteratorDescend(state, it, l+1, getChildPageId(state, buf, pageId, l, childNum), key);
+				return;
+			}
+		}
+	}
+
+	/* Root is always current */
+	sbtreeIteratorDescend(state, it, 0, state->activePath[0], key);
 }
 
 
@@ -669,6 +3525,7 @@ int8_t sbtreeNext(sbtreeState *state, sbtreeIterator *it, void **key, void **dat
 	void *buf = it->currentBuffer;
 	int8_t l=state->levels;
 	id_t nextPage;
+	int16_t last;
 
 	/* No current page to search */
 	if (buf == NULL)
@@ -686,13 +3543,20 @@ int8_t sbtreeNext(sbtreeState *state, sbtreeIterator *it, void **key, void **dat
 				/* Advance to next page. Requires examining active path. */
 				for (l=state->levels-1; l >= 0; l--)
 				{	
+					/* Active path node is written to a new page if it is evicted from buffer */
+					if (l < it->activeLevels)
+						it->activeIteratorPath[l] = state->activePath[l];
 					buf = readPage(state->buffer, it->activeIteratorPath[l]);
 					if (buf == NULL)
 						return 0;						
+					dbbufferPin(state->buffer, buf, l);
 
-					int8_t count = SBTREE_GET_COUNT(buf);
+					int16_t count = SBTREE_GET_COUNT(buf);
 					if (l == state->levels-1)
 						count--;
+					/* Children without values in filter range are skipped */
+					while (it->lastIterRec[l] < count && !sbtreeIteratorChildMatches(state, it, buf, it->activeIteratorPath[l], l, it->lastIterRec[l]+1, 0))
+						it->lastIterRec[l]++;
 					if (it->lastIterRec[l] < count)
 					{
 						it->lastIterRec[l]++;
@@ -701,19 +3565,35 @@ int8_t sbtreeNext(sbtreeState *state, sbtreeIterator *it, void **key, void **dat
 					it->lastIterRec[l] = 0;
 				}
 				if (l == -1)
-					return 0;		/* Exhausted entire tree */
+				{	/* Exhausted entire tree. Path is no longer valid for sbtreeIteratorSeek(). */
+					it->currentBuffer = NULL;
+					return 0;
+				}
+				if (it->activeLevels > l+1)
+					it->activeLevels = l+1;
 
 				for ( ; l < state->levels; l++)
 				{						
 					nextPage = it->activeIteratorPath[l];
+
+					/* First child with values in filter range. Bitmap of node includes a value of one of them. */
+					last = l == state->levels-1 ? SBTREE_GET_COUNT(buf)-1 : SBTREE_GET_COUNT(buf);
+					while (it->lastIterRec[l] < last && !sbtreeIteratorChildMatches(state, it, buf, nextPage, l, it->lastIterRec[l], 0))
+						it->lastIterRec[l]++;
+					if (l == state->levels-1)
+						sbtreePrefetchLeaves(state, buf, nextPage, it->lastIterRec[l]+1, it->lastIterRec[l]+SBTREE_PREFETCH_PAGES);
 					nextPage = getChildPageId(state, buf, nextPage, l, it->lastIterRec[l]);
 					if (nextPage == -1)
 						return 0;	
 					
 					it->activeIteratorPath[l+1] = nextPage;
-					buf = readPage(state->buffer, nextPage);
+					if (l+1 < state->levels && it->activeLevels == l+1 && nextPage == state->activePath[l+1])
+						it->activeLevels++;
+					buf = l+1 < state->levels ? readPage(state->buffer, nextPage) : sbtreeReadLeaf(state, buf, it->activeIteratorPath[l], it->lastIterRec[l], nextPage);
 					if (buf == NULL)
 						return 0;	
+					if (l+1 < state->levels)
+						dbbufferPin(state->buffer, buf, l+1);
 				}
 				it->currentBuffer = buf;
 				break;				
@@ -721,8 +3601,8 @@ int8_t sbtreeNext(sbtreeState *state, sbtreeIterator *it, void **key, void **dat
 		}
 		
 		/* Get record */	
-		*key = buf+state->headerSize+it->lastIterRec[l]*state->recordSize;
-		*data = *key+state->keySize;
+		*key = sbtreeIteratorKey(state, it, buf, it->lastIterRec[l]);
+		*data = sbtreeLeafData(state, buf, it->lastIterRec[l]);
 		it->lastIterRec[l]++;
 		
 		/* Check that record meets filter constraints */
@@ -730,6 +3610,201 @@ int8_t sbtreeNext(sbtreeState *state, sbtreeIterator *it, void **key, void **dat
 			continue;
 		if (it->maxKey != NULL && state->compareKey(*key, it->maxKey) > 0)
 			return 0;	/* Passed maximum range */
+		if (!sbtreeIteratorDataMatches(state, it, *data))
+			continue;
+		return 1;
+	}
+}
+
+/**
+@brief     	Returns number of records in leaf with key <= maximum key of iterator (all records if no maximum).
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+@param     	buf
+                Buffer containing leaf
+@param     	pageId
+                Page id of leaf
+*/
+static count_t sbtreeCountToMaxKey(sbtreeState *state, sbtreeIterator *it, void *buf, id_t pageId)
+{
+	int16_t i, count = SBTREE_GET_COUNT(buf);
+
+	if (it->maxKey == NULL || count == 0)
+		return count;
+
+	/* Search finds a record <= key (first record if none). Duplicates of key may follow it. */
+	i = sbtreeSearchNode(state, buf, it->maxKey, pageId, 1);
+	if (state->compareKey(sbtreeIteratorKey(state, it, buf, i), it->maxKey) > 0)
+		return 0;
+	while (i+1 < count && state->compareKey(sbtreeIteratorKey(state, it, buf, i+1), it->maxKey) <= 0)
+		i++;
+	return i+1;
+}
+
+/**
+@brief     	Initialize iterator that returns records in descending key order starting at maxKey.
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+*/
+void sbtreeInitReverseIterator(sbtreeState *state, sbtreeIterator *it)
+{
+	int8_t 	l;
+	void	*buf;
+	int16_t	childNum, last;
+	id_t 	nextId = state->activePath[0];
+	int8_t	skipped = 0;
+
+	it->currentBuffer = NULL;
+	it->activeLevels = 0;
+
+	/* Find last leaf with a key <= maxKey. Path is used once records in output buffer are returned. */
+	for (l=0; l < state->levels; l++)
+	{
+		it->activeIteratorPath[l] = nextId;
+		if (it->activeLevels == l && nextId == state->activePath[l])
+			it->activeLevels++;
+		buf = readPage(state->buffer, nextId);
+		if (buf == NULL)
+			return;
+		dbbufferPin(state->buffer, buf, l);
+
+		/* Node above leaves has a child for each key. Other nodes have one more child than keys. */
+		last = SBTREE_GET_COUNT(buf);
+		if (l == state->levels-1)
+			last--;
+		childNum = it->maxKey == NULL || skipped ? last : sbtreeSearchNode(state, buf, it->maxKey, nextId, 1);
+		if (childNum > last)
+			childNum = last;
+
+		/* Children without values in filter range are skipped. Records of earlier children are before maxKey. */
+		while (childNum > 0 && !sbtreeIteratorChildMatches(state, it, buf, nextId, l, childNum, 1))
+		{
+			childNum--;
+			skipped = 1;
+		}
+		nextId = childNum < 0 ? -1 : getChildPageId(state, buf, nextId, l, childNum);
+		if (nextId == -1)
+			break;
+		it->lastIterRec[l] = childNum;
+	}
+	it->activeIteratorPath[state->levels] = nextId;
+
+	/* Records in output buffer are after all records in tree */
+	it->lastIterRec[state->levels] = sbtreeCountToMaxKey(state, it, state->writeBuffer, 0);
+	if (it->lastIterRec[state->levels] > 0)
+	{
+		it->currentBuffer = state->writeBuffer;
+		return;
+	}
+	if (nextId == -1)
+		return;
+
+	buf = sbtreeReadOnlyPage(state, nextId);
+	it->currentBuffer = buf;
+	if (buf == NULL)
+		return;
+	it->lastIterRec[state->levels] = sbtreeCountToMaxKey(state, it, buf, nextId);
+}
+
+/**
+@brief     	Requests previous key, data pair from reverse iterator.
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+@param     	key
+                Key for record (pointer returned)
+@param     	data
+                Data for record (pointer returned)
+*/
+int8_t sbtreePrev(sbtreeState *state, sbtreeIterator *it, void **key, void **data)
+{
+	void	*buf = it->currentBuffer;
+	int8_t	l;
+	id_t	nextPage;
+	count_t	i;
+
+	/* No current page to search */
+	if (buf == NULL)
+		return 0;
+
+	/* Number of records left in leaf is stored at leaf level. Interior levels store child being visited. */
+	while (1)
+	{
+		if (it->lastIterRec[state->levels] == 0)
+		{	/* Read previous page */
+			nextPage = it->activeIteratorPath[state->levels];
+			if (buf != state->writeBuffer)
+			{	/* Move to previous child at lowest level that is not at its first child */
+				for (l=state->levels-1; l >= 0; l--)
+				{
+					/* Active path node is written to a new page if it is evicted from buffer */
+					if (l < it->activeLevels)
+						it->activeIteratorPath[l] = state->activePath[l];
+					buf = readPage(state->buffer, it->activeIteratorPath[l]);
+					if (buf == NULL)
+						return 0;
+					dbbufferPin(state->buffer, buf, l);
+					/* Children without values in filter range are skipped */
+					while (it->lastIterRec[l] > 0 && !sbtreeIteratorChildMatches(state, it, buf, it->activeIteratorPath[l], l, it->lastIterRec[l]-1, 1))
+						it->lastIterRec[l]--;
+					if (it->lastIterRec[l] > 0)
+					{
+						it->lastIterRec[l]--;
+						break;
+					}
+				}
+				if (l == -1)
+					return 0;		/* Exhausted entire tree */
+				if (it->activeLevels > l+1)
+					it->activeLevels = l+1;
+
+				/* Follow last child of nodes below */
+				for ( ; l < state->levels; l++)
+				{
+					nextPage = getChildPageId(state, buf, it->activeIteratorPath[l], l, it->lastIterRec[l]);
+					if (nextPage == -1)
+						return 0;
+					it->activeIteratorPath[l+1] = nextPage;
+					if (l+1 < state->levels)
+					{
+						buf = readPage(state->buffer, nextPage);
+						if (buf == NULL)
+							return 0;
+						dbbufferPin(state->buffer, buf, l+1);
+						it->lastIterRec[l+1] = SBTREE_GET_COUNT(buf) - (l+1 == state->levels-1 ? 1 : 0);
+						while (it->lastIterRec[l+1] > 0 && !sbtreeIteratorChildMatches(state, it, buf, nextPage, l+1, it->lastIterRec[l+1], 1))
+							it->lastIterRec[l+1]--;
+					}
+				}
+			}
+			if (nextPage == -1)
+				return 0;		/* Tree has no leaves */
+
+			buf = sbtreeReadOnlyPage(state, nextPage);
+			it->currentBuffer = buf;
+			if (buf == NULL)
+				return 0;
+			it->lastIterRec[state->levels] = SBTREE_GET_COUNT(buf);
+			continue;
+		}
+
+		/* Get record */
+		i = --it->lastIterRec[state->levels];
+		*key = sbtreeIteratorKey(state, it, buf, i);
+		*data = sbtreeLeafData(state, buf, i);
+
+		/* Check that record meets filter constraints */
+		if (it->maxKey != NULL && state->compareKey(*key, it->maxKey) > 0)
+			continue;
+		if (it->minKey != NULL && state->compareKey(*key, it->minKey) < 0)
+			return 0;	/* Passed minimum range */
+		if (!sbtreeIteratorDataMatches(state, it, *data))
+			continue;
 		return 1;
 	}
 }
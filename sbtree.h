@@ -41,6 +41,12 @@
 #include <stdlib.h>
 
 #include "dbbuffer.h"
+#include "keySearch.h"
+#include "spline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /* Define type for page ids (physical and logical). */
 typedef uint32_t id_t;
@@ -76,16 +82,123 @@ typedef uint16_t count_t;
 
 #define MAX_LEVEL 8
 
+/* Configuration options (bit flags for parameters) */
+#define SBTREE_USE_INTERPOLATION	1		/* Interpolation-sequential node search for 4 and 8 byte integer keys (e.g. timestamps) */
+#define SBTREE_ZERO_COPY_READ		2		/* Get, batch get and iterator use leaf pages in storage without copy if storage supports mapPage (e.g. mmapStorage) */
+#define SBTREE_PAGE_CHECKSUM		4		/* Pages store CRC32C checksum in header (4 bytes) that is verified when page is read from storage */
+#define SBTREE_DELTA_KEYS			8		/* Leaves store 4 and 8 byte integer keys as first key plus bit-packed deltas (frame of reference). Leaves are filled until full. */
+#define SBTREE_PREFIX_KEYS			16		/* Interior nodes store shortest separators without prefix common to node for keys over 8 bytes. Keys must order as unsigned byte strings. */
+
+/* Largest key size in bytes (keys are copied into buffers of this size by flush and open) */
+#define SBTREE_MAX_KEY_SIZE			32
+
+/* Pages 0 and 1 hold alternating superblocks when checkpoints are used */
+#define SBTREE_SUPERBLOCK_PAGES		2
+
+/* Checkpoint configuration. Intervals are checked each time a leaf is written. sbtreeSync() always writes a checkpoint. */
+typedef struct {
+	id_t	maxPages;							/* Checkpoint when this many pages were written since last checkpoint. 0 to disable. */
+	uint32_t maxTime;							/* Checkpoint when this much time (getTime() units) passed since last checkpoint. 0 to disable. */
+	uint32_t (*getTime)(void);					/* Returns current time (e.g. milliseconds). NULL if not checkpointing by time. */
+	uint32_t sequence;							/* Sequence number of last superblock written (set by init() and open()) */
+	id_t	lastPageId;							/* Next page id when last checkpoint was written */
+	uint32_t lastTime;							/* Time when last checkpoint was written */
+	id_t	numCheckpoints;						/* Number of checkpoints written (statistics) */
+	id_t	numRelinked;						/* Number of leaves written after last checkpoint that were re-linked by open() (statistics) */
+} sbtreeCheckpoint;
+
+/* Record data with variable-length values (sbtreePutVar()): 2 byte value length, then value if it fits in rest of data
+   (inline) or 4 byte offset of value in value log. Data size must be at least SBTREE_VALUE_REF_SIZE for values in log. */
+#define SBTREE_VALUE_LENGTH_SIZE	2
+#define SBTREE_VALUE_REF_SIZE		6
+
+/* Value log for variable-length values. Values are appended to log pages in a separate storage. Each log page has
+   a page header (id and number of bytes used) followed by value bytes. Values may span pages. */
+typedef struct {
+	storageState *storage;						/* Initialized storage for log pages (not the storage of the tree) */
+	void	*buffer;							/* Pre-allocated memory for 2 pages (page being appended and last page read) */
+	uint32_t end;								/* Offset of end of log (set by init() and open()) */
+	id_t	readPageId;							/* Log page in read page */
+	id_t	numReads;							/* Number of log pages read (statistics) */
+	id_t	numWrites;							/* Number of log pages written (statistics) */
+} sbtreeValueLog;
+
+/* Source of records for sbtreeBulkLoad(). Reader implementations embed this struct as their first member. */
+struct sbtreeReader;
+typedef struct sbtreeReader sbtreeReader;
+struct sbtreeReader {
+	int32_t (*read)(sbtreeReader *reader, void **records);	/* Sets records to next block of records in key order (key then data, recordSize bytes each). Returns number of records, 0 at end, -1 if error. */
+	void	*pages;								/* Pre-allocated memory for numPages pages. Leaves are built from records here and written numPages at a time. */
+	id_t	numPages;							/* Number of pages in batch (at least 1) */
+};
+
+/* Leaf read-ahead for iterators. When iterator moves to next leaf, following leaves with adjacent physical page ids
+   (leaves are usually written in sequence) are read with the leaf in one storage request into frames outside the buffer. */
+typedef struct {
+	void	*pages;								/* Pre-allocated memory for numPages pages (shared by iterators) */
+	id_t	numPages;							/* Maximum number of leaves read with one request */
+	id_t	firstPage;							/* Physical page id of first page in frames */
+	id_t	count;								/* Number of pages in frames (0 if empty) */
+	id_t	writeId;							/* Next page write id when frames were read. Frames are not used after pages are written. */
+	id_t	numRequests;						/* Number of read-ahead requests (statistics) */
+	id_t	numReads;							/* Number of pages read by read-ahead requests (statistics) */
+} sbtreeReadAhead;
+
+/* Aggregates over an integer column of record data (sbtreeAggregate()). Interior nodes store a summary of each child
+   (record count, smallest and largest key and minimum, maximum and sum of column) after child pointers, which lowers
+   interior fanout. Not used with SBTREE_PREFIX_KEYS. */
+typedef struct {
+	uint8_t	offset;								/* Offset of column in record data */
+	uint8_t	size;								/* Size of column in bytes (signed little-endian integer of 1, 2, 4 or 8 bytes) */
+	uint8_t	summarySize;						/* Size of child summary in interior nodes (calculated during init()) */
+} sbtreeAggregateColumn;
+
+/* Bitmap of data values for iterator filters (sbtreeIterator minData and maxData). Range [minValue, maxValue] of an
+   integer column is split into bitmapSize*8 equal buckets (values outside range are in first or last bucket). Leaf header
+   has bitmap of buckets of its records. Interior nodes store bitmap of each child (OR of bitmaps below) after child
+   pointers, so iterators skip subtrees and leaves without values in filter range. Not used with SBTREE_PREFIX_KEYS. */
+typedef struct {
+	uint8_t	offset;								/* Offset of column in record data */
+	uint8_t	size;								/* Size of column in bytes (signed little-endian integer of 1, 2, 4 or 8 bytes) */
+	uint8_t	bitmapSize;							/* Size of bitmap in bytes (1 to 8) */
+	int64_t	minValue;							/* Smallest value of first bucket */
+	int64_t	maxValue;							/* Largest value of last bucket */
+} sbtreeBitmap;
+
+/* Bloom filter of keys of each leaf for point lookups (sbtreeGet()). Filters are in memory indexed by leaf page id and are
+   set when the leaf is written, so looking up a key that is not in the leaf returns not found without reading the leaf.
+   Filter is split into 64-bit blocks and all bits of a key are in one block. Filters are not stored: after open() they are
+   unknown (all bits set) until sbtreeGet() reads the leaf and does not find the key. */
+typedef struct {
+	void	*filters;							/* Pre-allocated memory for maxPages filters of filterSize bytes */
+	id_t	maxPages;							/* Number of page ids with a filter. Leaves with larger page ids are always read. */
+	uint16_t filterSize;						/* Size of filter of a leaf in bytes (multiple of 8). Bits per key is filterSize*8 / maxRecordsPerPage. */
+	uint8_t	numHashes;							/* Number of bits set for a key (calculated during init()) */
+	id_t	numSkipped;							/* Number of lookups that did not read leaf (statistics) */
+	id_t	numFalsePositives;					/* Number of lookups that read leaf and did not find key (statistics) */
+} sbtreeBloomFilter;
+
+/* Summary of records returned by sbtreeAggregate() */
+typedef struct {
+	uint32_t count;								/* Number of records */
+	int64_t	sum;								/* Sum of column values */
+	int64_t	min;								/* Minimum column value (if count > 0) */
+	int64_t	max;								/* Maximum column value (if count > 0) */
+	int64_t	minKey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];	/* Smallest key (if count > 0) */
+	int64_t	maxKey[SBTREE_MAX_KEY_SIZE/sizeof(int64_t)];	/* Largest key (if count > 0) */
+	uint64_t bitmap;							/* Bitmap of buckets of values (if bitmap used) */
+} sbtreeSummary;
+
 typedef struct {			
-	uint8_t keySize;							/* Size of key in bytes (fixed-size records) */
+	uint8_t keySize;							/* Size of key in bytes (fixed-size records, at most SBTREE_MAX_KEY_SIZE) */
 	uint8_t dataSize;							/* Size of data in bytes (fixed-size records) */
 	uint8_t recordSize;							/* Size of record in bytes (fixed-size records) */
 	uint8_t headerSize;							/* Size of header in bytes (calculated during init()) */
 	id_t 	nextPageId;							/* Next logical page id. Page id is an incrementing value and may not always be same as physical page id. */
 	count_t maxRecordsPerPage;					/* Maximum records per page */
 	count_t maxInteriorRecordsPerPage;			/* Maximum interior records per page */
-	uint8_t bmOffset;							/* Offset of bitmap in header from start of block */
-    int8_t (*compareKey)(void *a, void *b);		/* Function that compares two arbitrary keys passed as parameters */	
+	uint8_t bmOffset;							/* Offset of bitmap in header from start of block (calculated during init()) */
+    int8_t (*compareKey)(void *a, void *b);		/* Function that compares two arbitrary keys passed as parameters. Set after init() to override integer comparison (also set searchKeys to NULL). */	
 	uint8_t levels;								/* Number of levels in tree */
 	id_t 	activePath[MAX_LEVEL];				/* Active path of page indexes from root (in position 0) to node just above leaf */
 	id_t 	nextPageWriteId;					/* Physical page id of next page to write. */
@@ -93,6 +206,16 @@ typedef struct {
 	dbbuffer *buffer;							/* Pre-allocated memory buffer for use by algorithm */
 	void	*writeBuffer;						/* Pointer to in-memory write buffer */
 	id_t	numNodes;							/* Number of nodes in tree */
+	keySearchFunc searchKeys;					/* Node key search for integer keys (selected during init()). NULL uses binary search with compareKey. */
+	uint8_t	parameters;							/* Configuration options (SBTREE_USE_* bit flags) */
+	id_t	numProbes;							/* Number of keys examined by binary and interpolation node search (statistics) */
+	splineState *spline;						/* Optional spline predicting leaf page for 4 and 8 byte integer keys. Pre-allocated. NULL if not used. */
+	sbtreeCheckpoint *checkpoint;				/* Optional superblock checkpoints for crash recovery. Pre-allocated. NULL if not used. */
+	sbtreeValueLog *valueLog;					/* Optional value log for values that do not fit in record data. Pre-allocated. NULL if not used. */
+	sbtreeReadAhead *readAhead;					/* Optional leaf read-ahead for iterators. Pre-allocated. NULL if not used. */
+	sbtreeAggregateColumn *aggregate;			/* Optional child summaries in interior nodes for sbtreeAggregate(). Pre-allocated. NULL if not used. */
+	sbtreeBitmap *bitmap;						/* Optional bitmaps of data values for iterator filters. Pre-allocated. NULL if not used. */
+	sbtreeBloomFilter *bloomFilter;				/* Optional leaf Bloom filters for lookups of keys not in tree. Pre-allocated. NULL if not used. */
 } sbtreeState;
 
 typedef struct {
@@ -100,7 +223,12 @@ typedef struct {
 	count_t lastIterRec[MAX_LEVEL];				/* Last record processed by iterator at each level */
 	void*	minKey;								/* Minimum search key (inclusive) */
 	void*	maxKey;    							/* Maximum search key (inclusive) */
+	void*	minData;							/* Minimum bitmap column value (inclusive). Used only with state bitmap. NULL for no minimum. */
+	void*	maxData;							/* Maximum bitmap column value (inclusive). Used only with state bitmap. NULL for no maximum. */
 	void*   currentBuffer;						/* Current buffer used by iterator */
+	int64_t	key;								/* Key of current record decoded from leaf with SBTREE_DELTA_KEYS */
+	int8_t	activeLevels;						/* Number of levels from root where iterator path is tree active path (nodes move when written) */
+	id_t	numNodes;							/* Number of nodes in tree when path was read. Path is reused by seek if no nodes added since. */
 } sbtreeIterator;
 
 /**
@@ -110,6 +238,17 @@ typedef struct {
 */
 void sbtreeInit(sbtreeState *state);
 
+/**
+@brief     	Opens an SBTree structure previously written to storage and synced with sbtreeSync().
+			Storage must be opened without truncating (e.g. fileStorageOpen()).
+			Records inserted after the last sync may not be recovered. Spline is disabled.
+			If checkpoint is used, tree is recovered from the last superblock and leaves written after it are re-linked.
+@param     	state
+                SBTree algorithm state structure
+@return		Return 0 if success. Non-zero value if storage does not contain a tree.
+*/
+int8_t sbtreeOpen(sbtreeState *state);
+
 /**
 @brief     	Puts a given key, data pair into structure.
 @param     	state
@@ -122,10 +261,61 @@ void sbtreeInit(sbtreeState *state);
 */
 int8_t sbtreePut(sbtreeState *state, void* key, void *data);
 
+/**
+@brief     	Puts all records of reader into structure. Records must be in key order after any records already
+			inserted. Leaves are filled with runs of records copied from blocks of reader and written reader->numPages
+			pages at a time with one storage request (if storage supports writePages). Interior nodes are built
+			as leaves are written. Last leaf is kept in output buffer so puts can continue after bulk load.
+@param     	state
+                SBTree algorithm state structure
+@param     	reader
+                Reader providing blocks of records
+@return		Return 0 if success. Non-zero value if error.
+*/
+int8_t sbtreeBulkLoad(sbtreeState *state, sbtreeReader *reader);
+
+/**
+@brief     	Puts a key and variable-length value into structure. Value is stored in record data if it fits
+			after its length and is appended to value log otherwise. Use sbtreeValueLength() and sbtreeReadValue()
+			on data returned by sbtreeGet() or sbtreeNext() to read value. Do not mix with sbtreePut() in one tree.
+@param     	state
+                SBTree algorithm state structure
+@param     	key
+                Key for record
+@param     	value
+                Value for record
+@param     	length
+                Length of value in bytes
+@return		Return 0 if success. Non-zero value if error (value does not fit in data and no value log).
+*/
+int8_t sbtreePutVar(sbtreeState *state, void* key, void *value, uint16_t length);
+
+/**
+@brief     	Returns length of variable-length value in record data.
+@param     	state
+                SBTree algorithm state structure
+@param     	data
+                Record data written by sbtreePutVar()
+*/
+uint16_t sbtreeValueLength(sbtreeState *state, void *data);
+
+/**
+@brief     	Copies variable-length value of record data. Values in value log are read only when requested.
+@param     	state
+                SBTree algorithm state structure
+@param     	data
+                Record data written by sbtreePutVar()
+@param     	value
+                Pre-allocated memory for sbtreeValueLength() bytes
+@return		Return 0 if success. Non-zero value if error (value is not in log, e.g. log not flushed before crash).
+*/
+int8_t sbtreeReadValue(sbtreeState *state, void *data, void *value);
+
 /**
 @brief     	Given a key, returns data associated with key.
 			Note: Space for data must be already allocated.
 			Data is copied from database into data buffer.
+			With leaf Bloom filters, leaf is not read if key is not in its filter (not used for leaf predicted by spline).
 @param     	state
                 SBTree algorithm state structure
 @param     	key
@@ -136,6 +326,60 @@ int8_t sbtreePut(sbtreeState *state, void* key, void *data);
 */
 int8_t sbtreeGet(sbtreeState *state, void* key, void *data);
 
+/**
+@brief     	Given an array of keys, returns data associated with each key.
+			Keys are sorted in place (unless already sorted) and results are in sorted key order.
+			Each node on the path to the keys is searched once for all keys routed through it.
+@param     	state
+                SBTree algorithm state structure
+@param     	keys
+                Array of n keys (sorted on return)
+@param     	n
+                Number of keys
+@param     	outData
+                Pre-allocated memory for n data values. Data for keys[i] is copied to outData + i*dataSize.
+@param     	outFound
+                Pre-allocated array of n flags. outFound[i] is 1 if keys[i] was found and 0 otherwise.
+@return		Return 0 if success. Non-zero value if error.
+*/
+int8_t sbtreeGetBatch(sbtreeState *state, void *keys, uint32_t n, void *outData, int8_t *outFound);
+
+/**
+@brief     	Given a key, searches the node for the key.
+			If interior node, returns child record number containing next page id to follow.
+			If leaf node, returns if of first record with that key or (<= key).
+			Returns -1 if key is not found.
+@param     	state
+                SBTree algorithm state structure
+@param     	buffer
+                Pointer to in-memory buffer holding node
+@param     	key
+                Key for record
+@param		pageId
+				Page if for page being searched
+@param		range
+				1 if range query so return pointer to first record <= key, 0 if exact query so much return first exact match record
+*/
+id_t sbtreeSearchNode(sbtreeState *state, void *buffer, void* key, id_t pageId, int8_t range);
+
+/**
+@brief     	Given a child link, returns the proper physical page id.
+			This method handles the mapping of the active path where the pointer in the
+			node is not actually pointing to the most up to date block.
+@param     	state
+                SBTree algorithm state structure
+@param		buf
+				Buffer containing node
+@param     	pageId
+                Page id for node
+@param     	level
+                Level of node in tree
+@param		childNum
+				Child pointer index
+@return		Return pageId if success or -1 if not valid.
+*/
+id_t getChildPageId(sbtreeState *state, void *buf, id_t pageId, int8_t level, id_t childNum);
+
 /**
 @brief     	Initialize iterator on SBTree structure.
 @param     	state
@@ -145,6 +389,19 @@ int8_t sbtreeGet(sbtreeState *state, void* key, void *data);
 */
 void sbtreeInitIterator(sbtreeState *state, sbtreeIterator *it);
 
+/**
+@brief     	Moves iterator to first record with key >= key without starting from the root. If key is in current leaf,
+			no nodes are read. Otherwise iterator path is climbed only as far as needed. Filters minKey and maxKey
+			still apply (e.g. update them for the next window of a sliding window query before seeking).
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure initialized by sbtreeInitIterator()
+@param     	key
+                Search key
+*/
+void sbtreeIteratorSeek(sbtreeState *state, sbtreeIterator *it, void *key);
+
 /**
 @brief     	Requests next key, data pair from iterator.
 @param     	state
@@ -158,6 +415,49 @@ void sbtreeInitIterator(sbtreeState *state, sbtreeIterator *it);
 */
 int8_t sbtreeNext(sbtreeState *state, sbtreeIterator *it, void **key, void **data);
 
+/**
+@brief     	Initialize iterator that returns records in descending key order (e.g. latest readings first).
+			Iterator starts at last record <= maxKey (last record inserted if maxKey is NULL) and ends
+			before minKey (first record if minKey is NULL). Records in output buffer that were not yet
+			written to storage are returned first. Do not insert records while iterating.
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+*/
+void sbtreeInitReverseIterator(sbtreeState *state, sbtreeIterator *it);
+
+/**
+@brief     	Requests previous key, data pair from iterator initialized by sbtreeInitReverseIterator().
+@param     	state
+                SBTree algorithm state structure
+@param     	it
+                SBTree iterator state structure
+@param     	key
+                Key for record (pointer returned)
+@param     	data
+                Data for record (pointer returned)
+@return		Return 1 if record returned. 0 if no more records.
+*/
+int8_t sbtreePrev(sbtreeState *state, sbtreeIterator *it, void **key, void **data);
+
+/**
+@brief     	Computes record count, smallest and largest key and minimum, maximum and sum of aggregate column
+			for records with key in range (including records in output buffer). Children inside the range are
+			taken from summaries in interior nodes, so only nodes and leaves at the range boundaries are read.
+@param     	state
+                SBTree algorithm state structure
+@param     	minKey
+                Minimum key (inclusive). NULL for no minimum.
+@param     	maxKey
+                Maximum key (inclusive). NULL for no maximum.
+@param     	out
+                Summary of records in range
+@return		Return 0 if success. Non-zero value if error (or aggregates not used).
+*/
+int8_t sbtreeAggregate(sbtreeState *state, void *minKey, void *maxKey, sbtreeSummary *out);
+
+
 /**
 @brief     	Flushes output buffer.
 @param     	state
@@ -165,6 +465,15 @@ int8_t sbtreeNext(sbtreeState *state, sbtreeIterator *it, void **key, void **dat
 */
 int8_t sbtreeFlush(sbtreeState *state);
 
+/**
+@brief     	Writes records in output buffer and active path nodes to storage so tree can be reopened
+			with sbtreeOpen(). Writes a superblock if checkpoint is used.
+@param     	state
+                SBTree algorithm state structure
+@return		Return 0 if success. Non-zero value if error.
+*/
+int8_t sbtreeSync(sbtreeState *state);
+
 /**
 @brief     	Prints SBTree structure to standard output.
 @param     	state
@@ -172,4 +481,8 @@ int8_t sbtreeFlush(sbtreeState *state);
 */
 void sbtreePrint(sbtreeState *state);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,330 @@
+/******************************************************************************/
+/**
+@file		sbtree.hpp
+@author		Ramon Lawrence
+@brief		Header-only C++ front-end for SBTree with compile-time record layout and inlined key comparison.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef SBTREE_HPP
+#define SBTREE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <type_traits>
+
+#include "sbtree.h"
+
+/*
+Typed SBTree using the same page format as sbtree.c.
+Inserts, index updates, buffering and iterator navigation use the C implementation.
+Node search for get() and range() uses record offsets and fanout computed at compile time
+and calls Compare inline instead of through the compareKey function pointer.
+All memory (buffer pages and buffer state) is part of the object. No dynamic memory is used.
+*/
+template <typename Key, typename Value, count_t PageSize, count_t NumPages = 3, typename Compare = std::less<Key> >
+class SBTree
+{
+	static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value, "Key and Value must be trivially copyable");
+	static_assert(sizeof(Key) + sizeof(Value) < 256, "Record size must fit in uint8_t");
+	static_assert(sizeof(Key) <= SBTREE_MAX_KEY_SIZE, "Key size must be at most SBTREE_MAX_KEY_SIZE");
+	static_assert(NumPages >= 2, "Buffer requires at least 2 pages");
+
+public:
+	static constexpr uint8_t	headerSize = 6;
+	static constexpr uint8_t	keySize = sizeof(Key);
+	static constexpr uint8_t	dataSize = sizeof(Value);
+	static constexpr uint8_t	recordSize = sizeof(Key) + sizeof(Value);
+	static constexpr count_t	maxRecordsPerPage = (PageSize - headerSize) / recordSize;
+	static constexpr count_t	maxInteriorRecordsPerPage = (PageSize - headerSize - sizeof(id_t)) / (sizeof(Key) + sizeof(id_t));
+
+	static_assert(maxRecordsPerPage >= 1 && maxInteriorRecordsPerPage >= 2, "Page size too small for record");
+
+	/**
+	@brief     	Creates tree. Call init() or open() before use.
+	@param     	storage
+					Initialized storage for pages
+	@param     	checkpoint
+					Optional superblock checkpoint configuration (see sbtreeCheckpoint). NULL if not used.
+	*/
+	explicit SBTree(storageState *storage, sbtreeCheckpoint *checkpoint = NULL)
+	{
+		buffer.storage = storage;
+		this->checkpoint = checkpoint;
+	}
+
+	/**
+	@brief     	Initializes buffer and tree. Writes empty root.
+	@return		Return 0 if success. Non-zero value if error.
+	*/
+	int8_t init()
+	{
+		setup();
+		sbtreeInit(&state);
+		return finishSetup();
+	}
+
+	/**
+	@brief     	Opens tree previously synced to storage. Storage must be opened without truncating.
+	@return		Return 0 if success. Non-zero value if error.
+	*/
+	int8_t open()
+	{
+		setup();
+		if (sbtreeOpen(&state) != 0)
+			return -1;
+		return finishSetup();
+	}
+
+	/**
+	@brief     	Puts a given key, data pair into structure. Keys must be inserted in sorted order.
+	@return		Return 0 if success. Non-zero value if error.
+	*/
+	int8_t put(const Key &key, const Value &value)
+	{
+		Key k = key;
+		Value v = value;
+		return sbtreePut(&state, &k, &v);
+	}
+
+	/**
+	@brief     	Given a key, copies associated value.
+	@return		Return 0 if success. Non-zero value if not found or error.
+	*/
+	int8_t get(const Key &key, Value &value)
+	{
+		id_t nextId = state.activePath[0];
+		uint8_t *buf;
+
+		for (int8_t l=0; l < state.levels; l++)
+		{
+			buf = (uint8_t*) readPage(&buffer, nextId);
+			if (buf == NULL)
+				return -1;
+			dbbufferPin(&buffer, buf, l);
+
+			nextId = getChildPageId(&state, buf, nextId, l, searchInterior(buf, key));
+			if (nextId == (id_t) -1)
+				return -1;
+		}
+
+		buf = (uint8_t*) readPage(&buffer, nextId);
+		if (buf == NULL)
+			return -1;
+
+		count_t count = getCount(buf);
+		count_t i = lowerBound(buf + headerSize, count, key);
+		if (i >= count || !equal(keyAt(buf + headerSize + i*recordSize), key))
+			return -1;
+		memcpy(&value, buf + headerSize + i*recordSize + keySize, dataSize);
+		return 0;
+	}
+
+	/**
+	@brief     	Calls func(key, value) for each record with minKey <= key <= maxKey in key order.
+	@return		Number of records processed
+	*/
+	template <typename Func>
+	uint32_t range(const Key &minKey, const Key &maxKey, Func func)
+	{
+		sbtreeIterator it;
+		Key min = minKey, key;
+		Value value;
+		void *k, *d;
+		uint32_t num = 0;
+
+		/* Iterator positions using minKey. Key filtering is done inline here. */
+		it.minKey = &min;
+		it.maxKey = NULL;
+		it.minData = NULL;
+		it.maxData = NULL;
+		sbtreeInitIterator(&state, &it);
+		it.minKey = NULL;
+
+		while (sbtreeNext(&state, &it, &k, &d))
+		{
+			key = keyAt((uint8_t*) k);
+			if (Compare()(key, minKey))
+				continue;
+			if (Compare()(maxKey, key))
+				break;
+			memcpy(&value, d, dataSize);
+			func(key, value);
+			num++;
+		}
+		return num;
+	}
+
+	/**
+	@brief     	Flushes output buffer.
+	@return		Return 0 if success. Non-zero value if error.
+	*/
+	int8_t flush()
+	{
+		return sbtreeFlush(&state);
+	}
+
+	/**
+	@brief     	Writes output buffer and active path to storage so tree can be reopened with open().
+	@return		Return 0 if success. Non-zero value if error.
+	*/
+	int8_t sync()
+	{
+		return sbtreeSync(&state);
+	}
+
+	/**
+	@brief     	Returns C state structure (e.g. for statistics or iterators).
+	*/
+	sbtreeState* getState()
+	{
+		return &state;
+	}
+
+private:
+	/**
+	@brief     	Sets buffer and tree parameters before init or open.
+	*/
+	void setup()
+	{
+		buffer.pageSize = PageSize;
+		buffer.numPages = NumPages;
+		buffer.status = status;
+		buffer.modified = modified;
+		buffer.buffer = pages;
+		buffer.hashTable = NULL;
+		buffer.policy = NULL;
+		buffer.policyData = NULL;
+		buffer.pinLevel = pinLevel;
+
+		state.keySize = keySize;
+		state.dataSize = dataSize;
+		state.parameters = 0;
+		state.spline = NULL;
+		state.checkpoint = checkpoint;
+		state.valueLog = NULL;
+		state.readAhead = NULL;
+		state.aggregate = NULL;
+		state.bitmap = NULL;
+		state.bloomFilter = NULL;
+		state.buffer = &buffer;
+		state.tempKey = &tempKey;
+	}
+
+	/**
+	@brief     	Sets comparison after init or open and checks page layout.
+	@return		Return 0 if success. Non-zero value if page format does not match compile-time layout.
+	*/
+	int8_t finishSetup()
+	{
+		/* C code uses same comparison as template */
+		state.compareKey = compareKey;
+		state.searchKeys = NULL;
+
+		if (state.headerSize != headerSize || state.maxRecordsPerPage != maxRecordsPerPage || state.maxInteriorRecordsPerPage != maxInteriorRecordsPerPage)
+			return -1;	/* Page format does not match compile-time layout */
+		return 0;
+	}
+
+	sbtreeState	state;
+	dbbuffer	buffer;
+	sbtreeCheckpoint *checkpoint;
+	Key			tempKey;
+	id_t		status[NumPages];
+	uint8_t		modified[NumPages];
+	uint8_t		pinLevel[NumPages];
+	uint8_t		pages[(size_t) NumPages * PageSize];
+
+	static Key keyAt(const uint8_t *p)
+	{
+		Key k;
+		memcpy(&k, p, sizeof(Key));
+		return k;
+	}
+
+	static bool equal(const Key &a, const Key &b)
+	{
+		return !Compare()(a, b) && !Compare()(b, a);
+	}
+
+	static count_t getCount(const uint8_t *buf)
+	{
+		count_t count;
+		memcpy(&count, buf + sizeof(id_t), sizeof(count_t));
+		return count % 10000;
+	}
+
+	/* Number of records with key < search key. Branchless binary search with compile-time record stride. */
+	static count_t lowerBound(const uint8_t *recs, count_t count, const Key &key)
+	{
+		if (count == 0)
+			return 0;
+		count_t base = 0, len = count, half;
+		while (len > 1)
+		{
+			half = len / 2;
+			base = Compare()(keyAt(recs + (base+half)*recordSize), key) ? base + half : base;
+			len -= half;
+		}
+		return base + Compare()(keyAt(recs + base*recordSize), key);
+	}
+
+	/* Child index to follow in interior node: number of separator keys <= search key */
+	static count_t searchInterior(const uint8_t *buf, const Key &key)
+	{
+		count_t count = getCount(buf);
+		if (count > maxInteriorRecordsPerPage)
+			count = maxInteriorRecordsPerPage;
+		if (count == 0)
+			return 0;
+
+		const uint8_t *keys = buf + headerSize;
+		count_t base = 0, len = count, half;
+		while (len > 1)
+		{
+			half = len / 2;
+			base = Compare()(key, keyAt(keys + (base+half)*keySize)) ? base : base + half;
+			len -= half;
+		}
+		return base + !Compare()(key, keyAt(keys + base*keySize));
+	}
+
+	/* Comparison for C code (iterator positioning) */
+	static int8_t compareKey(void *a, void *b)
+	{
+		Key x = keyAt((uint8_t*) a), y = keyAt((uint8_t*) b);
+		if (Compare()(x, y)) return -1;
+		if (Compare()(y, x)) return 1;
+		return 0;
+	}
+};
+
+#endif
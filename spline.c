@@ -0,0 +1,169 @@
+/******************************************************************************/
+/**
+@file		spline.c
+@author		Ramon Lawrence
+@brief		Piecewise linear spline mapping keys to page ids.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#include <stdint.h>
+
+#include "spline.h"
+
+/**
+@brief     	Initializes spline. Set points, maxPoints and maxError before calling.
+@param     	state
+                Spline state structure
+*/
+void splineInit(splineState *state)
+{
+	state->count = 0;
+	state->full = 0;
+	state->lower = 0;
+	state->upper = 0;
+}
+
+/**
+@brief     	Adds point to spline. Keys must be added in increasing order.
+			Uses greedy spline corridor: a new spline point is created only when
+			the point cannot be predicted within maxError by the current segment.
+@param     	state
+                Spline state structure
+@param     	key
+                Key
+@param     	page
+                Page id for key
+*/
+void splineAdd(splineState *state, int64_t key, uint32_t page)
+{
+	splinePoint *knot;
+	double dx, lower, upper, slope;
+
+	if (state->count == 0)
+	{	/* First point is always a spline point */
+		if (state->maxPoints == 0)
+			return;
+		state->points[0].key = key;
+		state->points[0].page = page;
+		state->last = state->points[0];
+		state->count = 1;
+		return;
+	}
+
+	/* Duplicate keys keep the first page with the key */
+	if (state->full || key <= state->last.key)
+		return;
+
+	knot = &state->points[state->count-1];
+	if (state->last.key != knot->key)
+	{	/* Point must be within corridor of current segment. Otherwise, start new segment at last point. */
+		slope = ((double) page - knot->page) / ((double) key - knot->key);
+		if (slope < state->lower || slope > state->upper)
+		{
+			if (state->count == state->maxPoints)
+			{	/* Budget used. Keys after last point are not predicted within error. */
+				state->full = 1;
+				return;
+			}
+			state->points[state->count++] = state->last;
+			knot = &state->points[state->count-1];
+		}
+	}
+
+	/* Narrow corridor so that this point stays within error */
+	dx = (double) key - knot->key;
+	upper = ((double) page + state->maxError - knot->page) / dx;
+	lower = ((double) page - state->maxError - knot->page) / dx;
+	if (state->last.key == knot->key)
+	{	/* First point after spline point */
+		state->upper = upper;
+		state->lower = lower;
+	}
+	else
+	{
+		if (upper < state->upper)
+			state->upper = upper;
+		if (lower > state->lower)
+			state->lower = lower;
+	}
+	state->last.key = key;
+	state->last.page = page;
+}
+
+/**
+@brief     	Predicts page id for key. Added keys are predicted within maxError pages.
+			Other keys are predicted between the predictions for the added keys before and after them.
+@param     	state
+                Spline state structure
+@param     	key
+                Search key
+@param     	page
+                Predicted page id (returned)
+@return		Return 0 if success. Non-zero value if spline is empty or key is after the last point and no more points can be added.
+*/
+int8_t splinePredict(splineState *state, int64_t key, uint32_t *page)
+{
+	uint32_t first, last, mid;
+	splinePoint *start, *end;
+
+	if (state->count == 0)
+		return -1;
+
+	if (key <= state->points[0].key)
+	{
+		*page = state->points[0].page;
+		return 0;
+	}
+	if (key >= state->last.key)
+	{	/* Later keys were not added when budget was used */
+		if (state->full && key > state->last.key)
+			return -1;
+		*page = state->last.page;
+		return 0;
+	}
+
+	/* Binary search for last spline point with key <= search key */
+	first = 0;
+	last = state->count-1;
+	while (first < last)
+	{
+		mid = (first + last + 1) / 2;
+		if (state->points[mid].key <= key)
+			first = mid;
+		else
+			last = mid - 1;
+	}
+
+	/* Interpolate on segment. Last segment ends at last point added. Truncating predicts the page of the closest added key <= search key on exact segments. */
+	start = &state->points[first];
+	end = first+1 < state->count ? &state->points[first+1] : &state->last;
+	*page = start->page + (uint32_t) (((double) key - start->key) * (end->page - start->page) / ((double) end->key - start->key));
+	return 0;
+}
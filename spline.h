@@ -0,0 +1,98 @@
+/******************************************************************************/
+/**
+@file		spline.h
+@author		Ramon Lawrence
+@brief		Piecewise linear spline mapping keys to page ids.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef SPLINE_H
+#define SPLINE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	int64_t		key;							/* Key */
+	uint32_t	page;							/* Page id */
+} splinePoint;
+
+typedef struct {
+	splinePoint	*points;						/* Pre-allocated array of spline points (memory budget is maxPoints * sizeof(splinePoint)) */
+	uint32_t	maxPoints;						/* Maximum number of spline points */
+	uint32_t	maxError;						/* Maximum error (in pages) of prediction for added points */
+	uint32_t	count;							/* Number of spline points */
+	splinePoint	last;							/* Last point added. End of last spline segment. */
+	double		lower;							/* Minimum slope from last spline point that keeps added points within error */
+	double		upper;							/* Maximum slope from last spline point that keeps added points within error */
+	int8_t		full;							/* 1 if spline point budget is used. No more points are added. */
+} splineState;
+
+/**
+@brief     	Initializes spline. Set points, maxPoints and maxError before calling.
+@param     	state
+                Spline state structure
+*/
+void splineInit(splineState *state);
+
+/**
+@brief     	Adds point to spline. Keys must be added in increasing order.
+			Uses greedy spline corridor: a new spline point is created only when
+			the point cannot be predicted within maxError by the current segment.
+@param     	state
+                Spline state structure
+@param     	key
+                Key
+@param     	page
+                Page id for key
+*/
+void splineAdd(splineState *state, int64_t key, uint32_t page);
+
+/**
+@brief     	Predicts page id for key. Added keys are predicted within maxError pages.
+			Other keys are predicted between the predictions for the added keys before and after them.
+@param     	state
+                Spline state structure
+@param     	key
+                Search key
+@param     	page
+                Predicted page id (returned)
+@return		Return 0 if success. Non-zero value if spline is empty or key is after the last point and no more points can be added.
+*/
+int8_t splinePredict(splineState *state, int64_t key, uint32_t *page);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
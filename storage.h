@@ -38,6 +38,10 @@
 
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* Define type for page ids (physical and logical). */
 typedef uint32_t id_t;
 
@@ -54,6 +58,14 @@ struct storageState
 	int8_t 	(*writePage)(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);		/* Write a page to storage */	
 	void	(*flush)(storageState *storage);														/* Flush storage (ensure all updates are written) */
 	void	(*close)(storageState *storage);														/* Close storage */
+	int8_t 	(*prefetchPage)(storageState *storage, id_t pageNum, count_t pageSize);					/* Start asynchronous read of page. NULL if not supported. */
+	void*	(*mapPage)(storageState *storage, id_t pageNum, count_t pageSize);						/* Returns read-only pointer to page in storage without copy. NULL if not supported. */
+	int8_t 	(*writePages)(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer);	/* Write count consecutive pages with one request. NULL if not supported. */
+	int8_t 	(*readPages)(storageState *storage, id_t pageNum, id_t count, count_t pageSize, void *buffer);	/* Read count consecutive pages with one request. NULL if not supported. */
 };
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
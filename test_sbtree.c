@@ -38,8 +38,13 @@
 #include <string.h>
 
 #include "sbtree.h"
+#include "dbbufferPolicy.h"
 #include "fileStorage.h"
+#include "fdStorage.h"
+#include "uringStorage.h"
+#include "mmapStorage.h"
 #include "memStorage.h"
+#include "compressStorage.h"
 
 /**
  * Test iterator
@@ -51,6 +56,8 @@ void testIterator(sbtreeState *state)
     it.minKey = &mv;
     uint32_t v = 299;
     it.maxKey = &v;       
+    it.minData = NULL;
+    it.maxData = NULL;
 
     sbtreeInitIterator(state, &it);
     uint32_t i = 0;
@@ -76,6 +83,3250 @@ void testIterator(sbtreeState *state)
     printStats(state->buffer);
 }
 
+/**
+ * Test reverse iterator
+ */
+void testReverseIterator(sbtreeState *state)
+{
+    sbtreeIterator it;
+    uint32_t mv = 40;     
+    it.minKey = &mv;
+    uint32_t v = 299;
+    it.maxKey = &v;       
+    it.minData = NULL;
+    it.maxData = NULL;
+
+    sbtreeInitReverseIterator(state, &it);
+    uint32_t i = 0;
+    uint8_t success = 1;    
+    uint32_t *itKey, *itData;
+
+    while (sbtreePrev(state, &it, (void**) &itKey, (void**) &itData))
+    {                      
+        if (v-i != *itKey)
+        {   success = 0;
+            printf("Key: %lu Error\n", *itKey);
+        }
+        i++;        
+    }
+    printf("Read records: %lu\n", i);
+
+    if (success && i == (v-mv+1))
+        printf("SUCCESS\n");
+    else
+        printf("FAILURE\n");    
+}
+
+/**
+ * Test iterator seek
+ */
+void testIteratorSeek(sbtreeState *state)
+{
+    sbtreeIterator it;
+    uint32_t mv = 40;     
+    it.minKey = &mv;
+    uint32_t v;
+    it.maxKey = &v;       
+    it.minData = NULL;
+    it.maxData = NULL;
+    uint32_t i = 0, n = 0, start;
+    uint32_t starts[] = {40, 45, 115, 240, 120, 900, 905, 500, 41};
+    uint8_t success = 1;    
+    uint32_t *itKey, *itData;
+
+    /* Windows of 10 records moving forward and backward reuse iterator */
+    sbtreeInitIterator(state, &it);
+    for (int8_t w = 0; w < 9; w++)
+    {
+        start = starts[w];
+        v = start + 9;
+        sbtreeIteratorSeek(state, &it, &start);
+        for (i = 0; sbtreeNext(state, &it, (void**) &itKey, (void**) &itData); i++)
+        {
+            if (start+i != *itKey)
+            {   success = 0;
+                printf("Key: %lu Error\n", *itKey);
+            }
+        }
+        if (i != 10)
+            success = 0;
+        n += i;
+    }
+    v = 20;
+    sbtreeIteratorSeek(state, &it, &v);
+    if (sbtreeNext(state, &it, (void**) &itKey, (void**) &itData))
+        success = 0;
+    printf("Read records: %lu\n", n);
+
+    if (success)
+        printf("SUCCESS\n");
+    else
+        printf("FAILURE\n");    
+}
+
+/**
+ * Test aggregate queries against iterator scans. Requires aggregate column at offset 0 of size 4.
+ */
+void testAggregate(sbtreeState *state)
+{
+    sbtreeIterator it;
+    sbtreeSummary summary;
+    uint32_t mins[] = {40, 0, 5000, 9990, 777}, maxs[] = {1039, 20000, 5000, 20000, 776};
+    uint32_t *itKey, *itData, count, first, last;
+    int64_t sum, min, max;
+    uint8_t success = 1;
+
+    if (state->aggregate == NULL || state->aggregate->offset != 0 || state->aggregate->size != sizeof(int32_t))
+    {
+        printf("Aggregate column not configured\n");
+        return;
+    }
+    for (int8_t q = 0; q < 5; q++)
+    {
+        it.minKey = &mins[q];
+        it.maxKey = &maxs[q];
+        it.minData = NULL;
+        it.maxData = NULL;
+        count = 0;
+        sum = 0;
+        sbtreeInitIterator(state, &it);
+        while (sbtreeNext(state, &it, (void**) &itKey, (void**) &itData))
+        {
+            if (count == 0 || *((int32_t*) itData) < min)
+                min = *((int32_t*) itData);
+            if (count == 0 || *((int32_t*) itData) > max)
+                max = *((int32_t*) itData);
+            if (count == 0)
+                first = *itKey;
+            last = *itKey;
+            sum += *((int32_t*) itData);
+            count++;
+        }
+        if (sbtreeAggregate(state, &mins[q], &maxs[q], &summary) != 0 || summary.count != count || (count > 0 && (summary.sum != sum
+            || summary.min != min || summary.max != max || *((uint32_t*) summary.minKey) != first || *((uint32_t*) summary.maxKey) != last)))
+        {   success = 0;
+            printf("Range: %lu-%lu Error\n", mins[q], maxs[q]);
+        }
+        printf("Range: %lu-%lu Count: %lu Sum: %lld\n", mins[q], maxs[q], summary.count, (long long) summary.sum);
+    }
+
+    if (success)
+        printf("SUCCESS\n");
+    else
+        printf("FAILURE\n");    
+}
+
+/**
+ * Test iterator value filters against filtering an unfiltered scan. Requires bitmap column at offset 0 of size 4.
+ */
+void testBitmapFilter(sbtreeState *state)
+{
+    sbtreeIterator it;
+    uint32_t mins[] = {40, 0, 5000, 0}, maxs[] = {1039, 20000, 9000, 20000};
+    int32_t minData[] = {0, 100, 6000, 500}, maxData[] = {1000, 100, 8000, 400};
+    uint32_t *itKey, *itData, count[2], prev;
+    uint64_t keySum[2];
+    uint8_t success = 1;
+
+    if (state->bitmap == NULL || state->bitmap->offset != 0 || state->bitmap->size != sizeof(int32_t))
+    {
+        printf("Bitmap column not configured\n");
+        return;
+    }
+    for (int8_t q = 0; q < 4; q++)
+    {
+        it.minKey = &mins[q];
+        it.maxKey = &maxs[q];
+        /* Scan without filter and with filter */
+        for (int8_t r = 0; r < 2; r++)
+        {
+            it.minData = r == 0 ? NULL : &minData[q];
+            it.maxData = r == 0 ? NULL : &maxData[q];
+            count[r] = 0;
+            keySum[r] = 0;
+            sbtreeInitIterator(state, &it);
+            while (sbtreeNext(state, &it, (void**) &itKey, (void**) &itData))
+            {
+                if (*((int32_t*) itData) < minData[q] || *((int32_t*) itData) > maxData[q])
+                {
+                    if (r == 1)
+                    {   success = 0;
+                        printf("Key: %lu Error\n", *itKey);
+                    }
+                    continue;
+                }
+                if (r == 1 && count[r] > 0 && *itKey <= prev)
+                {   success = 0;
+                    printf("Key: %lu Error\n", *itKey);
+                }
+                prev = *itKey;
+                keySum[r] += *itKey;
+                count[r]++;
+            }
+        }
+        if (count[0] != count[1] || keySum[0] != keySum[1])
+        {   success = 0;
+            printf("Range: %lu-%lu Error\n", mins[q], maxs[q]);
+        }
+        printf("Range: %lu-%lu Values: %ld-%ld Count: %lu\n", mins[q], maxs[q], (long) minData[q], (long) maxData[q], count[1]);
+    }
+
+    if (success)
+        printf("SUCCESS\n");
+    else
+        printf("FAILURE\n");
+}
+
+/**
+ * Benchmarks buffer page lookup (readPage hit) using linear scan and hash table for increasing buffer sizes.
+ */
+void benchmarkBufferLookup()
+{
+    count_t sizes[] = {3, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65535};
+    count_t numSizes = sizeof(sizes)/sizeof(count_t);
+    count_t pageSize = 64;
+    id_t    activePath[MAX_LEVEL];
+
+    printf("\nBUFFER LOOKUP BENCHMARK\n");
+    printf("Pages\tScan (ns/lookup)\tHash (ns/lookup)\n");
+
+    for (count_t s=0; s < numSizes; s++)
+    {
+        count_t M = sizes[s];
+        uint32_t numLookups = 20000000 / M + 100000;
+        double nsPerLookup[2];
+
+        memStorageState *storage = (memStorageState*) malloc(sizeof(memStorageState));
+        storage->size = (uint32_t) M * pageSize;
+        if (memStorageInit((storageState*) storage) != 0)
+        {
+            printf("Error: Cannot initialize storage!\n");
+            return;
+        }
+
+        dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+        buffer->pageSize = pageSize;
+        buffer->numPages = M;
+        buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+        buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+        buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+        buffer->storage = (storageState*) storage;
+        buffer->activePath = activePath;
+        buffer->policy = NULL;
+        buffer->pinLevel = NULL;
+        activePath[0] = 0;
+
+        count_t *hashTable = (count_t*) malloc(sizeof(count_t)*dbbufferHashSize(M));
+
+        for (int8_t useHash = 0; useHash <= 1; useHash++)
+        {
+            buffer->hashTable = useHash ? hashTable : NULL;
+            dbbufferInit(buffer);
+
+            /* Write pages then read them so that every buffer page (except output buffer) is full */
+            id_t numResident = M - 1;
+            for (id_t p=0; p < numResident; p++)
+            {
+                initBufferPage(buffer, 0);
+                writePage(buffer, buffer->buffer);
+            }
+            for (id_t p=0; p < numResident; p++)
+                readPage(buffer, p);
+            dbbufferClearStats(buffer);
+
+            /* Lookup resident pages in pseudo-random order */
+            uint32_t seed = 12345;
+            clock_t start = clock();
+            for (uint32_t i=0; i < numLookups; i++)
+            {
+                seed = seed * 1103515245 + 12345;
+                readPage(buffer, (seed >> 8) % numResident);
+            }
+            clock_t end = clock();
+
+            if (buffer->bufferHits != numLookups)
+                printf("Error: Expected all lookups to hit buffer. Hits: %lu Lookups: %lu\n", buffer->bufferHits, numLookups);
+            nsPerLookup[useHash] = (double) (end-start) * 1e9 / CLOCKS_PER_SEC / numLookups;
+        }
+        printf("%u\t%.1f\t\t\t%.1f\n", M, nsPerLookup[0], nsPerLookup[1]);
+
+        storage->storage.close((storageState*) storage);
+        free(hashTable);
+        free(buffer->buffer);
+        free(buffer->modified);
+        free(buffer->status);
+        free(buffer);
+        free(storage);
+    }
+}
+
+/**
+ * Compares buffer replacement policies on a mixed insert/query workload using uwa500K data set.
+ * After every 10 inserts a random key that has already been indexed is queried.
+ */
+void benchmarkBufferPolicies()
+{
+    const dbbufferPolicy* policies[] = {NULL, &dbbufferClockPolicy, &dbbufferLRU2Policy, &dbbuffer2QPolicy};
+    const char* names[] = {"Round robin", "CLOCK", "LRU-2", "2Q"};
+    count_t sizes[] = {4, 8, 16, 32};
+    int32_t numRecords = 100000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+
+    printf("\nBUFFER POLICY BENCHMARK\n");
+    printf("Policy\t\tPages\tReads\tWrites\tHits\tHit rate\n");
+
+    for (count_t s=0; s < sizeof(sizes)/sizeof(count_t); s++)
+    {
+        for (count_t p=0; p < sizeof(policies)/sizeof(dbbufferPolicy*); p++)
+        {
+            count_t M = sizes[s];
+            fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+            storage->fileName = "myfile.bin";
+            if (fileStorageInit((storageState*) storage) != 0)
+            {
+                printf("Error: Cannot initialize storage!\n");
+                return;
+            }
+
+            dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+            buffer->pageSize = 512;
+            buffer->numPages = M;
+            buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+            buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->hashTable = (count_t*) malloc(sizeof(count_t)*dbbufferHashSize(M));
+            buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+            buffer->storage = (storageState*) storage;
+            buffer->policy = policies[p];
+            buffer->policyData = policies[p] == NULL ? NULL : malloc(policies[p]->dataSize(M));
+            buffer->pinLevel = NULL;
+
+            sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+            state->keySize = 4;
+            state->dataSize = 12;
+            state->parameters = 0;
+            state->spline = NULL;
+            state->checkpoint = NULL;
+            state->valueLog = NULL;
+            state->readAhead = NULL;
+            state->aggregate = NULL;
+            state->bitmap = NULL;
+            state->bloomFilter = NULL;
+            state->buffer = buffer;
+            state->tempKey = malloc(sizeof(int32_t));
+            int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+
+            sbtreeInit(state);
+            dbbufferClearStats(buffer);
+
+            int32_t i = 0;
+            uint32_t seed = 1;
+            fseek(infile, 0, SEEK_SET);
+            while (i < numRecords && fread(infileBuffer, buffer->pageSize, 1, infile) != 0)
+            {
+                int16_t count = *((int16_t*) (infileBuffer+4));
+                for (int j=0; j < count && i < numRecords; j++)
+                {
+                    void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                    sbtreePut(state, buf, (void*) (buf + 4));
+                    keys[i++] = *((uint32_t*) buf);
+
+                    /* Query a key that is already in an indexed leaf (not in output buffer) */
+                    if (i % 10 == 0 && i > 2*state->maxRecordsPerPage)
+                    {
+                        seed = seed * 1103515245 + 12345;
+                        uint32_t key = keys[(seed >> 8) % (i - state->maxRecordsPerPage - 1)];
+                        if (sbtreeGet(state, &key, recordBuffer) != 0)
+                            printf("Error: Failed to find: %lu\n", key);
+                    }
+                }
+            }
+            sbtreeFlush(state);
+
+            printf("%-12s\t%u\t%lu\t%lu\t%lu\t%.3f\n", names[p], M, buffer->numReads, buffer->numWrites, buffer->bufferHits,
+                (double) buffer->bufferHits / (buffer->bufferHits + buffer->numReads));
+
+            closeBuffer(buffer);
+            free(state->tempKey);
+            free(recordBuffer);
+            free(buffer->policyData);
+            free(buffer->hashTable);
+            free(buffer->modified);
+            free(buffer->status);
+            free(buffer->buffer);
+            free(buffer);
+            free(storage);
+            free(state);
+        }
+    }
+    free(keys);
+    fclose(infile);
+}
+
+/**
+ * Benchmarks search within a single leaf and interior node for each key search implementation and page size.
+ */
+void benchmarkNodeSearch()
+{
+    const char* names[] = {"compareKey", "Scalar", "SSE4.2", "AVX2"};
+    uint8_t levels[] = {0, KEY_SEARCH_SCALAR, KEY_SEARCH_SSE42, KEY_SEARCH_AVX2};
+    uint32_t numSearches = 2000000;
+
+    printf("\nNODE SEARCH BENCHMARK (ns/search)\n");
+    printf("Key\tPage\tImpl\t\tLeaf\tInterior\n");
+
+    for (uint8_t keySize = 4; keySize <= 8; keySize += 4)
+    {
+        for (uint32_t pageSize = 512; pageSize <= 32768; pageSize *= 2)
+        {
+            memStorageState *storage = (memStorageState*) malloc(sizeof(memStorageState));
+            storage->size = 2 * pageSize;
+            memStorageInit((storageState*) storage);
+
+            dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+            buffer->pageSize = pageSize;
+            buffer->numPages = 2;
+            buffer->status = (id_t*) malloc(sizeof(id_t)*2);
+            buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*2);
+            buffer->hashTable = NULL;
+            buffer->policy = NULL;
+            buffer->pinLevel = NULL;
+            buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+            buffer->storage = (storageState*) storage;
+
+            sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+            state->keySize = keySize;
+            state->dataSize = 8;
+            state->parameters = 0;
+            state->spline = NULL;
+            state->checkpoint = NULL;
+            state->valueLog = NULL;
+            state->readAhead = NULL;
+            state->aggregate = NULL;
+            state->bitmap = NULL;
+            state->bloomFilter = NULL;
+            state->buffer = buffer;
+            state->tempKey = malloc(keySize);
+            sbtreeInit(state);
+            keySearchFunc best = state->searchKeys;
+
+            /* Full leaf and full interior node with even keys from base. Second pass only checks results for keys crossing 2^31. */
+            void *leaf = calloc(1, pageSize), *interior = calloc(1, pageSize);
+            int64_t key;
+            for (int8_t c=0; c < 2; c++)
+            {
+                int64_t base = c == 0 ? 0 : 0x80000000LL - state->maxRecordsPerPage;
+                for (count_t i=0; i < state->maxRecordsPerPage; i++)
+                {
+                    key = base + 2*i;
+                    memcpy(leaf + state->headerSize + i*state->recordSize, &key, keySize);
+                }
+                SBTREE_SET_COUNT(leaf, state->maxRecordsPerPage);
+                for (count_t i=0; i < state->maxInteriorRecordsPerPage; i++)
+                {
+                    key = base + 2*i;
+                    memcpy(interior + state->headerSize + i*keySize, &key, keySize);
+                }
+                SBTREE_SET_COUNT(interior, state->maxInteriorRecordsPerPage);
+                SBTREE_SET_INTERIOR(interior);
+
+                for (uint8_t impl=0; impl < 4; impl++)
+                {
+                    state->searchKeys = impl == 0 ? NULL : keySearchSelect(keySize, levels[impl]);
+                    if (impl > 0 && state->searchKeys == NULL)
+                        continue;   /* Not supported by CPU */
+
+                    double ns[2];
+                    for (int8_t n=0; n < 2; n++)
+                    {
+                        void *node = n == 0 ? leaf : interior;
+                        count_t max = n == 0 ? state->maxRecordsPerPage : state->maxInteriorRecordsPerPage;
+                        uint32_t seed = 7, errors = 0;
+                        volatile id_t sum = 0;
+
+                        clock_t start = clock();
+                        for (uint32_t i=0; i < (c == 0 ? numSearches : numSearches/20); i++)
+                        {
+                            seed = seed * 1103515245 + 12345;
+                            key = (seed >> 8) % (2*max);
+                            int64_t search = base + key;
+                            id_t result = sbtreeSearchNode(state, node, &search, 0, 0);
+                            sum += result;
+                            if (n == 0 && result != (key % 2 == 0 ? key/2 : (id_t) -1))
+                                errors++;
+                            if (n == 1 && result != (key+2)/2)
+                                errors++;
+                        }
+                        ns[n] = (double) (clock()-start) * 1e9 / CLOCKS_PER_SEC / numSearches;
+                        if (errors > 0)
+                            printf("Error: %s returned %lu incorrect results%s\n", names[impl], errors, c == 0 ? "" : " for keys crossing 2^31");
+                    }
+                    if (c == 0)
+                        printf("%u\t%lu\t%-10s\t%.1f\t%.1f\n", keySize, pageSize, names[impl], ns[0], ns[1]);
+                }
+            }
+            state->searchKeys = best;
+
+            free(leaf);
+            free(interior);
+            closeBuffer(buffer);
+            free(state->tempKey);
+            free(state);
+            free(buffer->buffer);
+            free(buffer->modified);
+            free(buffer->status);
+            free(buffer);
+            free(storage);
+        }
+    }
+}
+
+/**
+ * Compares probes (keys examined) per lookup and query time of binary search and interpolation search
+ * on the uwa500K and sea100K data sets for several page sizes.
+ */
+void benchmarkInterpolationSearch()
+{
+    const char* files[] = {"data/uwa500K.bin", "data/sea100K.bin"};
+    count_t pageSizes[] = {512, 4096, 16384};
+    int32_t numRecords = 100000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+
+    printf("\nINTERPOLATION SEARCH BENCHMARK\n");
+    printf("Data\t\t\tPage\tSearch\t\tProbes/lookup\tTime (ms)\n");
+
+    for (int8_t f=0; f < 2; f++)
+    {
+        FILE *infile = fopen(files[f], "r+b");
+        if (infile == NULL)
+        {
+            printf("Error: Cannot open %s\n", files[f]);
+            continue;
+        }
+
+        for (int8_t p=0; p < 3; p++)
+        {
+            for (int8_t interpolate=0; interpolate <= 1; interpolate++)
+            {
+                count_t M = 8;
+                memStorageState *storage = (memStorageState*) malloc(sizeof(memStorageState));
+                storage->size = 8000000;
+                memStorageInit((storageState*) storage);
+
+                dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+                buffer->pageSize = pageSizes[p];
+                buffer->numPages = M;
+                buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+                buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->hashTable = NULL;
+                buffer->policy = NULL;
+                buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+                buffer->storage = (storageState*) storage;
+
+                sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+                state->keySize = 4;
+                state->dataSize = 12;
+                state->parameters = interpolate ? SBTREE_USE_INTERPOLATION : 0;
+                state->spline = NULL;
+                state->checkpoint = NULL;
+                state->valueLog = NULL;
+                state->readAhead = NULL;
+                state->aggregate = NULL;
+                state->bitmap = NULL;
+                state->bloomFilter = NULL;
+                state->buffer = buffer;
+                state->tempKey = malloc(sizeof(int32_t));
+                int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+                sbtreeInit(state);
+                state->searchKeys = NULL;   /* Compare interpolation with binary search */
+
+                int32_t i = 0;
+                fseek(infile, 0, SEEK_SET);
+                while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+                {
+                    int16_t count = *((int16_t*) (infileBuffer+4));
+                    for (int j=0; j < count && i < numRecords; j++)
+                    {
+                        void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                        sbtreePut(state, buf, (void*) (buf + 4));
+                        keys[i++] = *((uint32_t*) buf);
+                    }
+                }
+                sbtreeFlush(state);
+
+                state->numProbes = 0;
+                clock_t start = clock();
+                for (int32_t k=0; k < i; k++)
+                {
+                    if (sbtreeGet(state, &keys[k], recordBuffer) != 0)
+                        printf("Error: Failed to find: %lu\n", keys[k]);
+                }
+                clock_t end = clock();
+
+                printf("%-16s\t%u\t%-13s\t%.2f\t\t%lu\n", files[f], pageSizes[p], interpolate ? "Interpolation" : "Binary",
+                    (double) state->numProbes / i, (end-start)*1000/CLOCKS_PER_SEC);
+
+                closeBuffer(buffer);
+                free(state->tempKey);
+                free(recordBuffer);
+                free(state);
+                free(buffer->buffer);
+                free(buffer->pinLevel);
+                free(buffer->modified);
+                free(buffer->status);
+                free(buffer);
+                free(storage);
+            }
+        }
+        fclose(infile);
+    }
+    free(keys);
+}
+
+/**
+ * Compares page reads per query with and without the spline leaf predictor on the uwa500K data set
+ * for several spline memory budgets. Records are queried in insert order (as in the query test) and in random order.
+ */
+void benchmarkSplineIndex()
+{
+    uint32_t budgets[] = {0, 16, 64, 256, 4096};
+    count_t bufferSizes[] = {4, 8};
+    int32_t numRecords = 100000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    uint32_t *randomKeys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    splinePoint *points = (splinePoint*) malloc(sizeof(splinePoint)*4096);
+    splineState sp;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    printf("\nSPLINE INDEX BENCHMARK\n");
+    printf("Pages\tBudget\tPoints\tBytes\tReads/query (seq)\tReads/query (random)\tTime (ms)\n");
+
+    for (int8_t b=0; b < 2; b++)
+    {
+        for (int8_t s=0; s < 5; s++)
+        {
+            count_t M = bufferSizes[b];
+            memStorageState *storage = (memStorageState*) malloc(sizeof(memStorageState));
+            storage->size = 8000000;
+            memStorageInit((storageState*) storage);
+
+            dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+            buffer->pageSize = 512;
+            buffer->numPages = M;
+            buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+            buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->hashTable = NULL;
+            buffer->policy = NULL;
+            buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+            buffer->storage = (storageState*) storage;
+
+            sp.points = points;
+            sp.maxPoints = budgets[s];
+            sp.maxError = 1;
+
+            sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+            state->keySize = 4;
+            state->dataSize = 12;
+            state->parameters = 0;
+            state->spline = budgets[s] > 0 ? &sp : NULL;
+            state->checkpoint = NULL;
+            state->valueLog = NULL;
+            state->readAhead = NULL;
+            state->aggregate = NULL;
+            state->bitmap = NULL;
+            state->bloomFilter = NULL;
+            state->buffer = buffer;
+            state->tempKey = malloc(sizeof(int32_t));
+            int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+            sbtreeInit(state);
+
+            int32_t i = 0;
+            fseek(infile, 0, SEEK_SET);
+            while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+            {
+                int16_t count = *((int16_t*) (infileBuffer+4));
+                for (int j=0; j < count && i < numRecords; j++)
+                {
+                    void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                    sbtreePut(state, buf, (void*) (buf + 4));
+                    keys[i++] = *((uint32_t*) buf);
+                }
+            }
+            sbtreeFlush(state);
+
+            /* Same random query order for every configuration */
+            memcpy(randomKeys, keys, sizeof(uint32_t)*i);
+            srand(1);
+            for (int32_t k=i-1; k > 0; k--)
+            {
+                int32_t r = rand() % (k+1);
+                uint32_t tmp = randomKeys[k];
+                randomKeys[k] = randomKeys[r];
+                randomKeys[r] = tmp;
+            }
+
+            clock_t start = clock();
+            dbbufferClearStats(buffer);
+            for (int32_t k=0; k < i; k++)
+            {
+                if (sbtreeGet(state, &keys[k], recordBuffer) != 0)
+                    printf("Error: Failed to find: %lu\n", keys[k]);
+            }
+            double seqReads = (double) buffer->numReads / i;
+
+            dbbufferClearStats(buffer);
+            for (int32_t k=0; k < i; k++)
+            {
+                if (sbtreeGet(state, &randomKeys[k], recordBuffer) != 0)
+                    printf("Error: Failed to find: %lu\n", randomKeys[k]);
+            }
+            double randomReads = (double) buffer->numReads / i;
+            clock_t end = clock();
+
+            printf("%u\t%lu\t%lu\t%lu\t%.3f\t\t\t%.3f\t\t\t%lu\n", M, budgets[s], state->spline != NULL ? sp.count : 0,
+                state->spline != NULL ? sp.count*sizeof(splinePoint) : 0, seqReads, randomReads, (end-start)*1000/CLOCKS_PER_SEC);
+
+            closeBuffer(buffer);
+            free(state->tempKey);
+            free(recordBuffer);
+            free(state);
+            free(buffer->buffer);
+            free(buffer->pinLevel);
+            free(buffer->modified);
+            free(buffer->status);
+            free(buffer);
+            free(storage);
+        }
+    }
+    fclose(infile);
+    free(points);
+    free(randomKeys);
+    free(keys);
+}
+
+/**
+ * Compares page reads and time of sbtreeGetBatch() and a loop of sbtreeGet() calls on the uwa500K data set.
+ * Batches are random keys from the data set.
+ */
+void benchmarkGetBatch()
+{
+    uint32_t batchSizes[] = {10, 100, 1000, 10000};
+    int32_t numRecords = 100000, numLookups = 100000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    uint32_t *batch = (uint32_t*) malloc(sizeof(uint32_t)*10000);
+    int8_t *found = (int8_t*) malloc(sizeof(int8_t)*10000);
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    memStorageState *storage = (memStorageState*) malloc(sizeof(memStorageState));
+    storage->size = 8000000;
+    memStorageInit((storageState*) storage);
+
+    dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+    buffer->pageSize = 512;
+    buffer->numPages = M;
+    buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+    buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->hashTable = NULL;
+    buffer->policy = NULL;
+    buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+    buffer->storage = (storageState*) storage;
+
+    sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->parameters = 0;
+    state->spline = NULL;
+    state->checkpoint = NULL;
+    state->valueLog = NULL;
+    state->readAhead = NULL;
+    state->aggregate = NULL;
+    state->bitmap = NULL;
+    state->bloomFilter = NULL;
+    state->buffer = buffer;
+    state->tempKey = malloc(sizeof(int32_t));
+    int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+    int8_t* data = (int8_t*) malloc((size_t) state->dataSize*10000);
+    sbtreeInit(state);
+
+    int32_t i = 0;
+    while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+    {
+        int16_t count = *((int16_t*) (infileBuffer+4));
+        for (int j=0; j < count && i < numRecords; j++)
+        {
+            void *buf = (infileBuffer + headerSize + j*state->recordSize);
+            sbtreePut(state, buf, (void*) (buf + 4));
+            keys[i++] = *((uint32_t*) buf);
+        }
+    }
+    sbtreeFlush(state);
+    fclose(infile);
+
+    printf("\nBATCH GET BENCHMARK\n");
+    printf("Batch\tGet reads\tBatch reads\tGet time (ms)\tBatch time (ms)\n");
+
+    for (int8_t b=0; b < 4; b++)
+    {
+        uint32_t n = batchSizes[b];
+        uint32_t getReads = 0, batchReads = 0, errors = 0;
+        clock_t getTime = 0, batchTime = 0, start;
+
+        srand(1);
+        for (int32_t l=0; l < numLookups; l += n)
+        {
+            for (uint32_t k=0; k < n; k++)
+                batch[k] = keys[rand() % i];
+
+            dbbufferClearStats(buffer);
+            start = clock();
+            for (uint32_t k=0; k < n; k++)
+            {
+                if (sbtreeGet(state, &batch[k], recordBuffer) != 0)
+                    errors++;
+            }
+            getTime += clock() - start;
+            getReads += buffer->numReads;
+
+            dbbufferClearStats(buffer);
+            start = clock();
+            if (sbtreeGetBatch(state, batch, n, data, found) != 0)
+                errors++;
+            batchTime += clock() - start;
+            batchReads += buffer->numReads;
+
+            for (uint32_t k=0; k < n; k++)
+            {
+                if (!found[k] || sbtreeGet(state, &batch[k], recordBuffer) != 0 || memcmp(recordBuffer, data + k*state->dataSize, state->dataSize) != 0)
+                    errors++;
+            }
+        }
+        if (errors > 0)
+            printf("Error: %lu lookups failed\n", errors);
+        printf("%lu\t%lu\t\t%lu\t\t%lu\t\t%lu\n", n, getReads, batchReads, getTime*1000/CLOCKS_PER_SEC, batchTime*1000/CLOCKS_PER_SEC);
+    }
+
+    closeBuffer(buffer);
+    free(state->tempKey);
+    free(recordBuffer);
+    free(data);
+    free(state);
+    free(buffer->buffer);
+    free(buffer->pinLevel);
+    free(buffer->modified);
+    free(buffer->status);
+    free(buffer);
+    free(storage);
+    free(found);
+    free(batch);
+    free(keys);
+}
+
+/**
+ * Compares stdio file storage with pread/pwrite file descriptor storage (with and without O_DIRECT)
+ * on the uwa500K data set. Records are inserted, then queried in insert order and in random order.
+ */
+void benchmarkStorage()
+{
+    const char* names[] = {"fileStorage", "fdStorage", "fdStorage direct"};
+    count_t pageSizes[] = {512, 4096};
+    int32_t numRecords = 100000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 3;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    printf("\nSTORAGE BENCHMARK\n");
+    printf("Storage\t\t\tPage\tInsert (ms)\tQuery (ms)\tRandom query (ms)\tReads\n");
+
+    for (int8_t p=0; p < 2; p++)
+    {
+        for (int8_t t=0; t < 3; t++)
+        {
+            storageState *storage;
+            void *alignedBuffer = NULL;
+            if (t == 0)
+            {
+                fileStorageState *fs = (fileStorageState*) malloc(sizeof(fileStorageState));
+                fs->fileName = "myfile.bin";
+                if (fileStorageInit((storageState*) fs) != 0)
+                {
+                    printf("Error: Cannot initialize storage!\n");
+                    free(fs);
+                    continue;
+                }
+                storage = (storageState*) fs;
+            }
+            else
+            {
+                fdStorageState *fs = (fdStorageState*) malloc(sizeof(fdStorageState));
+                fs->fileName = "myfile.bin";
+                fs->direct = t == 2;
+                fs->alignedBuffer = NULL;
+                if (fs->direct && posix_memalign(&alignedBuffer, FD_STORAGE_ALIGNMENT, pageSizes[p]) == 0)
+                    fs->alignedBuffer = alignedBuffer;
+                if (fdStorageInit((storageState*) fs) != 0)
+                {
+                    printf("%-16s\tNot supported\n", names[t]);
+                    free(fs);
+                    free(alignedBuffer);
+                    continue;
+                }
+                storage = (storageState*) fs;
+            }
+
+            dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+            buffer->pageSize = pageSizes[p];
+            buffer->numPages = M;
+            buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+            buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->hashTable = NULL;
+            buffer->policy = NULL;
+            buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            /* Page aligned buffer so direct I/O does not copy through alignedBuffer when pages are aligned */
+            if (posix_memalign(&buffer->buffer, FD_STORAGE_ALIGNMENT, (size_t) buffer->numPages * buffer->pageSize) != 0)
+                buffer->buffer = malloc((size_t) buffer->numPages * buffer->pageSize);
+            buffer->storage = storage;
+
+            sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+            state->keySize = 4;
+            state->dataSize = 12;
+            state->parameters = 0;
+            state->spline = NULL;
+            state->checkpoint = NULL;
+            state->valueLog = NULL;
+            state->readAhead = NULL;
+            state->aggregate = NULL;
+            state->bitmap = NULL;
+            state->bloomFilter = NULL;
+            state->buffer = buffer;
+            state->tempKey = malloc(sizeof(int32_t));
+            int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+            sbtreeInit(state);
+
+            clock_t start = clock();
+            int32_t i = 0;
+            fseek(infile, 0, SEEK_SET);
+            while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+            {
+                int16_t count = *((int16_t*) (infileBuffer+4));
+                for (int j=0; j < count && i < numRecords; j++)
+                {
+                    void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                    sbtreePut(state, buf, (void*) (buf + 4));
+                    keys[i++] = *((uint32_t*) buf);
+                }
+            }
+            sbtreeFlush(state);
+            clock_t insertTime = clock() - start;
+
+            dbbufferClearStats(buffer);
+            start = clock();
+            for (int32_t k=0; k < i; k++)
+            {
+                if (sbtreeGet(state, &keys[k], recordBuffer) != 0)
+                    printf("Error: Failed to find: %lu\n", keys[k]);
+            }
+            clock_t queryTime = clock() - start;
+
+            srand(1);
+            start = clock();
+            for (int32_t k=0; k < i; k++)
+            {
+                uint32_t key = keys[rand() % i];
+                if (sbtreeGet(state, &key, recordBuffer) != 0)
+                    printf("Error: Failed to find: %lu\n", key);
+            }
+            clock_t randomTime = clock() - start;
+
+            printf("%-16s\t%u\t%lu\t\t%lu\t\t%lu\t\t\t%lu\n", names[t], pageSizes[p], insertTime*1000/CLOCKS_PER_SEC,
+                queryTime*1000/CLOCKS_PER_SEC, randomTime*1000/CLOCKS_PER_SEC, buffer->numReads);
+
+            closeBuffer(buffer);
+            free(state->tempKey);
+            free(recordBuffer);
+            free(state);
+            free(buffer->buffer);
+            free(buffer->pinLevel);
+            free(buffer->modified);
+            free(buffer->status);
+            free(buffer);
+            free(storage);
+            free(alignedBuffer);
+        }
+    }
+    fclose(infile);
+    free(keys);
+}
+
+/**
+ * Returns elapsed wall clock time in ms since start. Asynchronous I/O is not included in process CPU time.
+ */
+static uint32_t elapsedMs(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (uint32_t) ((end.tv_sec - start->tv_sec)*1000 + (end.tv_nsec - start->tv_nsec)/1000000);
+}
+
+/**
+ * Compares synchronous pread/pwrite storage with io_uring storage at queue depths 1 to 64 (with and without O_DIRECT)
+ * on the uwa500K data set. Records are inserted, scanned with an iterator, and found with batch get.
+ */
+void benchmarkAsyncStorage()
+{
+    uint16_t depths[] = {0, 1, 2, 4, 8, 16, 32, 64};
+    int32_t numRecords = 500000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4, pageSize = 4096;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    int8_t *found = (int8_t*) malloc(sizeof(int8_t)*numRecords);
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    printf("\nASYNCHRONOUS STORAGE BENCHMARK\n");
+    printf("Storage\t\tDirect\tDepth\tInsert (ms)\tRecords/sec\tIterate (ms)\tBatch get (ms)\tSubmits\n");
+
+    for (int8_t direct=0; direct < 2; direct++)
+    {
+        for (int8_t d=0; d < 8; d++)
+        {
+            uringStorageState *us = (uringStorageState*) malloc(sizeof(uringStorageState));
+            us->fd.fileName = "myfile.bin";
+            us->fd.direct = direct;
+            us->fd.alignedBuffer = NULL;
+            us->pageSize = pageSize;
+            us->queueDepth = depths[d];
+            us->submitBatch = depths[d] > 1 ? depths[d]/2 : 1;
+            us->memory = NULL;
+            /* Depth 0 is synchronous pread/pwrite storage */
+            if (depths[d] > 0 && posix_memalign(&us->memory, FD_STORAGE_ALIGNMENT, uringStorageMemorySize(depths[d], pageSize)) != 0)
+                us->memory = NULL;
+            if (uringStorageInit((storageState*) us) != 0)
+            {
+                printf("Error: Cannot initialize storage!\n");
+                free(us->memory);
+                free(us);
+                continue;
+            }
+            if (depths[d] > 0 && us->ringFd == -1)
+            {
+                printf("uringStorage\t%d\t%u\tNot supported\n", direct, depths[d]);
+                us->fd.storage.close((storageState*) us);
+                free(us->memory);
+                free(us);
+                continue;
+            }
+
+            dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+            buffer->pageSize = pageSize;
+            buffer->numPages = M;
+            buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+            buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->hashTable = NULL;
+            buffer->policy = NULL;
+            buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            if (posix_memalign(&buffer->buffer, FD_STORAGE_ALIGNMENT, (size_t) buffer->numPages * buffer->pageSize) != 0)
+                buffer->buffer = malloc((size_t) buffer->numPages * buffer->pageSize);
+            buffer->storage = (storageState*) us;
+
+            sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+            state->keySize = 4;
+            state->dataSize = 12;
+            state->parameters = 0;
+            state->spline = NULL;
+            state->checkpoint = NULL;
+            state->valueLog = NULL;
+            state->readAhead = NULL;
+            state->aggregate = NULL;
+            state->bitmap = NULL;
+            state->bloomFilter = NULL;
+            state->buffer = buffer;
+            state->tempKey = malloc(sizeof(int32_t));
+            int8_t* data = (int8_t*) malloc((size_t) state->dataSize*numRecords);
+            sbtreeInit(state);
+
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int32_t i = 0;
+            fseek(infile, 0, SEEK_SET);
+            while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+            {
+                int16_t count = *((int16_t*) (infileBuffer+4));
+                for (int j=0; j < count && i < numRecords; j++)
+                {
+                    void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                    sbtreePut(state, buf, (void*) (buf + 4));
+                    keys[i++] = *((uint32_t*) buf);
+                }
+            }
+            sbtreeFlush(state);
+            uint32_t insertTime = elapsedMs(&start);
+
+            sbtreeIterator it;
+            uint32_t *itKey, *itData, n = 0, minKey = 0;
+            it.minKey = &minKey;
+            it.maxKey = NULL;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            sbtreeInitIterator(state, &it);
+            while (sbtreeNext(state, &it, (void**) &itKey, (void**) &itData))
+                n++;
+            uint32_t iterateTime = elapsedMs(&start);
+            if (n != i)
+                printf("Error: Iterator read %lu of %lu records\n", n, i);
+
+            srand(1);
+            for (int32_t k=0; k < i; k++)
+                keys[k] = keys[rand() % i];
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (sbtreeGetBatch(state, keys, i, data, found) != 0)
+                printf("Error: Batch get failed\n");
+            uint32_t batchTime = elapsedMs(&start);
+            for (int32_t k=0; k < i; k++)
+            {
+                if (!found[k])
+                {
+                    printf("Error: Failed to find: %lu\n", keys[k]);
+                    break;
+                }
+            }
+
+            printf("%s\t%d\t%u\t%lu\t\t%lu\t\t%lu\t\t%lu\t\t%lu\n", us->ringFd == -1 ? "fdStorage\t" : "uringStorage", direct, depths[d],
+                insertTime, insertTime > 0 ? (uint32_t) ((uint64_t) i*1000/insertTime) : 0, iterateTime, batchTime, us->numSubmits);
+
+            closeBuffer(buffer);
+            free(state->tempKey);
+            free(data);
+            free(state);
+            free(buffer->buffer);
+            free(buffer->pinLevel);
+            free(buffer->modified);
+            free(buffer->status);
+            free(buffer);
+            free(us->memory);
+            free(us);
+        }
+    }
+    fclose(infile);
+    free(found);
+    free(keys);
+}
+
+/**
+ * Compares pread/pwrite storage with memory-mapped storage (copy into buffer and zero-copy reads)
+ * on the uwa500K data set. Records are inserted, queried in random order, and scanned with an iterator.
+ */
+void benchmarkMmapStorage()
+{
+    const char* names[] = {"fdStorage", "mmapStorage", "mmapStorage zero-copy"};
+    int32_t numRecords = 500000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    printf("\nMMAP STORAGE BENCHMARK\n");
+    printf("Storage\t\t\tInsert (ms)\tRandom query (ms)\tScan (ms)\tReads\n");
+
+    for (int8_t t=0; t < 3; t++)
+    {
+        storageState *storage;
+        if (t == 0)
+        {
+            fdStorageState *fs = (fdStorageState*) malloc(sizeof(fdStorageState));
+            fs->fileName = "myfile.bin";
+            fs->direct = 0;
+            fs->alignedBuffer = NULL;
+            storage = (storageState*) fs;
+        }
+        else
+        {
+            mmapStorageState *ms = (mmapStorageState*) malloc(sizeof(mmapStorageState));
+            ms->fileName = "myfile.bin";
+            ms->mapSize = 0;
+            ms->growSize = 0;
+            ms->advice = MMAP_STORAGE_NORMAL;
+            storage = (storageState*) ms;
+        }
+        if ((t == 0 ? fdStorageInit(storage) : mmapStorageInit(storage)) != 0)
+        {
+            printf("Error: Cannot initialize storage!\n");
+            free(storage);
+            continue;
+        }
+
+        dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+        buffer->pageSize = 512;
+        buffer->numPages = M;
+        buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+        buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+        buffer->hashTable = NULL;
+        buffer->policy = NULL;
+        buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+        buffer->buffer = malloc((size_t) buffer->numPages * buffer->pageSize);
+        buffer->storage = storage;
+
+        sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+        state->keySize = 4;
+        state->dataSize = 12;
+        state->parameters = t == 2 ? SBTREE_ZERO_COPY_READ : 0;
+        state->spline = NULL;
+        state->checkpoint = NULL;
+        state->valueLog = NULL;
+        state->readAhead = NULL;
+        state->aggregate = NULL;
+        state->bitmap = NULL;
+        state->bloomFilter = NULL;
+        state->buffer = buffer;
+        state->tempKey = malloc(sizeof(int32_t));
+        int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+        sbtreeInit(state);
+
+        clock_t start = clock();
+        int32_t i = 0;
+        fseek(infile, 0, SEEK_SET);
+        while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+        {
+            int16_t count = *((int16_t*) (infileBuffer+4));
+            for (int j=0; j < count && i < numRecords; j++)
+            {
+                void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                sbtreePut(state, buf, (void*) (buf + 4));
+                keys[i++] = *((uint32_t*) buf);
+            }
+        }
+        sbtreeFlush(state);
+        clock_t insertTime = clock() - start;
+
+        dbbufferClearStats(buffer);
+        if (t > 0)
+            mmapStorageAdvise(storage, MMAP_STORAGE_RANDOM);
+        srand(1);
+        start = clock();
+        for (int32_t k=0; k < i; k++)
+        {
+            uint32_t key = keys[rand() % i];
+            if (sbtreeGet(state, &key, recordBuffer) != 0)
+                printf("Error: Failed to find: %lu\n", key);
+        }
+        clock_t randomTime = clock() - start;
+
+        if (t > 0)
+            mmapStorageAdvise(storage, MMAP_STORAGE_SEQUENTIAL);
+        sbtreeIterator it;
+        uint32_t *itKey, *itData, n = 0, minKey = 0;
+        it.minKey = &minKey;
+        it.maxKey = NULL;
+        start = clock();
+        sbtreeInitIterator(state, &it);
+        while (sbtreeNext(state, &it, (void**) &itKey, (void**) &itData))
+            n++;
+        clock_t scanTime = clock() - start;
+        if (n != i)
+            printf("Error: Iterator read %lu of %lu records\n", n, i);
+
+        printf("%-24s%lu\t\t%lu\t\t\t%lu\t\t%lu\n", names[t], insertTime*1000/CLOCKS_PER_SEC,
+            randomTime*1000/CLOCKS_PER_SEC, scanTime*1000/CLOCKS_PER_SEC, buffer->numReads);
+
+        closeBuffer(buffer);
+        free(state->tempKey);
+        free(recordBuffer);
+        free(state);
+        free(buffer->buffer);
+        free(buffer->pinLevel);
+        free(buffer->modified);
+        free(buffer->status);
+        free(buffer);
+        free(storage);
+    }
+    fclose(infile);
+    free(keys);
+}
+
+/**
+ * Compares rebuilding an index from the uwa500K data set with reopening the synced index file.
+ */
+void benchmarkReopen()
+{
+    int32_t numRecords = 500000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+    storage->fileName = "myfile.bin";
+
+    dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+    buffer->pageSize = 512;
+    buffer->numPages = M;
+    buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+    buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->hashTable = NULL;
+    buffer->policy = NULL;
+    buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+    buffer->storage = (storageState*) storage;
+
+    sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->parameters = 0;
+    state->spline = NULL;
+    state->checkpoint = NULL;
+    state->valueLog = NULL;
+    state->readAhead = NULL;
+    state->aggregate = NULL;
+    state->bitmap = NULL;
+    state->bloomFilter = NULL;
+    state->buffer = buffer;
+    state->tempKey = malloc(sizeof(int32_t));
+    int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+
+    /* Build index from data and sync it to storage */
+    clock_t start = clock();
+    if (fileStorageInit((storageState*) storage) != 0)
+    {
+        printf("Error: Cannot initialize storage!\n");
+        return;
+    }
+    sbtreeInit(state);
+    int32_t i = 0;
+    while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+    {
+        int16_t count = *((int16_t*) (infileBuffer+4));
+        for (int j=0; j < count && i < numRecords; j++)
+        {
+            void *buf = (infileBuffer + headerSize + j*state->recordSize);
+            sbtreePut(state, buf, (void*) (buf + 4));
+            keys[i++] = *((uint32_t*) buf);
+        }
+    }
+    sbtreeSync(state);
+    clock_t buildTime = clock() - start;
+    id_t levels = state->levels, numNodes = state->numNodes, nextPage = buffer->nextPageWriteId;
+    closeBuffer(buffer);
+    fclose(infile);
+
+    /* Reopen index */
+    start = clock();
+    if (fileStorageOpen((storageState*) storage) != 0 || sbtreeOpen(state) != 0)
+    {
+        printf("Error: Cannot open index!\n");
+        return;
+    }
+    clock_t openTime = clock() - start;
+    id_t openReads = buffer->numReads;
+
+    int32_t errors = 0;
+    srand(1);
+    for (int32_t k=0; k < 10000; k++)
+    {
+        uint32_t key = keys[rand() % i];
+        if (sbtreeGet(state, &key, recordBuffer) != 0)
+            errors++;
+    }
+
+    printf("\nREOPEN BENCHMARK\n");
+    printf("Build time (ms): %lu  Open time (ms): %lu  Open reads: %lu\n", buildTime*1000/CLOCKS_PER_SEC, openTime*1000/CLOCKS_PER_SEC, openReads);
+    printf("Levels: %lu/%lu  Nodes: %lu/%lu  Next page: %lu/%lu (synced/opened)\n", levels, state->levels, numNodes, state->numNodes, nextPage, buffer->nextPageWriteId);
+    if (errors > 0)
+        printf("Error: %lu keys not found after open\n", errors);
+
+    closeBuffer(buffer);
+    free(state->tempKey);
+    free(recordBuffer);
+    free(state);
+    free(buffer->buffer);
+    free(buffer->pinLevel);
+    free(buffer->modified);
+    free(buffer->status);
+    free(buffer);
+    free(storage);
+    free(keys);
+}
+
+/**
+ * Compares checkpoint intervals on the uwa500K data set. Index is built without sync to simulate a crash.
+ * Reports page writes during build (write amplification) and page reads and time to recover on open.
+ */
+void benchmarkCheckpoint()
+{
+    int32_t numRecords = 500000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    id_t intervals[] = {0, 16, 64, 256, 1024, 4096};
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+    storage->fileName = "myfile.bin";
+
+    dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+    buffer->pageSize = 512;
+    buffer->numPages = M;
+    buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+    buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->hashTable = NULL;
+    buffer->policy = NULL;
+    buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+    buffer->storage = (storageState*) storage;
+
+    sbtreeCheckpoint checkpoint;
+    checkpoint.maxTime = 0;
+    checkpoint.getTime = NULL;
+
+    sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->parameters = 0;
+    state->spline = NULL;
+    state->checkpoint = &checkpoint;
+    state->valueLog = NULL;
+    state->readAhead = NULL;
+    state->aggregate = NULL;
+    state->bitmap = NULL;
+    state->bloomFilter = NULL;
+    state->buffer = buffer;
+    state->tempKey = malloc(sizeof(int32_t));
+    int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+
+    printf("\nCHECKPOINT BENCHMARK\n");
+    printf("Interval (pages)\tCheckpoints\tBuild writes\tBuild time (ms)\tRecover reads\tRelinked leaves\tRecover time (ms)\tErrors\n");
+    for (uint8_t c=0; c < sizeof(intervals)/sizeof(id_t); c++)
+    {
+        checkpoint.maxPages = intervals[c];
+
+        /* Build index without sync. Records in output buffer are lost. */
+        fseek(infile, 0, SEEK_SET);
+        if (fileStorageInit((storageState*) storage) != 0)
+        {
+            printf("Error: Cannot initialize storage!\n");
+            return;
+        }
+        clock_t start = clock();
+        sbtreeInit(state);
+        int32_t i = 0;
+        while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+        {
+            int16_t count = *((int16_t*) (infileBuffer+4));
+            for (int j=0; j < count && i < numRecords; j++)
+            {
+                void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                sbtreePut(state, buf, (void*) (buf + 4));
+                keys[i++] = *((uint32_t*) buf);
+            }
+        }
+        clock_t buildTime = clock() - start;
+        id_t buildWrites = buffer->numWrites, numCheckpoints = checkpoint.numCheckpoints;
+        int32_t written = i - SBTREE_GET_COUNT(state->writeBuffer);
+        closeBuffer(buffer);
+
+        /* Recover index */
+        start = clock();
+        if (fileStorageOpen((storageState*) storage) != 0 || sbtreeOpen(state) != 0)
+        {
+            printf("Error: Cannot open index!\n");
+            return;
+        }
+        clock_t openTime = clock() - start;
+        id_t openReads = buffer->numReads;
+
+        int32_t errors = 0;
+        srand(1);
+        for (int32_t k=0; k < 10000; k++)
+        {
+            uint32_t key = keys[rand() % written];
+            if (sbtreeGet(state, &key, recordBuffer) != 0)
+                errors++;
+        }
+        printf("%lu\t\t\t%lu\t\t%lu\t\t%lu\t\t%lu\t\t%lu\t\t%lu\t\t\t%lu\n", intervals[c], numCheckpoints, buildWrites, buildTime*1000/CLOCKS_PER_SEC,
+            openReads, checkpoint.numRelinked, openTime*1000/CLOCKS_PER_SEC, errors);
+        closeBuffer(buffer);
+    }
+
+    fclose(infile);
+    free(state->tempKey);
+    free(recordBuffer);
+    free(state);
+    free(buffer->buffer);
+    free(buffer->pinLevel);
+    free(buffer->modified);
+    free(buffer->status);
+    free(buffer);
+    free(storage);
+    free(keys);
+}
+
+/**
+ * Measures page checksum overhead for 512 B, 4 KB and 16 KB pages. Reports time to checksum one page
+ * with table-driven and SSE4.2 CRC32C, and insert and random query time on the uwa500K data set
+ * with and without SBTREE_PAGE_CHECKSUM.
+ */
+void benchmarkChecksum()
+{
+    const char* names[] = {"", "table", "SSE4.2"};
+    count_t pageSizes[] = {512, 4096, 16384};
+    int32_t numRecords = 500000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    int8_t *page = (int8_t*) malloc(16384);
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    printf("\nCHECKSUM BENCHMARK\n");
+    printf("CRC32C\t\tPage\tTime per page (ns)\tMB/s\n");
+    for (uint32_t k=0; k < 16384; k++)
+        page[k] = (int8_t) rand();
+    for (uint8_t level=CRC32C_TABLE; level <= CRC32C_SSE42; level++)
+    {
+        crc32cFunc crc = crc32cSelect(level);
+        if (crc == NULL)
+        {
+            printf("%-8s\tNot supported\n", names[level]);
+            continue;
+        }
+        for (int8_t p=0; p < 3; p++)
+        {
+            /* Checksum 256 MB of pages */
+            uint32_t numPages = (256u << 20) / pageSizes[p], sum = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (uint32_t k=0; k < numPages; k++)
+                sum += crc(k, page, pageSizes[p]);
+            uint32_t ms = elapsedMs(&start);
+            if (sum == 1)
+                printf(" ");
+            printf("%-8s\t%u\t%.1f\t\t\t%lu\n", names[level], pageSizes[p], ms*1e6/numPages, ms > 0 ? 256*1000/ms : 0);
+        }
+    }
+
+    printf("Checksum\tPage\tInsert (ms)\tRandom query (ms)\tReads\tChecksum errors\n");
+    for (int8_t p=0; p < 3; p++)
+    {
+        for (int8_t c=0; c < 2; c++)
+        {
+            fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+            storage->fileName = "myfile.bin";
+            if (fileStorageInit((storageState*) storage) != 0)
+            {
+                printf("Error: Cannot initialize storage!\n");
+                return;
+            }
+
+            dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+            buffer->pageSize = pageSizes[p];
+            buffer->numPages = M;
+            buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+            buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->hashTable = NULL;
+            buffer->policy = NULL;
+            buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+            buffer->storage = (storageState*) storage;
+
+            sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+            state->keySize = 4;
+            state->dataSize = 12;
+            state->parameters = c ? SBTREE_PAGE_CHECKSUM : 0;
+            state->spline = NULL;
+            state->checkpoint = NULL;
+            state->valueLog = NULL;
+            state->readAhead = NULL;
+            state->aggregate = NULL;
+            state->bitmap = NULL;
+            state->bloomFilter = NULL;
+            state->buffer = buffer;
+            state->tempKey = malloc(sizeof(int32_t));
+            int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+            sbtreeInit(state);
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int32_t i = 0;
+            fseek(infile, 0, SEEK_SET);
+            while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+            {
+                int16_t count = *((int16_t*) (infileBuffer+4));
+                for (int j=0; j < count && i < numRecords; j++)
+                {
+                    void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                    sbtreePut(state, buf, (void*) (buf + 4));
+                    keys[i++] = *((uint32_t*) buf);
+                }
+            }
+            sbtreeFlush(state);
+            uint32_t insertTime = elapsedMs(&start);
+
+            dbbufferClearStats(buffer);
+            srand(1);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int32_t k=0; k < 100000; k++)
+            {
+                uint32_t key = keys[rand() % i];
+                if (sbtreeGet(state, &key, recordBuffer) != 0)
+                    printf("Error: Failed to find: %lu\n", key);
+            }
+            uint32_t randomTime = elapsedMs(&start);
+
+            printf("%s\t\t%u\t%lu\t\t%lu\t\t\t%lu\t%lu\n", c ? "yes" : "no", pageSizes[p], insertTime, randomTime, buffer->numReads, buffer->numChecksumErrors);
+
+            closeBuffer(buffer);
+            free(state->tempKey);
+            free(recordBuffer);
+            free(state);
+            free(buffer->buffer);
+            free(buffer->pinLevel);
+            free(buffer->modified);
+            free(buffer->status);
+            free(buffer);
+            free(storage);
+        }
+    }
+    fclose(infile);
+    free(page);
+    free(keys);
+}
+
+/**
+ * Compares pages written, insert, random query and scan time on the uwa500K data set with and without
+ * SBTREE_DELTA_KEYS for 512 B and 4 KB pages. The 4 byte data case shows the gain when keys dominate the record.
+ */
+void benchmarkDeltaKeys()
+{
+    count_t pageSizes[] = {512, 4096};
+    uint8_t dataSizes[] = {12, 4};
+    int32_t numRecords = 500000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    printf("\nDELTA KEY BENCHMARK\n");
+    printf("Delta\tPage\tData\tWrites\tInsert (ms)\tRandom query (ms)\tReads\tScan (ms)\n");
+    for (int8_t p=0; p < 2; p++)
+    {
+        for (int8_t d=0; d < 2; d++)
+        {
+            for (int8_t c=0; c < 2; c++)
+            {
+                fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+                storage->fileName = "myfile.bin";
+                if (fileStorageInit((storageState*) storage) != 0)
+                {
+                    printf("Error: Cannot initialize storage!\n");
+                    return;
+                }
+
+                dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+                buffer->pageSize = pageSizes[p];
+                buffer->numPages = M;
+                buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+                buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->hashTable = NULL;
+                buffer->policy = NULL;
+                buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+                buffer->storage = (storageState*) storage;
+
+                sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+                state->keySize = 4;
+                state->dataSize = dataSizes[d];
+                state->parameters = c ? SBTREE_DELTA_KEYS : 0;
+                state->spline = NULL;
+                state->checkpoint = NULL;
+                state->valueLog = NULL;
+                state->readAhead = NULL;
+                state->aggregate = NULL;
+                state->bitmap = NULL;
+                state->bloomFilter = NULL;
+                state->buffer = buffer;
+                state->tempKey = malloc(sizeof(int32_t));
+                int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+                sbtreeInit(state);
+
+                /* Data value is the first dataSize bytes of the 12 byte sensor record */
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                int32_t i = 0;
+                fseek(infile, 0, SEEK_SET);
+                while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+                {
+                    int16_t count = *((int16_t*) (infileBuffer+4));
+                    for (int j=0; j < count && i < numRecords; j++)
+                    {
+                        void *buf = (infileBuffer + headerSize + j*16);
+                        sbtreePut(state, buf, (void*) (buf + 4));
+                        keys[i++] = *((uint32_t*) buf);
+                    }
+                }
+                sbtreeFlush(state);
+                uint32_t insertTime = elapsedMs(&start);
+                id_t writes = buffer->numWrites;
+
+                dbbufferClearStats(buffer);
+                srand(1);
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for (int32_t k=0; k < 100000; k++)
+                {
+                    uint32_t key = keys[rand() % i];
+                    if (sbtreeGet(state, &key, recordBuffer) != 0)
+                        printf("Error: Failed to find: %lu\n", key);
+                }
+                uint32_t randomTime = elapsedMs(&start);
+                id_t reads = buffer->numReads;
+
+                sbtreeIterator it;
+                uint32_t *itKey, *itData, minKey = keys[0], n = 0;
+                it.minKey = &minKey;
+                it.maxKey = NULL;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                sbtreeInitIterator(state, &it);
+                while (sbtreeNext(state, &it, (void**) &itKey, (void**) &itData))
+                    n++;
+                uint32_t scanTime = elapsedMs(&start);
+                if (n != (uint32_t) i)
+                    printf("Error: Scan returned %lu of %lu records\n", n, i);
+
+                printf("%s\t%u\t%u\t%lu\t%lu\t\t%lu\t\t\t%lu\t%lu\n", c ? "yes" : "no", pageSizes[p], dataSizes[d], writes, insertTime, randomTime, reads, scanTime);
+
+                closeBuffer(buffer);
+                free(state->tempKey);
+                free(recordBuffer);
+                free(state);
+                free(buffer->buffer);
+                free(buffer->pinLevel);
+                free(buffer->modified);
+                free(buffer->status);
+                free(buffer);
+                free(storage);
+            }
+        }
+    }
+    fclose(infile);
+    free(keys);
+}
+
+/**
+ * Compares storage size, insert and random query time of file storage with and without compressStorage
+ * on the uwa500K and sea100K data sets for 512 B and 4 KB pages. KB read counts blocks read from the file
+ * for random queries and a scan of all records.
+ */
+void benchmarkCompressStorage()
+{
+    const char* files[] = {"data/uwa500K.bin", "data/sea100K.bin"};
+    int32_t numRecords[] = {500000, 100000};
+    count_t pageSizes[] = {512, 4096};
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords[0]);
+    struct timespec start;
+
+    printf("\nCOMPRESSED STORAGE BENCHMARK\n");
+    printf("Data\t\t\tPage\tCompress\tStored (KB)\tRatio\tInsert (ms)\tMB/s\tRandom (ms)\tKB read\tScan (ms)\tKB read\n");
+    for (int8_t f=0; f < 2; f++)
+    {
+        FILE *infile = fopen(files[f], "r+b");
+        if (infile == NULL)
+        {
+            printf("Error: Cannot open %s\n", files[f]);
+            continue;
+        }
+
+        for (int8_t p=0; p < 2; p++)
+        {
+            for (int8_t c=0; c < 2; c++)
+            {
+                fileStorageState *fs = (fileStorageState*) malloc(sizeof(fileStorageState));
+                fs->fileName = "myfile.bin";
+                if (fileStorageInit((storageState*) fs) != 0)
+                {
+                    printf("Error: Cannot initialize storage!\n");
+                    return;
+                }
+                storageState *storage = (storageState*) fs;
+                compressStorageState *cs = NULL;
+                if (c)
+                {
+                    cs = (compressStorageState*) malloc(sizeof(compressStorageState));
+                    cs->base = (storageState*) fs;
+                    cs->pageSize = pageSizes[p];
+                    cs->maxPages = 2 * numRecords[f] / (pageSizes[p] / 16) + 64;
+                    cs->shuffle = 16;               /* Key and data size */
+                    cs->memory = malloc(compressStorageMemorySize(cs->pageSize, cs->maxPages));
+                    compressStorageInit((storageState*) cs);
+                    storage = (storageState*) cs;
+                }
+
+                dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+                buffer->pageSize = pageSizes[p];
+                buffer->numPages = M;
+                buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+                buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->hashTable = NULL;
+                buffer->policy = NULL;
+                buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+                buffer->storage = storage;
+
+                sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+                state->keySize = 4;
+                state->dataSize = 12;
+                state->parameters = 0;
+                state->spline = NULL;
+                state->checkpoint = NULL;
+                state->valueLog = NULL;
+                state->readAhead = NULL;
+                state->aggregate = NULL;
+                state->bitmap = NULL;
+                state->bloomFilter = NULL;
+                state->buffer = buffer;
+                state->tempKey = malloc(sizeof(int32_t));
+                int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+                sbtreeInit(state);
+
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                int32_t i = 0;
+                while (i < numRecords[f] && fread(infileBuffer, 512, 1, infile) != 0)
+                {
+                    int16_t count = *((int16_t*) (infileBuffer+4));
+                    for (int j=0; j < count && i < numRecords[f]; j++)
+                    {
+                        void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                        sbtreePut(state, buf, (void*) (buf + 4));
+                        keys[i++] = *((uint32_t*) buf);
+                    }
+                }
+                sbtreeSync(state);
+                uint32_t insertTime = elapsedMs(&start);
+                fseek(infile, 0, SEEK_SET);
+
+                uint32_t stored = c ? cs->logEnd + COMPRESS_STORAGE_LOG_START * pageSizes[p] : buffer->numWrites * pageSizes[p];
+                double ratio = (double) buffer->numWrites * pageSizes[p] / stored;
+
+                dbbufferClearStats(buffer);
+                if (c)
+                    cs->numBlockReads = 0;
+                srand(1);
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for (int32_t k=0; k < 100000; k++)
+                {
+                    uint32_t key = keys[rand() % i];
+                    if (sbtreeGet(state, &key, recordBuffer) != 0)
+                        printf("Error: Failed to find: %lu\n", key);
+                }
+                uint32_t randomTime = elapsedMs(&start);
+                uint32_t bytesRead = (c ? cs->numBlockReads : buffer->numReads) * pageSizes[p];
+
+                dbbufferClearStats(buffer);
+                if (c)
+                    cs->numBlockReads = 0;
+                sbtreeIterator it;
+                uint32_t *itKey, *itData, minKey = 0;
+                it.minKey = &minKey;
+                it.maxKey = NULL;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                sbtreeInitIterator(state, &it);
+                while (sbtreeNext(state, &it, (void**) &itKey, (void**) &itData))
+                    ;
+                uint32_t scanTime = elapsedMs(&start);
+                uint32_t scanRead = (c ? cs->numBlockReads : buffer->numReads) * pageSizes[p];
+
+                printf("%-16s\t%u\t%s\t\t%lu\t\t%.2f\t%lu\t\t%lu\t%lu\t\t%lu\t%lu\t\t%lu\n", files[f], pageSizes[p], c ? "yes" : "no", stored / 1024, ratio,
+                    insertTime, insertTime > 0 ? (uint32_t) ((double) i * 16 / insertTime / 1000) : 0, randomTime, bytesRead / 1024, scanTime, scanRead / 1024);
+
+                closeBuffer(buffer);
+                free(state->tempKey);
+                free(recordBuffer);
+                free(state);
+                free(buffer->buffer);
+                free(buffer->pinLevel);
+                free(buffer->modified);
+                free(buffer->status);
+                free(buffer);
+                if (c)
+                {
+                    free(cs->memory);
+                    free(cs);
+                }
+                free(fs);
+            }
+        }
+        fclose(infile);
+    }
+    free(keys);
+}
+
+/* Key size for compareKeyBytes() */
+static uint8_t compareKeySize;
+
+/**
+ * Compares keys as unsigned byte strings (big-endian fields).
+ */
+static int8_t compareKeyBytes(void *a, void *b)
+{
+    int c = memcmp(a, b, compareKeySize);
+    return c < 0 ? -1 : (c > 0 ? 1 : 0);
+}
+
+/**
+ * Compares levels, interior pages written and random query time with and without SBTREE_PREFIX_KEYS
+ * for 16 and 32 byte composite keys (sensor id and timestamp, big-endian) on the uwa500K data set.
+ * Records are split into 10 sensors. Reads are pages read per query with a 4 page buffer.
+ */
+void benchmarkPrefixKeys()
+{
+    count_t pageSizes[] = {512, 4096};
+    uint8_t keySizes[] = {16, 32};
+    int32_t numRecords = 500000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint8_t *keys = (uint8_t*) malloc((size_t) 32*numRecords);
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        free(keys);
+        return;
+    }
+
+    printf("\nPREFIX KEY BENCHMARK\n");
+    printf("Prefix\tPage\tKey\tLevels\tWrites\tInterior\tInsert (ms)\tRandom query (ms)\tReads/query\n");
+    for (int8_t p=0; p < 2; p++)
+    {
+        for (int8_t k=0; k < 2; k++)
+        {
+            for (int8_t c=0; c < 2; c++)
+            {
+                fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+                storage->fileName = "myfile.bin";
+                if (fileStorageInit((storageState*) storage) != 0)
+                {
+                    printf("Error: Cannot initialize storage!\n");
+                    return;
+                }
+
+                dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+                buffer->pageSize = pageSizes[p];
+                buffer->numPages = M;
+                buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+                buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->hashTable = NULL;
+                buffer->policy = NULL;
+                buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+                buffer->storage = (storageState*) storage;
+
+                sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+                state->keySize = keySizes[k];
+                state->dataSize = 12;
+                state->parameters = c ? SBTREE_PREFIX_KEYS : 0;
+                state->spline = NULL;
+                state->checkpoint = NULL;
+                state->valueLog = NULL;
+                state->readAhead = NULL;
+                state->aggregate = NULL;
+                state->bitmap = NULL;
+                state->bloomFilter = NULL;
+                state->buffer = buffer;
+                state->tempKey = malloc(state->keySize);
+                int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+                sbtreeInit(state);
+                compareKeySize = state->keySize;
+                state->compareKey = compareKeyBytes;
+                state->searchKeys = NULL;
+
+                /* Key is sensor id (8 bytes or 24 byte name) followed by 8 byte timestamp */
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                int32_t i = 0;
+                fseek(infile, 0, SEEK_SET);
+                while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+                {
+                    int16_t count = *((int16_t*) (infileBuffer+4));
+                    for (int j=0; j < count && i < numRecords; j++)
+                    {
+                        void *buf = (infileBuffer + headerSize + j*16);
+                        uint8_t *key = keys + (size_t) i*state->keySize;
+                        uint32_t sensor = i / (numRecords / 10), ts = *((uint32_t*) buf);
+                        memset(key, 0, state->keySize);
+                        if (state->keySize == 32)
+                            memcpy(key, "ubco/uwa/station", 16);
+                        else
+                            key[0] = 0x5E;
+                        for (int8_t b=0; b < 4; b++)
+                        {
+                            key[state->keySize-12+b] = (uint8_t) (sensor >> (24-8*b));
+                            key[state->keySize-4+b] = (uint8_t) (ts >> (24-8*b));
+                        }
+                        sbtreePut(state, key, (void*) (buf + 4));
+                        i++;
+                    }
+                }
+                sbtreeFlush(state);
+                uint32_t insertTime = elapsedMs(&start);
+                id_t writes = buffer->numWrites;
+                id_t leaves = (i + state->maxRecordsPerPage - 1) / state->maxRecordsPerPage;
+
+                dbbufferClearStats(buffer);
+                srand(1);
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for (int32_t q=0; q < 100000; q++)
+                {
+                    uint8_t *key = keys + (size_t) (rand() % i)*state->keySize;
+                    if (sbtreeGet(state, key, recordBuffer) != 0)
+                        printf("Error: Failed to find key\n");
+                }
+                uint32_t randomTime = elapsedMs(&start);
+
+                printf("%s\t%u\t%u\t%u\t%lu\t%lu\t\t%lu\t\t%lu\t\t\t%.2f\n", c ? "yes" : "no", pageSizes[p], keySizes[k], state->levels,
+                    writes, writes - leaves, insertTime, randomTime, buffer->numReads / 100000.0);
+
+                closeBuffer(buffer);
+                free(state->tempKey);
+                free(recordBuffer);
+                free(state);
+                free(buffer->buffer);
+                free(buffer->pinLevel);
+                free(buffer->modified);
+                free(buffer->status);
+                free(buffer);
+                free(storage);
+            }
+        }
+    }
+    fclose(infile);
+    free(keys);
+}
+
+/**
+ * Compares storage, insert, random query and scan time of variable-length values padded to the largest
+ * value (242 byte data, all inline) and stored with a value log (16 byte data) on the uwa500K data set.
+ * 10% of values are 64 to 240 byte events and the rest are 4 to 16 byte readings. Random queries read
+ * the value. Scans are without reading values (keys only) and with reading values.
+ */
+void benchmarkValueLog()
+{
+    count_t pageSizes[] = {512, 4096};
+    uint8_t dataSizes[] = {242, 16};
+    int32_t numRecords = 100000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    uint8_t value[240];
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        free(keys);
+        return;
+    }
+
+    printf("\nVALUE LOG BENCHMARK\n");
+    printf("Log\tPage\tData\tStored (KB)\tInsert (ms)\tRandom query (ms)\tScan keys (ms)\tScan values (ms)\n");
+    for (int8_t p=0; p < 2; p++)
+    {
+        for (int8_t c=0; c < 2; c++)
+        {
+            fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+            storage->fileName = "myfile.bin";
+            fileStorageState *logStorage = (fileStorageState*) malloc(sizeof(fileStorageState));
+            logStorage->fileName = "myvalues.bin";
+            if (fileStorageInit((storageState*) storage) != 0 || fileStorageInit((storageState*) logStorage) != 0)
+            {
+                printf("Error: Cannot initialize storage!\n");
+                return;
+            }
+
+            dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+            buffer->pageSize = pageSizes[p];
+            buffer->numPages = M;
+            buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+            buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->hashTable = NULL;
+            buffer->policy = NULL;
+            buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+            buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+            buffer->storage = (storageState*) storage;
+
+            /* Value log uses 2 pages of memory */
+            sbtreeValueLog *valueLog = (sbtreeValueLog*) malloc(sizeof(sbtreeValueLog));
+            valueLog->storage = (storageState*) logStorage;
+            valueLog->buffer = malloc((size_t) 2 * buffer->pageSize);
+
+            sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+            state->keySize = 4;
+            state->dataSize = dataSizes[c];
+            state->parameters = 0;
+            state->spline = NULL;
+            state->checkpoint = NULL;
+            state->valueLog = c ? valueLog : NULL;
+            state->readAhead = NULL;
+            state->aggregate = NULL;
+            state->bitmap = NULL;
+            state->bloomFilter = NULL;
+            state->buffer = buffer;
+            state->tempKey = malloc(sizeof(int32_t));
+            int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+            sbtreeInit(state);
+
+            /* Value is the sensor record repeated to its length */
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int32_t i = 0;
+            fseek(infile, 0, SEEK_SET);
+            while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+            {
+                int16_t count = *((int16_t*) (infileBuffer+4));
+                for (int j=0; j < count && i < numRecords; j++)
+                {
+                    void *buf = (infileBuffer + headerSize + j*16);
+                    uint32_t h = (uint32_t) i * 2654435761u;
+                    uint16_t length = (h >> 8) % 10 == 0 ? 64 + (h >> 12) % 177 : 4 + (h >> 12) % 13;
+                    for (uint16_t b=0; b < length; b++)
+                        value[b] = ((uint8_t*) buf)[4 + b % 12];
+                    sbtreePutVar(state, buf, value, length);
+                    keys[i++] = *((uint32_t*) buf);
+                }
+            }
+            sbtreeFlush(state);
+            uint32_t insertTime = elapsedMs(&start);
+            uint32_t stored = buffer->numWrites + (c ? valueLog->numWrites : 0);
+
+            srand(1);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int32_t k=0; k < 100000; k++)
+            {
+                uint32_t key = keys[rand() % i];
+                if (sbtreeGet(state, &key, recordBuffer) != 0 || sbtreeReadValue(state, recordBuffer, value) != 0)
+                    printf("Error: Failed to find: %lu\n", key);
+            }
+            uint32_t randomTime = elapsedMs(&start);
+
+            uint32_t scanTime[2];
+            for (int8_t v=0; v < 2; v++)
+            {
+                sbtreeIterator it;
+                uint32_t *itKey, minKey = keys[0], n = 0;
+                void *itData;
+                it.minKey = &minKey;
+                it.maxKey = NULL;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                sbtreeInitIterator(state, &it);
+                while (sbtreeNext(state, &it, (void**) &itKey, &itData))
+                {
+                    if (v && sbtreeReadValue(state, itData, value) != 0)
+                        printf("Error: Failed to read value: %lu\n", *itKey);
+                    n++;
+                }
+                scanTime[v] = elapsedMs(&start);
+                if (n != (uint32_t) i)
+                    printf("Error: Scan returned %lu of %lu records\n", n, i);
+            }
+
+            printf("%s\t%u\t%u\t%lu\t\t%lu\t\t%lu\t\t\t%lu\t\t%lu\n", c ? "yes" : "no", pageSizes[p], dataSizes[c],
+                (uint32_t) ((uint64_t) stored * pageSizes[p] / 1024), insertTime, randomTime, scanTime[0], scanTime[1]);
+
+            closeBuffer(buffer);
+            logStorage->storage.close((storageState*) logStorage);
+            free(state->tempKey);
+            free(recordBuffer);
+            free(state);
+            free(valueLog->buffer);
+            free(valueLog);
+            free(buffer->buffer);
+            free(buffer->pinLevel);
+            free(buffer->modified);
+            free(buffer->status);
+            free(buffer);
+            free(logStorage);
+            free(storage);
+        }
+    }
+    fclose(infile);
+    free(keys);
+}
+
+/**
+ * Reader of uwa500K format file (512 byte pages with 16 byte header and 16 byte records) for sbtreeBulkLoad().
+ * File is read numBlockPages pages at a time and records of one file page are returned per read.
+ */
+typedef struct {
+    sbtreeReader reader;
+    FILE    *file;
+    int8_t  *block;             /* Memory for numBlockPages file pages */
+    uint32_t numBlockPages;
+    uint32_t blockPages;        /* Number of pages in block */
+    uint32_t nextPage;          /* Next page in block */
+    int32_t remaining;          /* Number of records left to return */
+} uwaReader;
+
+static int32_t uwaRead(sbtreeReader *reader, void **records)
+{
+    uwaReader *r = (uwaReader*) reader;
+
+    while (r->remaining > 0)
+    {
+        if (r->nextPage == r->blockPages)
+        {
+            r->blockPages = fread(r->block, 512, r->numBlockPages, r->file);
+            r->nextPage = 0;
+            if (r->blockPages == 0)
+                return 0;
+        }
+        int8_t *page = r->block + (size_t) 512 * r->nextPage++;
+        int32_t count = *((int16_t*) (page+4));
+        if (count > r->remaining)
+            count = r->remaining;
+        if (count <= 0)
+            continue;
+        *records = page + 16;
+        r->remaining -= count;
+        return count;
+    }
+    return 0;
+}
+
+/**
+ * Compares building an index from the uwa500K data set with sbtreePut() for each record and with sbtreeBulkLoad()
+ * writing batches of 1, 16 and 64 leaves, for stdio and pread/pwrite storage at 512 B and 4 KB pages.
+ * Bulk load reads the file in 64 KB blocks. Build time includes flush to storage.
+ */
+void benchmarkBulkLoad()
+{
+    count_t pageSizes[] = {512, 4096};
+    id_t batches[] = {0, 1, 16, 64};
+    int32_t numRecords = 500000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        free(keys);
+        return;
+    }
+
+    uwaReader *r = (uwaReader*) malloc(sizeof(uwaReader));
+    r->reader.read = uwaRead;
+    r->file = infile;
+    r->numBlockPages = 128;
+    r->block = (int8_t*) malloc((size_t) 512 * r->numBlockPages);
+    r->reader.pages = malloc((size_t) 64 * 4096);
+
+    printf("\nBULK LOAD BENCHMARK\n");
+    printf("Storage\tPage\tMethod\tBatch\tBuild (ms)\tMB/s\tPage writes\tLevels\n");
+    for (int8_t s=0; s < 2; s++)
+    {
+        for (int8_t p=0; p < 2; p++)
+        {
+            for (int8_t b=0; b < 4; b++)
+            {
+                storageState *storage;
+                if (s == 0)
+                {
+                    fileStorageState *fs = (fileStorageState*) malloc(sizeof(fileStorageState));
+                    fs->fileName = "myfile.bin";
+                    storage = (storageState*) fs;
+                    if (fileStorageInit(storage) != 0)
+                    {
+                        printf("Error: Cannot initialize storage!\n");
+                        return;
+                    }
+                }
+                else
+                {
+                    fdStorageState *fs = (fdStorageState*) malloc(sizeof(fdStorageState));
+                    fs->fileName = "myfile.bin";
+                    fs->direct = 0;
+                    fs->alignedBuffer = NULL;
+                    storage = (storageState*) fs;
+                    if (fdStorageInit(storage) != 0)
+                    {
+                        printf("Error: Cannot initialize storage!\n");
+                        return;
+                    }
+                }
+
+                dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+                buffer->pageSize = pageSizes[p];
+                buffer->numPages = M;
+                buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+                buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->hashTable = NULL;
+                buffer->policy = NULL;
+                buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+                buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+                buffer->storage = storage;
+
+                sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+                state->keySize = 4;
+                state->dataSize = 12;
+                state->parameters = 0;
+                state->spline = NULL;
+                state->checkpoint = NULL;
+                state->valueLog = NULL;
+                state->readAhead = NULL;
+                state->aggregate = NULL;
+                state->bitmap = NULL;
+                state->bloomFilter = NULL;
+                state->buffer = buffer;
+                state->tempKey = malloc(sizeof(int32_t));
+                int8_t* recordBuffer = (int8_t*) malloc(state->dataSize);
+                sbtreeInit(state);
+
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                fseek(infile, 0, SEEK_SET);
+                int32_t i = 0;
+                if (batches[b] == 0)
+                {
+                    while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+                    {
+                        int16_t count = *((int16_t*) (infileBuffer+4));
+                        for (int j=0; j < count && i < numRecords; j++)
+                        {
+                            void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                            sbtreePut(state, buf, (void*) (buf + 4));
+                            keys[i++] = *((uint32_t*) buf);
+                        }
+                    }
+                }
+                else
+                {
+                    r->reader.numPages = batches[b];
+                    r->blockPages = 0;
+                    r->nextPage = 0;
+                    r->remaining = numRecords;
+                    if (sbtreeBulkLoad(state, (sbtreeReader*) r) != 0)
+                        printf("Error: Bulk load failed\n");
+                    i = numRecords - r->remaining;
+                }
+                sbtreeFlush(state);
+                uint32_t buildTime = elapsedMs(&start);
+
+                /* Keys were recorded by put */
+                int32_t errors = 0;
+                srand(1);
+                for (int32_t k=0; k < 10000; k++)
+                {
+                    uint32_t key = keys[rand() % i];
+                    if (sbtreeGet(state, &key, recordBuffer) != 0)
+                        errors++;
+                }
+                if (errors > 0)
+                    printf("Error: %lu keys not found\n", errors);
+
+                printf("%s\t%u\t%s\t%lu\t%lu\t\t%lu\t%lu\t\t%u\n", s ? "pwrite" : "stdio", pageSizes[p], batches[b] ? "bulk" : "put",
+                    batches[b], buildTime, buildTime > 0 ? (uint32_t) ((uint64_t) i * state->recordSize / 1000 / buildTime) : 0,
+                    buffer->numWrites, state->levels);
+
+                closeBuffer(buffer);
+                free(state->tempKey);
+                free(recordBuffer);
+                free(state);
+                free(buffer->buffer);
+                free(buffer->pinLevel);
+                free(buffer->modified);
+                free(buffer->status);
+                free(buffer);
+                free(storage);
+            }
+        }
+    }
+    fclose(infile);
+    free(r->reader.pages);
+    free(r->block);
+    free(r);
+    free(keys);
+}
+
+/**
+ * Compares "last N readings before time t" queries on the uwa500K data set scanning forward from an estimated
+ * start key (twice the average key gap times N, doubled until N records are found) and with the reverse iterator.
+ * Reports page reads and time for 1000 random t and N of 10, 100 and 1000.
+ */
+void benchmarkReverseIterator()
+{
+    int32_t numRecords = 500000;
+    uint32_t lastN[] = {10, 100, 1000};
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        free(keys);
+        return;
+    }
+
+    fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+    storage->fileName = "myfile.bin";
+    if (fileStorageInit((storageState*) storage) != 0)
+    {
+        printf("Error: Cannot initialize storage!\n");
+        return;
+    }
+
+    dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+    buffer->pageSize = 512;
+    buffer->numPages = M;
+    buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+    buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->hashTable = NULL;
+    buffer->policy = NULL;
+    buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+    buffer->storage = (storageState*) storage;
+
+    sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->parameters = SBTREE_USE_INTERPOLATION;
+    state->spline = NULL;
+    state->checkpoint = NULL;
+    state->valueLog = NULL;
+    state->readAhead = NULL;
+    state->aggregate = NULL;
+    state->bitmap = NULL;
+    state->bloomFilter = NULL;
+    state->buffer = buffer;
+    state->tempKey = malloc(sizeof(int32_t));
+    sbtreeInit(state);
+
+    int32_t i = 0;
+    while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+    {
+        int16_t count = *((int16_t*) (infileBuffer+4));
+        for (int j=0; j < count && i < numRecords; j++)
+        {
+            void *buf = (infileBuffer + headerSize + j*state->recordSize);
+            sbtreePut(state, buf, (void*) (buf + 4));
+            keys[i++] = *((uint32_t*) buf);
+        }
+    }
+    sbtreeFlush(state);
+    uint32_t avgGap = (keys[i-1] - keys[0]) / (i-1) + 1;
+
+    printf("\nREVERSE ITERATOR BENCHMARK\n");
+    printf("N\tForward reads\tForward (ms)\tReverse reads\tReverse (ms)\n");
+    for (int8_t n=0; n < 3; n++)
+    {
+        uint32_t reads[2], times[2], oldest[1000], errors = 0;
+        for (int8_t r=0; r < 2; r++)
+        {
+            sbtreeIterator it;
+            uint32_t *itKey, minKey, maxKey, found;
+            void *itData;
+
+            srand(1);
+            id_t numReads = buffer->numReads;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int32_t k=0; k < 1000; k++)
+            {
+                maxKey = keys[lastN[n] + rand() % (i - lastN[n])];
+                it.maxKey = &maxKey;
+                if (r == 0)
+                {   /* Scan forward from estimated start. Oldest of last N records is N-1 records before end of scan. */
+                    uint32_t window = 2 * lastN[n] * avgGap, ring[1000];
+                    while (1)
+                    {
+                        minKey = maxKey > window ? maxKey - window : 0;
+                        it.minKey = &minKey;
+                        found = 0;
+                        sbtreeInitIterator(state, &it);
+                        while (sbtreeNext(state, &it, (void**) &itKey, &itData))
+                            ring[found++ % lastN[n]] = *itKey;
+                        if (found >= lastN[n] || minKey == 0)
+                            break;
+                        window *= 2;
+                    }
+                    oldest[k] = ring[found % lastN[n]];
+                }
+                else
+                {
+                    it.minKey = NULL;
+                    found = 0;
+                    sbtreeInitReverseIterator(state, &it);
+                    while (found < lastN[n] && sbtreePrev(state, &it, (void**) &itKey, &itData))
+                        found++;
+                    if (found != lastN[n] || *itKey != oldest[k])
+                        errors++;
+                }
+            }
+            times[r] = elapsedMs(&start);
+            reads[r] = buffer->numReads - numReads;
+        }
+        if (errors > 0)
+            printf("Error: %lu queries differ\n", errors);
+        printf("%lu\t%lu\t\t%lu\t\t%lu\t\t%lu\n", lastN[n], reads[0], times[0], reads[1], times[1]);
+    }
+
+    closeBuffer(buffer);
+    fclose(infile);
+    free(state->tempKey);
+    free(state);
+    free(buffer->buffer);
+    free(buffer->pinLevel);
+    free(buffer->modified);
+    free(buffer->status);
+    free(buffer);
+    free(storage);
+    free(keys);
+}
+
+/**
+ * Compares sliding window queries on the uwa500K data set with an iterator initialized for each window and
+ * one iterator moved to each window with sbtreeIteratorSeek(). Windows of W records advance by W/2 records
+ * (overlapping windows) or jump ahead by 20 windows. Reports page reads, buffer hits and time for 2000 windows.
+ */
+void benchmarkIteratorSeek()
+{
+    int32_t numRecords = 500000;
+    uint32_t width[] = {10, 100, 1000}, numWindows = 2000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        free(keys);
+        return;
+    }
+
+    fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+    storage->fileName = "myfile.bin";
+    if (fileStorageInit((storageState*) storage) != 0)
+    {
+        printf("Error: Cannot initialize storage!\n");
+        return;
+    }
+
+    dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+    buffer->pageSize = 512;
+    buffer->numPages = M;
+    buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+    buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->hashTable = NULL;
+    buffer->policy = NULL;
+    buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+    buffer->storage = (storageState*) storage;
+
+    sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->parameters = SBTREE_USE_INTERPOLATION;
+    state->spline = NULL;
+    state->checkpoint = NULL;
+    state->valueLog = NULL;
+    state->readAhead = NULL;
+    state->aggregate = NULL;
+    state->bitmap = NULL;
+    state->bloomFilter = NULL;
+    state->buffer = buffer;
+    state->tempKey = malloc(sizeof(int32_t));
+    sbtreeInit(state);
+
+    int32_t i = 0;
+    while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+    {
+        int16_t count = *((int16_t*) (infileBuffer+4));
+        for (int j=0; j < count && i < numRecords; j++)
+        {
+            void *buf = (infileBuffer + headerSize + j*state->recordSize);
+            sbtreePut(state, buf, (void*) (buf + 4));
+            keys[i++] = *((uint32_t*) buf);
+        }
+    }
+    sbtreeFlush(state);
+
+    printf("\nITERATOR SEEK BENCHMARK\n");
+    printf("W\tStep\tInit reads\tInit hits\tInit (ms)\tSeek reads\tSeek hits\tSeek (ms)\n");
+    for (int8_t w=0; w < 3; w++)
+    {
+        for (int8_t s=0; s < 2; s++)
+        {
+            uint32_t step = s == 0 ? width[w] / 2 : width[w] * 20, reads[2], hits[2], times[2], total[2];
+            for (int8_t r=0; r < 2; r++)
+            {
+                sbtreeIterator it;
+                uint32_t *itKey, minKey, maxKey, pos = 0;
+                void *itData;
+
+                it.minKey = &minKey;
+                it.maxKey = &maxKey;
+                total[r] = 0;
+                id_t numReads = buffer->numReads, bufferHits = buffer->bufferHits;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for (uint32_t k=0; k < numWindows; k++, pos = (pos + step) % (i - width[w]))
+                {
+                    minKey = keys[pos];
+                    maxKey = keys[pos + width[w] - 1];
+                    if (r == 0 || k == 0)
+                        sbtreeInitIterator(state, &it);
+                    else
+                        sbtreeIteratorSeek(state, &it, &minKey);
+                    while (sbtreeNext(state, &it, (void**) &itKey, &itData))
+                        total[r]++;
+                }
+                times[r] = elapsedMs(&start);
+                reads[r] = buffer->numReads - numReads;
+                hits[r] = buffer->bufferHits - bufferHits;
+            }
+            if (total[0] != total[1])
+                printf("Error: %lu records with init and %lu with seek\n", total[0], total[1]);
+            printf("%lu\t%lu\t%lu\t\t%lu\t\t%lu\t\t%lu\t\t%lu\t\t%lu\n", width[w], step, reads[0], hits[0], times[0], reads[1], hits[1], times[1]);
+        }
+    }
+
+    closeBuffer(buffer);
+    fclose(infile);
+    free(state->tempKey);
+    free(state);
+    free(buffer->buffer);
+    free(buffer->pinLevel);
+    free(buffer->modified);
+    free(buffer->status);
+    free(buffer);
+    free(storage);
+    free(keys);
+}
+
+/**
+ * Compares range scans on the uwa500K data set with leaf read-ahead of 0 (disabled), 4, 16 and 64 pages using
+ * pread/pwrite storage with and without O_DIRECT (4 KB pages). Reports storage read requests and time for
+ * a full scan and 100 random ranges of 20000 records.
+ */
+void benchmarkLeafReadAhead()
+{
+    const char* names[] = {"fdStorage", "fdStorage direct"};
+    id_t readAheadPages[] = {0, 4, 16, 64};
+    int32_t numRecords = 500000, rangeSize = 20000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        free(keys);
+        return;
+    }
+
+    printf("\nLEAF READ-AHEAD BENCHMARK\n");
+    printf("Storage\t\t\tPages\tScan requests\tScan (ms)\tRange requests\tRange (ms)\n");
+
+    for (int8_t t=0; t < 2; t++)
+    {
+        void *alignedBuffer = NULL;
+        fdStorageState *storage = (fdStorageState*) malloc(sizeof(fdStorageState));
+        storage->fileName = "myfile.bin";
+        storage->direct = t == 1;
+        storage->alignedBuffer = NULL;
+        if (storage->direct && posix_memalign(&alignedBuffer, FD_STORAGE_ALIGNMENT, 4096) == 0)
+            storage->alignedBuffer = alignedBuffer;
+        if (fdStorageInit((storageState*) storage) != 0)
+        {
+            printf("%-16s\tNot supported\n", names[t]);
+            free(storage);
+            free(alignedBuffer);
+            continue;
+        }
+
+        dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+        buffer->pageSize = 4096;
+        buffer->numPages = M;
+        buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+        buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+        buffer->hashTable = NULL;
+        buffer->policy = NULL;
+        buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+        if (posix_memalign(&buffer->buffer, FD_STORAGE_ALIGNMENT, (size_t) buffer->numPages * buffer->pageSize) != 0)
+            buffer->buffer = malloc((size_t) buffer->numPages * buffer->pageSize);
+        buffer->storage = (storageState*) storage;
+
+        /* Aligned frames so direct I/O reads all pages with one request */
+        sbtreeReadAhead *readAhead = (sbtreeReadAhead*) malloc(sizeof(sbtreeReadAhead));
+        if (posix_memalign(&readAhead->pages, FD_STORAGE_ALIGNMENT, (size_t) 64 * buffer->pageSize) != 0)
+            readAhead->pages = malloc((size_t) 64 * buffer->pageSize);
+
+        sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+        state->keySize = 4;
+        state->dataSize = 12;
+        state->parameters = SBTREE_USE_INTERPOLATION;
+        state->spline = NULL;
+        state->checkpoint = NULL;
+        state->valueLog = NULL;
+        state->readAhead = NULL;
+        state->aggregate = NULL;
+        state->bitmap = NULL;
+        state->bloomFilter = NULL;
+        state->buffer = buffer;
+        state->tempKey = malloc(sizeof(int32_t));
+        sbtreeInit(state);
+
+        int32_t i = 0;
+        fseek(infile, 0, SEEK_SET);
+        while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+        {
+            int16_t count = *((int16_t*) (infileBuffer+4));
+            for (int j=0; j < count && i < numRecords; j++)
+            {
+                void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                sbtreePut(state, buf, (void*) (buf + 4));
+                keys[i++] = *((uint32_t*) buf);
+            }
+        }
+        sbtreeFlush(state);
+
+        uint32_t records[2];
+        for (int8_t r=0; r < 4; r++)
+        {
+            uint32_t requests[2], times[2];
+            state->readAhead = r == 0 ? NULL : readAhead;
+            readAhead->numPages = readAheadPages[r];
+            readAhead->count = 0;
+            for (int8_t q=0; q < 2; q++)
+            {
+                sbtreeIterator it;
+                uint32_t *itKey, minKey, maxKey, total = 0;
+                void *itData;
+
+                srand(1);
+                readAhead->numRequests = 0;
+                readAhead->numReads = 0;
+                id_t numReads = buffer->numReads;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for (int32_t k=0; k < (q == 0 ? 1 : 100); k++)
+                {
+                    int32_t first = q == 0 ? 0 : rand() % (i - rangeSize);
+                    minKey = keys[first];
+                    maxKey = keys[q == 0 ? i-1 : first + rangeSize - 1];
+                    it.minKey = &minKey;
+                    it.maxKey = &maxKey;
+                    sbtreeInitIterator(state, &it);
+                    while (sbtreeNext(state, &it, (void**) &itKey, &itData))
+                        total++;
+                }
+                times[q] = elapsedMs(&start);
+                /* Pages read by read-ahead are counted once per request */
+                requests[q] = buffer->numReads - numReads - readAhead->numReads + readAhead->numRequests;
+                if (r == 0)
+                    records[q] = total;
+                else if (total != records[q])
+                    printf("Error: %lu records with read-ahead and %lu without\n", total, records[q]);
+            }
+            printf("%-16s\t%lu\t%lu\t\t%lu\t\t%lu\t\t%lu\n", names[t], readAheadPages[r], requests[0], times[0], requests[1], times[1]);
+        }
+
+        closeBuffer(buffer);
+        free(state->tempKey);
+        free(state);
+        free(readAhead->pages);
+        free(readAhead);
+        free(buffer->buffer);
+        free(buffer->pinLevel);
+        free(buffer->modified);
+        free(buffer->status);
+        free(buffer);
+        free(storage);
+        free(alignedBuffer);
+    }
+    fclose(infile);
+    free(keys);
+}
+
+/**
+ * Compares range sums over the first data column of the uwa500K data set computed by an iterator scan and by
+ * sbtreeAggregate() using child summaries in interior nodes. Reports page reads and time for 200 random ranges of each width.
+ */
+void benchmarkAggregate()
+{
+    int32_t numRecords = 500000;
+    uint32_t width[] = {100, 10000, 100000, 500000}, numRanges = 200;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    uint32_t *keys = (uint32_t*) malloc(sizeof(uint32_t)*numRecords);
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        free(keys);
+        return;
+    }
+
+    fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+    storage->fileName = "myfile.bin";
+    if (fileStorageInit((storageState*) storage) != 0)
+    {
+        printf("Error: Cannot initialize storage!\n");
+        return;
+    }
+
+    dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+    buffer->pageSize = 512;
+    buffer->numPages = M;
+    buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+    buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->hashTable = NULL;
+    buffer->policy = NULL;
+    buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+    buffer->storage = (storageState*) storage;
+
+    sbtreeAggregateColumn *aggregate = (sbtreeAggregateColumn*) malloc(sizeof(sbtreeAggregateColumn));
+    aggregate->offset = 0;
+    aggregate->size = 4;
+
+    sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->parameters = SBTREE_USE_INTERPOLATION;
+    state->spline = NULL;
+    state->checkpoint = NULL;
+    state->valueLog = NULL;
+    state->readAhead = NULL;
+    state->aggregate = aggregate;
+    state->bitmap = NULL;
+    state->bloomFilter = NULL;
+    state->buffer = buffer;
+    state->tempKey = malloc(sizeof(int32_t));
+    sbtreeInit(state);
+
+    int32_t i = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+    {
+        int16_t count = *((int16_t*) (infileBuffer+4));
+        for (int j=0; j < count && i < numRecords; j++)
+        {
+            void *buf = (infileBuffer + headerSize + j*state->recordSize);
+            sbtreePut(state, buf, (void*) (buf + 4));
+            keys[i++] = *((uint32_t*) buf);
+        }
+    }
+    sbtreeFlush(state);
+
+    printf("\nAGGREGATE BENCHMARK\n");
+    printf("Insert: %lu ms  Levels: %d  Interior keys per node: %d  Nodes: %lu\n", elapsedMs(&start), state->levels, state->maxInteriorRecordsPerPage, state->numNodes);
+    printf("Width\tScan reads\tScan (ms)\tAggregate reads\tAggregate (ms)\n");
+    for (int8_t w=0; w < 4; w++)
+    {
+        uint32_t reads[2], times[2], pos = 0;
+        int64_t sum[2];
+        for (int8_t r=0; r < 2; r++)
+        {
+            sbtreeIterator it;
+            sbtreeSummary summary;
+            uint32_t *itKey, minKey, maxKey;
+            void *itData;
+
+            srand(1);
+            sum[r] = 0;
+            id_t numReads = buffer->numReads;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (uint32_t k=0; k < numRanges; k++)
+            {
+                pos = i > width[w] ? rand() % (i - width[w] + 1) : 0;
+                minKey = keys[pos];
+                maxKey = keys[pos + (width[w] < i ? width[w] : i) - 1];
+                if (r == 0)
+                {
+                    it.minKey = &minKey;
+                    it.maxKey = &maxKey;
+                    sbtreeInitIterator(state, &it);
+                    while (sbtreeNext(state, &it, (void**) &itKey, &itData))
+                        sum[r] += *((int32_t*) itData);
+                }
+                else if (sbtreeAggregate(state, &minKey, &maxKey, &summary) == 0)
+                    sum[r] += summary.sum;
+            }
+            times[r] = elapsedMs(&start);
+            reads[r] = buffer->numReads - numReads;
+        }
+        if (sum[0] != sum[1])
+            printf("Error: sum %lld with scan and %lld with aggregate\n", (long long) sum[0], (long long) sum[1]);
+        printf("%lu\t%lu\t\t%lu\t\t%lu\t\t%lu\n", width[w], reads[0], times[0], reads[1], times[1]);
+    }
+
+    closeBuffer(buffer);
+    fclose(infile);
+    free(state->tempKey);
+    free(state);
+    free(aggregate);
+    free(buffer->buffer);
+    free(buffer->pinLevel);
+    free(buffer->modified);
+    free(buffer->status);
+    free(buffer);
+    free(storage);
+    free(keys);
+}
+
+/**
+ * Compares value range queries over the first data column of the uwa500K data set using an iterator scan that checks
+ * each record and an iterator filter using per-leaf bitmaps. Reports page reads and time for 20 random value ranges of
+ * each selectivity (fraction of the value domain).
+ */
+void benchmarkBitmapFilter()
+{
+    int32_t numRecords = 500000;
+    uint32_t selectivity[] = {1, 5, 10, 25, 50, 100}, numRanges = 20;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+    storage->fileName = "myfile.bin";
+    if (fileStorageInit((storageState*) storage) != 0)
+    {
+        printf("Error: Cannot initialize storage!\n");
+        return;
+    }
+
+    dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+    buffer->pageSize = 512;
+    buffer->numPages = M;
+    buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+    buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->hashTable = NULL;
+    buffer->policy = NULL;
+    buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+    buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+    buffer->storage = (storageState*) storage;
+
+    /* Bitmap buckets cover the value range of the column */
+    sbtreeBitmap *bitmap = (sbtreeBitmap*) malloc(sizeof(sbtreeBitmap));
+    bitmap->offset = 0;
+    bitmap->size = 4;
+    bitmap->bitmapSize = 8;
+    int32_t i = 0, minValue = 0, maxValue = 0;
+    while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+    {
+        int16_t count = *((int16_t*) (infileBuffer+4));
+        for (int j=0; j < count && i < numRecords; j++, i++)
+        {
+            int32_t value = *((int32_t*) (infileBuffer + headerSize + j*16 + 4));
+            if (i == 0 || value < minValue)
+                minValue = value;
+            if (i == 0 || value > maxValue)
+                maxValue = value;
+        }
+    }
+    bitmap->minValue = minValue;
+    bitmap->maxValue = maxValue;
+
+    sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->parameters = SBTREE_USE_INTERPOLATION;
+    state->spline = NULL;
+    state->checkpoint = NULL;
+    state->valueLog = NULL;
+    state->readAhead = NULL;
+    state->aggregate = NULL;
+    state->bitmap = bitmap;
+    state->bloomFilter = NULL;
+    state->buffer = buffer;
+    state->tempKey = malloc(sizeof(int32_t));
+    sbtreeInit(state);
+
+    i = 0;
+    fseek(infile, 0, SEEK_SET);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+    {
+        int16_t count = *((int16_t*) (infileBuffer+4));
+        for (int j=0; j < count && i < numRecords; j++, i++)
+        {
+            void *buf = (infileBuffer + headerSize + j*state->recordSize);
+            sbtreePut(state, buf, (void*) (buf + 4));
+        }
+    }
+    sbtreeFlush(state);
+
+    printf("\nBITMAP FILTER BENCHMARK\n");
+    printf("Insert: %lu ms  Levels: %d  Interior keys per node: %d  Nodes: %lu  Values: %ld-%ld\n", elapsedMs(&start), state->levels,
+        state->maxInteriorRecordsPerPage, state->numNodes, (long) minValue, (long) maxValue);
+    printf("Selectivity\tRecords\tScan reads\tScan (ms)\tFilter reads\tFilter (ms)\n");
+    for (int8_t s=0; s < 6; s++)
+    {
+        uint32_t reads[2], times[2], found[2];
+        int32_t width = (int32_t) ((int64_t) (maxValue - minValue) * selectivity[s] / 100);
+        for (int8_t r=0; r < 2; r++)
+        {
+            sbtreeIterator it;
+            uint32_t *itKey;
+            int32_t *itData, minData, maxData;
+
+            srand(1);
+            found[r] = 0;
+            id_t numReads = buffer->numReads;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (uint32_t k=0; k < numRanges; k++)
+            {
+                minData = minValue + rand() % (maxValue - minValue - width + 1);
+                maxData = minData + width;
+                it.minKey = NULL;
+                it.maxKey = NULL;
+                it.minData = r == 0 ? NULL : &minData;
+                it.maxData = r == 0 ? NULL : &maxData;
+                sbtreeInitIterator(state, &it);
+                while (sbtreeNext(state, &it, (void**) &itKey, (void**) &itData))
+                {
+                    if (*itData >= minData && *itData <= maxData)
+                        found[r]++;
+                }
+            }
+            times[r] = elapsedMs(&start);
+            reads[r] = buffer->numReads - numReads;
+        }
+        if (found[0] != found[1])
+            printf("Error: %lu records with scan and %lu with filter\n", found[0], found[1]);
+        printf("%lu%%\t\t%lu\t%lu\t\t%lu\t\t%lu\t\t%lu\n", selectivity[s], found[0] / numRanges, reads[0], times[0], reads[1], times[1]);
+    }
+
+    closeBuffer(buffer);
+    fclose(infile);
+    free(state->tempKey);
+    free(state);
+    free(bitmap);
+    free(buffer->buffer);
+    free(buffer->pinLevel);
+    free(buffer->modified);
+    free(buffer->status);
+    free(buffer);
+    free(storage);
+}
+
+/**
+ * Compares random key lookups (as queryType 2, mostly keys not in the uwa500K data set) without and with leaf Bloom
+ * filters of 8 to 64 bytes (2 to 16 bits per key). Reports leaf reads skipped, false positive rate, page reads and time.
+ */
+void benchmarkBloomFilter()
+{
+    int32_t numRecords = 500000;
+    uint16_t filterSizes[] = {0, 8, 16, 32, 64};
+    uint32_t numLookups = 100000, maxPages = 20000;
+    char infileBuffer[512];
+    int8_t headerSize = 16;
+    count_t M = 4;
+    struct timespec start;
+
+    FILE *infile = fopen("data/uwa500K.bin", "r+b");
+    if (infile == NULL)
+    {
+        printf("Error: Cannot open data/uwa500K.bin\n");
+        return;
+    }
+
+    sbtreeBloomFilter *bloomFilter = (sbtreeBloomFilter*) malloc(sizeof(sbtreeBloomFilter));
+    bloomFilter->maxPages = maxPages;
+    bloomFilter->filters = malloc((size_t) maxPages * filterSizes[4]);
+
+    printf("\nBLOOM FILTER BENCHMARK\n");
+    printf("Filter bytes\tBits/key\tHashes\tNot found\tSkipped\tFalse pos (%%)\tReads\tTime (ms)\n");
+    for (int8_t f=0; f < 5; f++)
+    {
+        fileStorageState *storage = (fileStorageState*) malloc(sizeof(fileStorageState));
+        storage->fileName = "myfile.bin";
+        if (fileStorageInit((storageState*) storage) != 0)
+        {
+            printf("Error: Cannot initialize storage!\n");
+            return;
+        }
+
+        dbbuffer* buffer = (dbbuffer*) malloc(sizeof(dbbuffer));
+        buffer->pageSize = 512;
+        buffer->numPages = M;
+        buffer->status = (id_t*) malloc(sizeof(id_t)*M);
+        buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+        buffer->hashTable = NULL;
+        buffer->policy = NULL;
+        buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
+        buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);
+        buffer->storage = (storageState*) storage;
+
+        bloomFilter->filterSize = filterSizes[f];
+
+        sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
+        state->keySize = 4;
+        state->dataSize = 12;
+        state->parameters = SBTREE_USE_INTERPOLATION;
+        state->spline = NULL;
+        state->checkpoint = NULL;
+        state->valueLog = NULL;
+        state->readAhead = NULL;
+        state->aggregate = NULL;
+        state->bitmap = NULL;
+        state->bloomFilter = filterSizes[f] > 0 ? bloomFilter : NULL;
+        state->buffer = buffer;
+        state->tempKey = malloc(sizeof(int32_t));
+        sbtreeInit(state);
+
+        int32_t i = 0, minKey = 0, maxKey = 0;
+        fseek(infile, 0, SEEK_SET);
+        while (i < numRecords && fread(infileBuffer, 512, 1, infile) != 0)
+        {
+            int16_t count = *((int16_t*) (infileBuffer+4));
+            for (int j=0; j < count && i < numRecords; j++, i++)
+            {
+                void *buf = (infileBuffer + headerSize + j*state->recordSize);
+                sbtreePut(state, buf, (void*) (buf + 4));
+                if (i == 0)
+                    minKey = *((int32_t*) buf);
+                maxKey = *((int32_t*) buf);
+            }
+        }
+        sbtreeFlush(state);
+        if (state->bloomFilter != NULL && state->buffer->nextPageWriteId > maxPages)
+            printf("Error: %lu pages written but filters for %lu\n", state->buffer->nextPageWriteId, maxPages);
+
+        /* Random keys in key range. Most are not in data set. */
+        uint32_t notFound = 0;
+        id_t numReads = buffer->numReads;
+        int8_t recordBuffer[12];
+        srand(1);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t k=0; k < numLookups; k++)
+        {
+            double scaled = ((double)rand()*(double)rand())/RAND_MAX/RAND_MAX;
+            int32_t key = (maxKey - minKey + 1)*scaled + minKey;
+            if (sbtreeGet(state, &key, recordBuffer) != 0)
+                notFound++;
+        }
+        uint32_t time = elapsedMs(&start);
+
+        if (state->bloomFilter == NULL)
+            printf("none\t\t0\t\t0\t%lu\t\t0\t-\t\t%lu\t%lu\n", notFound, buffer->numReads - numReads, time);
+        else
+            printf("%u\t\t%.1f\t\t%d\t%lu\t\t%lu\t%.2f\t\t%lu\t%lu\n", filterSizes[f], filterSizes[f]*8.0/state->maxRecordsPerPage, bloomFilter->numHashes,
+                notFound, bloomFilter->numSkipped, 100.0*bloomFilter->numFalsePositives/notFound, buffer->numReads - numReads, time);
+
+        closeBuffer(buffer);
+        free(state->tempKey);
+        free(state);
+        free(buffer->buffer);
+        free(buffer->pinLevel);
+        free(buffer->modified);
+        free(buffer->status);
+        free(buffer);
+        free(storage);
+    }
+
+    fclose(infile);
+    free(bloomFilter->filters);
+    free(bloomFilter);
+}
+
 /**
  * Runs all tests and collects benchmarks
  */ 
@@ -144,8 +3395,12 @@ void runalltests_sbtree()
         buffer->numPages = M;
         buffer->status = (id_t*) malloc(sizeof(id_t)*M);
         buffer->modified = (uint8_t*) malloc(sizeof(uint8_t)*M);
+        buffer->hashTable = (count_t*) malloc(sizeof(count_t)*dbbufferHashSize(M));
         buffer->buffer  = malloc((size_t) buffer->numPages * buffer->pageSize);   
         buffer->storage = (storageState*) storage;       
+        buffer->policy = NULL;
+        buffer->policyData = NULL;
+        buffer->pinLevel = (uint8_t*) malloc(sizeof(uint8_t)*M);
 
         /* Configure SBTree state */
         sbtreeState* state = (sbtreeState*) malloc(sizeof(sbtreeState));
@@ -153,6 +3408,14 @@ void runalltests_sbtree()
         state->recordSize = 16;
         state->keySize = 4;
         state->dataSize = 12;           
+        state->parameters = 0;
+        state->spline = NULL;
+        state->checkpoint = NULL;
+        state->valueLog = NULL;
+        state->readAhead = NULL;
+        state->aggregate = NULL;
+        state->bitmap = NULL;
+        state->bloomFilter = NULL;
         state->buffer = buffer;
 
         state->tempKey = malloc(sizeof(int32_t)); 
@@ -397,6 +3660,10 @@ doneread:
         
         /* Optional: test iterator */
         // testIterator(state);
+        // testReverseIterator(state);
+        // testIteratorSeek(state);
+        // testAggregate(state);		/* Requires state->aggregate with offset 0 and size 4 */
+        // testBitmapFilter(state);		/* Requires state->bitmap with offset 0 and size 4 */
 
         /* Clean up and free memory */
         closeBuffer(buffer);    
@@ -405,6 +3672,9 @@ doneread:
         free(recordBuffer);
 
         free(buffer->status);
+        free(buffer->modified);
+        free(buffer->hashTable);
+        free(buffer->pinLevel);
         free(state->buffer->buffer);
         free(buffer);
         free(state);
@@ -488,4 +3758,73 @@ doneread:
 void main()
 {
 	runalltests_sbtree();
+
+	/* Optional: benchmark buffer page lookup */
+	// benchmarkBufferLookup();
+
+	/* Optional: compare buffer replacement policies */
+	// benchmarkBufferPolicies();
+
+	/* Optional: benchmark key search within a node */
+	// benchmarkNodeSearch();
+
+	/* Optional: compare interpolation and binary search probes per lookup */
+	// benchmarkInterpolationSearch();
+
+	/* Optional: compare page reads per query with spline leaf predictor */
+	// benchmarkSplineIndex();
+
+	/* Optional: compare batched and single key lookups */
+	// benchmarkGetBatch();
+
+	/* Optional: compare stdio and pread/pwrite file storage */
+	// benchmarkStorage();
+
+	/* Optional: compare synchronous and io_uring storage at queue depths 1 to 64 */
+	// benchmarkAsyncStorage();
+
+	/* Optional: compare pread/pwrite and memory-mapped storage with zero-copy reads */
+	// benchmarkMmapStorage();
+
+	/* Optional: compare rebuilding index with reopening synced index */
+	// benchmarkReopen();
+
+	/* Optional: compare checkpoint intervals (build writes and crash recovery) */
+	// benchmarkCheckpoint();
+
+	/* Optional: measure page checksum overhead at 512 B, 4 KB and 16 KB pages */
+	// benchmarkChecksum();
+
+	/* Optional: compare leaf pages with and without delta compressed keys */
+	// benchmarkDeltaKeys();
+
+	/* Optional: compare storage size and query time with compressed page storage */
+	// benchmarkCompressStorage();
+
+	/* Optional: compare interior fanout with prefix truncated separators for wide keys */
+	// benchmarkPrefixKeys();
+
+	/* Optional: compare padded variable-length values with a value log */
+	// benchmarkValueLog();
+
+	/* Optional: compare building index with put and with bulk load */
+	// benchmarkBulkLoad();
+
+	/* Optional: compare last N records queries with forward scan and reverse iterator */
+	// benchmarkReverseIterator();
+
+	/* Optional: compare sliding window queries initializing an iterator per window and seeking one iterator */
+	// benchmarkIteratorSeek();
+
+	/* Optional: compare range scans with leaf read-ahead of 4 to 64 pages */
+	// benchmarkLeafReadAhead();
+
+	/* Optional: compare range sums with iterator scans and with child summaries in interior nodes */
+	// benchmarkAggregate();
+
+	/* Optional: compare value range queries with iterator scans and with per-leaf bitmap filters */
+	// benchmarkBitmapFilter();
+
+	/* Optional: compare lookups of keys not in tree without and with leaf Bloom filters */
+	// benchmarkBloomFilter();
 }  
\ No newline at end of file
@@ -0,0 +1,209 @@
+/******************************************************************************/
+/**
+@file		test_sbtree.cpp
+@author		Ramon Lawrence
+@brief		Compares performance of the C API and the C++ SBTree template
+            front-end on the insert/query benchmark.
+@copyright	Copyright 2021
+			The University of British Columbia,
+            Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <time.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "sbtree.hpp"
+#include "fileStorage.h"
+
+#define PAGE_SIZE	512
+#define NUM_PAGES	3
+
+struct sensorData
+{
+	int32_t values[3];
+};
+
+/**
+ * Reads up to numRecords records from data file. Returns number of records read.
+ */
+static int32_t loadRecords(const char *fileName, uint32_t *keys, sensorData *data, int32_t numRecords)
+{
+	char infileBuffer[PAGE_SIZE];
+	int8_t headerSize = 16;
+	int32_t i = 0;
+
+	FILE *infile = fopen(fileName, "r+b");
+	if (infile == NULL)
+		return 0;
+
+	while (i < numRecords && fread(infileBuffer, PAGE_SIZE, 1, infile) != 0)
+	{
+		int16_t count = *((int16_t*) (infileBuffer+4));
+		for (int j=0; j < count && i < numRecords; j++, i++)
+		{
+			memcpy(&keys[i], infileBuffer + headerSize + j*16, sizeof(uint32_t));
+			memcpy(&data[i], infileBuffer + headerSize + j*16 + 4, sizeof(sensorData));
+		}
+	}
+	fclose(infile);
+	return i;
+}
+
+/**
+ * Insert and query all records using C API.
+ */
+static void runC(uint32_t *keys, sensorData *data, int32_t numRecords)
+{
+	fileStorageState storage;
+	storage.fileName = (char*) "myfile.bin";
+	if (fileStorageInit((storageState*) &storage) != 0)
+	{
+		printf("Error: Cannot initialize storage!\n");
+		return;
+	}
+
+	static id_t status[NUM_PAGES];
+	static uint8_t modified[NUM_PAGES], pinLevel[NUM_PAGES];
+	static uint8_t pages[NUM_PAGES*PAGE_SIZE];
+	dbbuffer buffer;
+	buffer.pageSize = PAGE_SIZE;
+	buffer.numPages = NUM_PAGES;
+	buffer.status = status;
+	buffer.modified = modified;
+	buffer.buffer = pages;
+	buffer.hashTable = NULL;
+	buffer.policy = NULL;
+	buffer.policyData = NULL;
+	buffer.pinLevel = pinLevel;
+	buffer.storage = (storageState*) &storage;
+
+	sbtreeState state;
+	uint32_t tempKey;
+	state.keySize = sizeof(uint32_t);
+	state.dataSize = sizeof(sensorData);
+	state.parameters = 0;
+	state.spline = NULL;
+	state.checkpoint = NULL;
+	state.valueLog = NULL;
+	state.readAhead = NULL;
+	state.aggregate = NULL;
+	state.bitmap = NULL;
+	state.bloomFilter = NULL;
+	state.buffer = &buffer;
+	state.tempKey = &tempKey;
+	sbtreeInit(&state);
+
+	clock_t start = clock();
+	for (int32_t i=0; i < numRecords; i++)
+		sbtreePut(&state, &keys[i], &data[i]);
+	sbtreeFlush(&state);
+	clock_t insertTime = clock() - start;
+
+	dbbufferClearStats(&buffer);
+	sensorData value;
+	int32_t errors = 0;
+	start = clock();
+	for (int32_t i=0; i < numRecords; i++)
+	{
+		if (sbtreeGet(&state, &keys[i], &value) != 0 || value.values[0] != data[i].values[0])
+			errors++;
+	}
+	clock_t queryTime = clock() - start;
+
+	printf("C API:\t\tInsert: %lu ms\tQuery: %lu ms\tQuery reads: %lu\tErrors: %d\n", (unsigned long) (insertTime*1000/CLOCKS_PER_SEC),
+		(unsigned long) (queryTime*1000/CLOCKS_PER_SEC), (unsigned long) buffer.numReads, errors);
+	closeBuffer(&buffer);
+}
+
+/**
+ * Insert and query all records using C++ template.
+ */
+static void runTemplate(uint32_t *keys, sensorData *data, int32_t numRecords)
+{
+	fileStorageState storage;
+	storage.fileName = (char*) "myfile.bin";
+	if (fileStorageInit((storageState*) &storage) != 0)
+	{
+		printf("Error: Cannot initialize storage!\n");
+		return;
+	}
+
+	static SBTree<uint32_t, sensorData, PAGE_SIZE, NUM_PAGES> tree((storageState*) &storage);
+	if (tree.init() != 0)
+	{
+		printf("Error: Cannot initialize tree!\n");
+		return;
+	}
+
+	clock_t start = clock();
+	for (int32_t i=0; i < numRecords; i++)
+		tree.put(keys[i], data[i]);
+	tree.flush();
+	clock_t insertTime = clock() - start;
+
+	dbbuffer *buffer = tree.getState()->buffer;
+	dbbufferClearStats(buffer);
+	sensorData value;
+	int32_t errors = 0;
+	start = clock();
+	for (int32_t i=0; i < numRecords; i++)
+	{
+		if (tree.get(keys[i], value) != 0 || value.values[0] != data[i].values[0])
+			errors++;
+	}
+	clock_t queryTime = clock() - start;
+
+	printf("C++ template:\tInsert: %lu ms\tQuery: %lu ms\tQuery reads: %lu\tErrors: %d\n", (unsigned long) (insertTime*1000/CLOCKS_PER_SEC),
+		(unsigned long) (queryTime*1000/CLOCKS_PER_SEC), (unsigned long) buffer->numReads, errors);
+	closeBuffer(buffer);
+}
+
+/**
+ * Main function to run tests
+ */
+int main()
+{
+	int32_t numRecords = 100000;
+	uint32_t *keys = new uint32_t[numRecords];
+	sensorData *data = new sensorData[numRecords];
+
+	numRecords = loadRecords("data/uwa500K.bin", keys, data, numRecords);
+	if (numRecords == 0)
+	{
+		printf("Error: Cannot read data/uwa500K.bin\n");
+		return 1;
+	}
+	printf("Records: %d\n", numRecords);
+
+	runC(keys, data, numRecords);
+	runTemplate(keys, data, numRecords);
+
+	delete[] keys;
+	delete[] data;
+	return 0;
+}
@@ -0,0 +1,562 @@
+/******************************************************************************/
+/**
+@file		uringStorage.c
+@author		Ramon Lawrence
+@brief		Asynchronous storage using Linux io_uring with batched submission of page writes and reads.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "uringStorage.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define URING_STORAGE_AVAILABLE
+#endif
+#endif
+
+#ifdef URING_STORAGE_AVAILABLE
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+/* State of memory slot holding a page in flight */
+#define URING_SLOT_FREE		0
+#define URING_SLOT_WRITE	1		/* Write queued or in flight. Slot has page data. */
+#define URING_SLOT_READ		2		/* Read in flight */
+#define URING_SLOT_READY	3		/* Read complete. Slot has page data until read or reused. */
+
+typedef struct {
+	id_t	page;
+	uint8_t	state;
+	int8_t	error;
+} uringSlot;
+
+/**
+@brief     	Returns number of bytes of memory required for pages in flight.
+@param		queueDepth
+                Maximum number of page operations in flight
+@param		pageSize
+                Size of page in bytes
+@return		Number of bytes to allocate for memory
+*/
+uint32_t uringStorageMemorySize(uint16_t queueDepth, count_t pageSize)
+{
+	return (uint32_t) queueDepth * (pageSize + sizeof(uringSlot));
+}
+
+#ifdef URING_STORAGE_AVAILABLE
+
+/* Slot information is after page data so pages keep alignment of memory */
+#define URING_SLOTS(us)			((uringSlot*) ((int8_t*) (us)->memory + (uint32_t) (us)->queueDepth * (us)->pageSize))
+#define URING_SLOT_PAGE(us, i)	((void*) ((int8_t*) (us)->memory + (uint32_t) (i) * (us)->pageSize))
+
+/**
+@brief     	Creates io_uring and maps its submission and completion queues.
+@param		us
+                io_uring storage state structure
+@return		Returns 0 if success, non-zero if failure.
+*/
+static int8_t uringStorageSetup(uringStorageState *us)
+{
+	struct io_uring_params p;
+	int8_t *sq, *cq;
+
+	memset(&p, 0, sizeof(p));
+	us->ringFd = (int) syscall(__NR_io_uring_setup, us->queueDepth, &p);
+	if (us->ringFd < 0)
+	{
+		us->ringFd = -1;
+		return -1;
+	}
+
+	us->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+	us->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{	/* Both rings in one mapping */
+		if (us->cqRingSize > us->sqRingSize)
+			us->sqRingSize = us->cqRingSize;
+		us->cqRingSize = 0;
+	}
+
+	us->sqRing = mmap(NULL, us->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, us->ringFd, IORING_OFF_SQ_RING);
+	if (us->sqRing == MAP_FAILED)
+		goto fail;
+	us->cqRing = us->sqRing;
+	if (us->cqRingSize > 0)
+	{
+		us->cqRing = mmap(NULL, us->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, us->ringFd, IORING_OFF_CQ_RING);
+		if (us->cqRing == MAP_FAILED)
+		{
+			munmap(us->sqRing, us->sqRingSize);
+			goto fail;
+		}
+	}
+	us->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	us->sqes = mmap(NULL, us->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, us->ringFd, IORING_OFF_SQES);
+	if (us->sqes == MAP_FAILED)
+	{
+		munmap(us->sqRing, us->sqRingSize);
+		if (us->cqRingSize > 0)
+			munmap(us->cqRing, us->cqRingSize);
+		goto fail;
+	}
+
+	sq = (int8_t*) us->sqRing;
+	cq = (int8_t*) us->cqRing;
+	us->sqHead = (uint32_t*) (sq + p.sq_off.head);
+	us->sqTail = (uint32_t*) (sq + p.sq_off.tail);
+	us->sqMask = (uint32_t*) (sq + p.sq_off.ring_mask);
+	us->sqArray = (uint32_t*) (sq + p.sq_off.array);
+	us->cqHead = (uint32_t*) (cq + p.cq_off.head);
+	us->cqTail = (uint32_t*) (cq + p.cq_off.tail);
+	us->cqMask = (uint32_t*) (cq + p.cq_off.ring_mask);
+	us->cqes = cq + p.cq_off.cqes;
+	return 0;
+
+fail:
+	close(us->ringFd);
+	us->ringFd = -1;
+	return -1;
+}
+
+/**
+@brief     	Adds read or write of slot page to submission queue. Submission queue has at least
+			queueDepth entries so it never overflows.
+@param		us
+                io_uring storage state structure
+@param		slot
+                Slot index
+@param		opcode
+                IORING_OP_READ or IORING_OP_WRITE
+*/
+static void uringStorageQueue(uringStorageState *us, uint16_t slot, uint8_t opcode)
+{
+	uint32_t tail = *us->sqTail;
+	uint32_t index = tail & *us->sqMask;
+	struct io_uring_sqe *sqe = ((struct io_uring_sqe*) us->sqes) + index;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = us->fd.fd;
+	sqe->addr = (uint64_t) (uintptr_t) URING_SLOT_PAGE(us, slot);
+	sqe->len = us->pageSize;
+	sqe->off = (uint64_t) URING_SLOTS(us)[slot].page * us->pageSize;
+	sqe->user_data = slot;
+	us->sqArray[index] = index;
+
+	/* Kernel must see entry before tail update */
+	__atomic_store_n(us->sqTail, tail+1, __ATOMIC_RELEASE);
+	us->queued++;
+}
+
+/**
+@brief     	Processes completed operations. Failed writes are retried synchronously.
+@param		us
+                io_uring storage state structure
+*/
+static void uringStorageReap(uringStorageState *us)
+{
+	uint32_t head = *us->cqHead;
+	uint32_t tail = __atomic_load_n(us->cqTail, __ATOMIC_ACQUIRE);
+	uringSlot *slots = URING_SLOTS(us);
+
+	for ( ; head != tail; head++)
+	{
+		struct io_uring_cqe *cqe = ((struct io_uring_cqe*) us->cqes) + (head & *us->cqMask);
+		uringSlot *s = &slots[cqe->user_data];
+
+		if (s->state == URING_SLOT_WRITE)
+		{
+			if (cqe->res != us->pageSize && fdStorageWritePage((storageState*) us, s->page, us->pageSize, URING_SLOT_PAGE(us, cqe->user_data)) != 0)
+				us->numErrors++;
+			s->state = URING_SLOT_FREE;
+		}
+		else
+		{
+			s->state = URING_SLOT_READY;
+			s->error = cqe->res != us->pageSize;
+		}
+		us->inFlight--;
+	}
+	__atomic_store_n(us->cqHead, head, __ATOMIC_RELEASE);
+}
+
+/**
+@brief     	Submits queued operations and optionally waits for at least one completion.
+@param		us
+                io_uring storage state structure
+@param		wait
+                1 to wait for a completion, 0 to only submit
+*/
+static void uringStorageSubmit(uringStorageState *us, uint8_t wait)
+{
+	int r;
+
+	do
+	{
+		r = (int) syscall(__NR_io_uring_enter, us->ringFd, us->queued, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	} while (r < 0 && errno == EINTR);
+
+	us->numSubmits++;
+	if (r > 0)
+	{
+		us->queued -= r;
+		us->inFlight += r;
+	}
+	uringStorageReap(us);
+}
+
+/**
+@brief     	Returns slot holding page or -1 if page is not in memory.
+@param		us
+                io_uring storage state structure
+@param		pageNum
+                Physical page id (number)
+*/
+static int32_t uringStorageFindSlot(uringStorageState *us, id_t pageNum)
+{
+	uringSlot *slots = URING_SLOTS(us);
+
+	for (uint16_t i=0; i < us->queueDepth; i++)
+		if (slots[i].state != URING_SLOT_FREE && slots[i].page == pageNum)
+			return i;
+	return -1;
+}
+
+/**
+@brief     	Returns a free slot or -1 if all slots are in use.
+@param		us
+                io_uring storage state structure
+@param		evict
+                1 if a completed read that was not used may be replaced
+*/
+static int32_t uringStorageFreeSlot(uringStorageState *us, uint8_t evict)
+{
+	uringSlot *slots = URING_SLOTS(us);
+	int32_t ready = -1;
+
+	for (uint16_t i=0; i < us->queueDepth; i++)
+	{
+		if (slots[i].state == URING_SLOT_FREE)
+			return i;
+		if (slots[i].state == URING_SLOT_READY)
+			ready = i;
+	}
+	return evict ? ready : -1;
+}
+
+/**
+@brief     	Waits until slot has no operation in flight.
+@param		us
+                io_uring storage state structure
+@param		slot
+                Slot index
+*/
+static void uringStorageWaitSlot(uringStorageState *us, int32_t slot)
+{
+	uringSlot *s = &URING_SLOTS(us)[slot];
+
+	while (s->state == URING_SLOT_WRITE || s->state == URING_SLOT_READ)
+		uringStorageSubmit(us, 1);
+}
+
+/**
+@brief     	Opens file and sets up io_uring.
+			Uses synchronous pread and pwrite if io_uring is not available.
+@param		state
+                io_uring storage state structure
+@param		open
+                File descriptor storage function that opens file
+@return		 Returns 0 if success, non-zero if failure.
+*/
+static int8_t uringStorageStart(storageState *storage, int8_t (*open)(storageState *storage))
+{	 
+	uringStorageState *us = (uringStorageState*) storage;
+	uringSlot *slots;
+
+	us->ringFd = -1;
+	us->queued = 0;
+	us->inFlight = 0;
+	us->numSubmits = 0;
+	us->numErrors = 0;
+	if (us->submitBatch == 0)
+		us->submitBatch = 1;
+
+	if (open(storage) != 0)
+		return -1;
+
+	/* No memory for pages in flight or io_uring not supported by kernel. Use file descriptor storage functions. */
+	if (us->memory == NULL || us->queueDepth == 0 || uringStorageSetup(us) != 0)
+		return 0;
+
+	slots = URING_SLOTS(us);
+	for (uint16_t i=0; i < us->queueDepth; i++)
+		slots[i].state = URING_SLOT_FREE;
+
+	us->fd.storage.init = uringStorageInit;
+	us->fd.storage.close = uringStorageClose;
+	us->fd.storage.readPage = uringStorageReadPage;
+	us->fd.storage.writePage = uringStorageWritePage;
+	us->fd.storage.flush = uringStorageFlush;
+	us->fd.storage.prefetchPage = uringStoragePrefetchPage;
+	us->fd.storage.writePages = NULL;
+	us->fd.storage.readPages = NULL;
+	return 0;	
+}
+
+/**
+@brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
+			Page that is being written or was prefetched is copied from memory.
+@param     	state
+                io_uring storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t uringStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{	
+	uringStorageState *us = (uringStorageState*) storage;
+	int32_t slot = uringStorageFindSlot(us, pageNum);
+
+	if (slot != -1)
+	{
+		uringSlot *s = &URING_SLOTS(us)[slot];
+
+		if (s->state == URING_SLOT_WRITE)
+		{	/* Page data is in memory until write completes */
+			memcpy(buffer, URING_SLOT_PAGE(us, slot), pageSize);
+			return 0;
+		}
+
+		uringStorageWaitSlot(us, slot);
+		s->state = URING_SLOT_FREE;
+		if (!s->error)
+		{
+			memcpy(buffer, URING_SLOT_PAGE(us, slot), pageSize);
+			return 0;
+		}
+	}
+
+	/* Start queued operations before waiting for synchronous read */
+	if (us->queued > 0)
+		uringStorageSubmit(us, 0);
+	return fdStorageReadPage(storage, pageNum, pageSize, buffer);
+}
+
+/**
+@brief      Queues write of page. Page is copied so buffer can be reused on return.
+			Write is complete after flush().
+@param     	state
+                io_uring storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to buffer to copy data from
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t uringStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{    
+	uringStorageState *us = (uringStorageState*) storage;
+	int32_t slot = uringStorageFindSlot(us, pageNum);
+	uringSlot *s;
+
+	if (slot != -1)
+	{	/* Earlier write or read of page must complete first */
+		uringStorageWaitSlot(us, slot);
+		URING_SLOTS(us)[slot].state = URING_SLOT_FREE;
+	}
+
+	while ((slot = uringStorageFreeSlot(us, 1)) == -1)
+		uringStorageSubmit(us, 1);
+
+	s = &URING_SLOTS(us)[slot];
+	s->page = pageNum;
+	s->state = URING_SLOT_WRITE;
+	memcpy(URING_SLOT_PAGE(us, slot), buffer, pageSize);
+	uringStorageQueue(us, slot, IORING_OP_WRITE);
+
+	if (us->queued >= us->submitBatch)
+		uringStorageSubmit(us, 0);
+	return 0;
+}
+
+/**
+@brief      Starts asynchronous read of page. Ignored if no memory is free for the page.
+			Read is submitted with the next read or once submitBatch operations are queued.
+@param     	state
+                io_uring storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t uringStoragePrefetchPage(storageState *storage, id_t pageNum, count_t pageSize)
+{
+	uringStorageState *us = (uringStorageState*) storage;
+	int32_t slot;
+	uringSlot *s;
+
+	if (uringStorageFindSlot(us, pageNum) != -1)
+		return 0;
+
+	/* Prefetch does not replace pages that were prefetched but not read yet */
+	if ((slot = uringStorageFreeSlot(us, 0)) == -1)
+	{
+		uringStorageReap(us);
+		if ((slot = uringStorageFreeSlot(us, 0)) == -1)
+			return 0;
+	}
+
+	s = &URING_SLOTS(us)[slot];
+	s->page = pageNum;
+	s->state = URING_SLOT_READ;
+	s->error = 0;
+	uringStorageQueue(us, slot, IORING_OP_READ);
+
+	/* Prefetches issued together are submitted with one system call on next read */
+	if (us->queued >= us->submitBatch)
+		uringStorageSubmit(us, 0);
+	return 0;
+}
+
+/**
+@brief     	Waits for all queued operations and ensures all data is written to device.
+@param     	state
+                io_uring storage state structure
+*/
+void uringStorageFlush(storageState *storage)
+{
+	uringStorageState *us = (uringStorageState*) storage;
+
+	while (us->queued > 0 || us->inFlight > 0)
+		uringStorageSubmit(us, 1);
+	fdStorageFlush(storage);
+}
+
+/**
+@brief     	Closes storage and performs any needed cleanup.
+@param     	state
+                io_uring storage state structure
+*/
+void uringStorageClose(storageState *storage)
+{	
+	uringStorageState *us = (uringStorageState*) storage;
+
+	uringStorageFlush(storage);
+	munmap(us->sqes, us->sqesSize);
+	if (us->cqRingSize > 0)
+		munmap(us->cqRing, us->cqRingSize);
+	munmap(us->sqRing, us->sqRingSize);
+	close(us->ringFd);
+	us->ringFd = -1;
+	fdStorageClose(storage);
+}
+
+#else
+
+/* io_uring not available. Storage uses file descriptor functions set by fdStorageInit(). */
+
+static int8_t uringStorageStart(storageState *storage, int8_t (*open)(storageState *storage))
+{
+	uringStorageState *us = (uringStorageState*) storage;
+
+	us->ringFd = -1;
+	us->queued = 0;
+	us->inFlight = 0;
+	us->numSubmits = 0;
+	us->numErrors = 0;
+	return open(storage);
+}
+
+int8_t uringStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{
+	return fdStorageReadPage(storage, pageNum, pageSize, buffer);
+}
+
+int8_t uringStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer)
+{
+	return fdStorageWritePage(storage, pageNum, pageSize, buffer);
+}
+
+int8_t uringStoragePrefetchPage(storageState *storage, id_t pageNum, count_t pageSize)
+{
+	return 0;
+}
+
+void uringStorageFlush(storageState *storage)
+{
+	fdStorageFlush(storage);
+}
+
+void uringStorageClose(storageState *storage)
+{
+	fdStorageClose(storage);
+}
+
+#endif
+
+/**
+@brief     	Initializes storage. Creates file (existing file is truncated) and sets up io_uring.
+			Uses synchronous pread and pwrite if io_uring is not available.
+@param		state
+                io_uring storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t uringStorageInit(storageState *storage)
+{
+	return uringStorageStart(storage, fdStorageInit);
+}
+
+/**
+@brief     	Opens existing file without truncating it (see sbtreeOpen()) and sets up io_uring.
+@param		state
+                io_uring storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. file does not exist).
+*/
+int8_t uringStorageOpen(storageState *storage)
+{
+	return uringStorageStart(storage, fdStorageOpen);
+}
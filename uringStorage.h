@@ -0,0 +1,167 @@
+/******************************************************************************/
+/**
+@file		uringStorage.h
+@author		Ramon Lawrence
+@brief		Asynchronous storage using Linux io_uring with batched submission of page writes and reads.
+@copyright	Copyright 2021
+			The University of British Columbia,
+			Ramon Lawrence		
+@par Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+@par 1.Redistributions of source code must retain the above copyright notice,
+	this list of conditions and the following disclaimer.
+
+@par 2.Redistributions in binary form must reproduce the above copyright notice,
+	this list of conditions and the following disclaimer in the documentation
+	and/or other materials provided with the distribution.
+
+@par 3.Neither the name of the copyright holder nor the names of its contributors
+	may be used to endorse or promote products derived from this software without
+	specific prior written permission.
+
+@par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+/******************************************************************************/
+#ifndef URINGSTORAGE_H
+#define URINGSTORAGE_H
+
+#include <stdint.h>
+
+#include "storage.h"
+#include "fdStorage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	fdStorageState	fd;					/* File descriptor storage used to open file and as synchronous fallback. Set fd.fileName and fd.direct. */
+	count_t			pageSize;			/* Size of page in bytes */
+	uint16_t		queueDepth;			/* Maximum number of page operations in flight */
+	uint16_t		submitBatch;		/* Number of queued operations before submission to kernel (1 submits every write) */
+	void			*memory;			/* Pre-allocated memory of uringStorageMemorySize() bytes for pages in flight. Aligned to FD_STORAGE_ALIGNMENT for direct I/O. NULL uses synchronous I/O. */
+	int				ringFd;				/* io_uring file descriptor. -1 if io_uring is not available and synchronous I/O is used. */
+	void			*sqRing;			/* Submission queue ring (mapped) */
+	void			*cqRing;			/* Completion queue ring (mapped). May be same as sqRing. */
+	void			*sqes;				/* Submission queue entries (mapped) */
+	uint32_t		sqRingSize;			/* Size of mapped submission queue ring */
+	uint32_t		cqRingSize;			/* Size of mapped completion queue ring */
+	uint32_t		sqesSize;			/* Size of mapped submission queue entries */
+	uint32_t		*sqHead, *sqTail, *sqMask, *sqArray;	/* Submission queue ring fields */
+	uint32_t		*cqHead, *cqTail, *cqMask;				/* Completion queue ring fields */
+	void			*cqes;				/* Completion queue entries */
+	uint16_t		queued;				/* Operations queued but not submitted */
+	uint16_t		inFlight;			/* Operations submitted but not completed */
+	uint32_t		numSubmits;			/* Number of submission system calls */
+	uint32_t		numErrors;			/* Number of failed writes that could not be retried */
+} uringStorageState;
+
+
+/**
+@brief     	Returns number of bytes of memory required for pages in flight.
+@param		queueDepth
+                Maximum number of page operations in flight
+@param		pageSize
+                Size of page in bytes
+@return		Number of bytes to allocate for memory
+*/
+uint32_t uringStorageMemorySize(uint16_t queueDepth, count_t pageSize);
+
+
+/**
+@brief     	Initializes storage. Creates file (existing file is truncated) and sets up io_uring.
+			Uses synchronous pread and pwrite if io_uring is not available.
+@param		state
+                io_uring storage state structure
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t uringStorageInit(storageState *storage);
+
+
+/**
+@brief     	Opens existing file without truncating it (see sbtreeOpen()) and sets up io_uring.
+@param		state
+                io_uring storage state structure
+@return		 Returns 0 if success, non-zero if failure (e.g. file does not exist).
+*/
+int8_t uringStorageOpen(storageState *storage);
+
+
+/**
+@brief      Reads page from storage into buffer. Returns 0 if success, non-zero if failure.
+			Page that is being written or was prefetched is copied from memory.
+@param     	state
+                io_uring storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@param		buffer
+				Pointer to buffer to copy data into
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t uringStorageReadPage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Queues write of page. Page is copied so buffer can be reused on return.
+			Write is complete after flush().
+@param     	state
+                io_uring storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to write in bytes
+@param		buffer
+				Pointer to buffer to copy data from
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t uringStorageWritePage(storageState *storage, id_t pageNum, count_t pageSize, void *buffer);
+
+
+/**
+@brief      Starts asynchronous read of page. Ignored if no memory is free for the page.
+			Read is submitted with the next read or once submitBatch operations are queued.
+@param     	state
+                io_uring storage state structure
+@param     	pageNum
+                Physical page id (number)
+@param		pageSize
+				Size of page to read in bytes
+@return		 Returns 0 if success, non-zero if failure.
+*/
+int8_t uringStoragePrefetchPage(storageState *storage, id_t pageNum, count_t pageSize);
+
+
+/**
+@brief     	Waits for all queued operations and ensures all data is written to device.
+@param     	state
+                io_uring storage state structure
+*/
+void uringStorageFlush(storageState *storage);
+
+
+/**
+@brief     	Closes storage and performs any needed cleanup.
+@param     	state
+                io_uring storage state structure
+*/
+void uringStorageClose(storageState *storage);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif